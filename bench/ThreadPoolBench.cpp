@@ -0,0 +1,207 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+constexpr std::size_t k_numRuns = 5;
+
+/**
+ * The ThreadPool from before work stealing: one queue behind one mutex, shared by every worker and producer.
+ */
+class SharedQueuePool
+{
+public:
+    explicit SharedQueuePool(std::size_t const& numThreads)
+        : m_stop(false)
+    {
+        for (std::size_t i = 0; i < numThreads; ++i)
+        {
+            m_workers.emplace_back(
+            [this]
+            {
+                workerThread_();
+            });
+        }
+    }
+
+    ~SharedQueuePool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_queueMtx);
+            m_stop = true;
+        }
+        m_condition.notify_all();
+
+        for (std::thread& worker : m_workers)
+        {
+            worker.join();
+        }
+    }
+
+    template<typename F>
+    auto submit(F&& f) -> std::future<std::invoke_result_t<F>>
+    {
+        auto task = std::make_shared<std::packaged_task<std::invoke_result_t<F>()>>(std::forward<F>(f));
+        auto result = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(m_queueMtx);
+            m_tasks.emplace([task]()
+            {
+                (*task)();
+            });
+        }
+
+        m_condition.notify_one();
+        return result;
+    }
+
+private:
+    void workerThread_()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(m_queueMtx);
+                m_condition.wait(lock,
+                [this]
+                {
+                    return m_stop || !m_tasks.empty();
+                });
+
+                if (m_stop && m_tasks.empty())
+                {
+                    return;
+                }
+
+                task = std::move(m_tasks.front());
+                m_tasks.pop();
+            }
+
+            task();
+        }
+    }
+
+    std::vector<std::thread> m_workers;
+    std::queue<std::function<void()>> m_tasks;
+    std::mutex m_queueMtx;
+    std::condition_variable m_condition;
+    bool m_stop;
+};
+
+/**
+ * Submit numTasks tiny tasks from outside the pool and wait for all of them.
+ */
+template<typename Pool>
+void submitFromOutside(Pool& pool, std::size_t const& numTasks, std::atomic<std::size_t>& counter)
+{
+    std::vector<decltype(pool.submit([&counter] { ++counter; }))> futures;
+    futures.reserve(numTasks);
+    for (std::size_t i = 0; i < numTasks; ++i)
+    {
+        futures.push_back(pool.submit([&counter] { ++counter; }));
+    }
+    for (auto& future : futures)
+    {
+        future.wait();
+    }
+}
+
+/**
+ * Have one task submit numTasks tiny tasks (like a JobGraph stage fanning out its API calls), and wait for all of them.
+ */
+template<typename Pool>
+void submitFromWorker(Pool& pool, std::size_t const& numTasks, std::atomic<std::size_t>& counter)
+{
+    auto fanOut = [&pool, &counter, numTasks]()
+    {
+        std::vector<decltype(pool.submit([&counter] { ++counter; }))> futures;
+        futures.reserve(numTasks);
+        for (std::size_t i = 0; i < numTasks; ++i)
+        {
+            futures.push_back(pool.submit([&counter] { ++counter; }));
+        }
+        return futures;
+    };
+
+    auto futures = pool.submit(fanOut).get();
+    for (auto& future : futures)
+    {
+        future.wait();
+    }
+}
+
+/**
+ * Get the median wall time of a few runs of scenario, in milliseconds.
+ */
+template<typename Scenario>
+[[nodiscard]] double medianMs(Scenario const& scenario)
+{
+    std::vector<double> runMs;
+    for (std::size_t run = 0; run < k_numRuns; ++run)
+    {
+        auto start = std::chrono::steady_clock::now();
+        scenario();
+        runMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    std::sort(runMs.begin(), runMs.end());
+    return runMs[runMs.size() / 2];
+}
+} /* namespace */
+
+/**
+ * Times the old shared-queue pool against the work-stealing ThreadPool on 1k/10k/100k trivial tasks,
+ * submitted both from outside the pool and from one of its workers.
+ */
+int main()
+{
+    std::size_t numThreads = std::max(std::thread::hardware_concurrency(), 2U);
+    std::cout << "threads=" << numThreads << ", median of " << k_numRuns << " runs" << std::endl;
+    std::cout << std::left << std::setw(10) << "tasks" << std::setw(10) << "from"
+              << std::setw(14) << "shared (ms)" << std::setw(14) << "stealing (ms)" << std::endl;
+
+    for (std::size_t numTasks : { 1000UL, 10000UL, 100000UL })
+    {
+        for (std::string const& from : { std::string("outside"), std::string("worker") })
+        {
+            std::atomic<std::size_t> counter = 0;
+            double sharedMs = 0.;
+            double stealingMs = 0.;
+            {
+                SharedQueuePool pool(numThreads);
+                sharedMs = medianMs([&]()
+                {
+                    (from == "outside") ? submitFromOutside(pool, numTasks, counter) : submitFromWorker(pool, numTasks, counter);
+                });
+            }
+            {
+                ThreadPool pool(numThreads);
+                stealingMs = medianMs([&]()
+                {
+                    (from == "outside") ? submitFromOutside(pool, numTasks, counter) : submitFromWorker(pool, numTasks, counter);
+                });
+            }
+
+            std::cout << std::left << std::setw(10) << numTasks << std::setw(10) << from << std::fixed << std::setprecision(2)
+                      << std::setw(14) << sharedMs << std::setw(14) << stealingMs << std::endl;
+        }
+    }
+
+    return 0;
+}
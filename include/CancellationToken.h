@@ -0,0 +1,91 @@
+#ifndef __CANCELLATION_TOKEN_H__
+#define __CANCELLATION_TOKEN_H__
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <stdexcept>
+
+/**
+ * Thrown by work that notices it has been cancelled.
+ */
+class OperationCancelled : public std::runtime_error
+{
+public:
+    OperationCancelled()
+        : std::runtime_error("Operation was cancelled")
+    {}
+};
+
+/**
+ * Thread-safe flag for cooperatively cancelling long-running work (e.g. a job that is being stopped).
+ */
+class CancellationToken
+{
+public:
+    CancellationToken() = default;
+    ~CancellationToken() = default;
+
+    CancellationToken(const CancellationToken&) = delete;
+    CancellationToken& operator=(const CancellationToken&) = delete;
+
+    /**
+     * Cancel, waking up anything that is sleeping on this token.
+     */
+    void cancel() noexcept
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            m_bCancelled = true;
+        }
+
+        m_cv.notify_all();
+    }
+
+    /**
+     * Un-cancel, so that the token can be reused for the next run.
+     */
+    void reset() noexcept
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_bCancelled = false;
+    }
+
+    [[nodiscard]] bool isCancelled() const noexcept { return m_bCancelled.load(); }
+
+    /**
+     * Throw OperationCancelled if cancelled.
+     */
+    void throwIfCancelled() const
+    {
+        if (isCancelled())
+        {
+            throw OperationCancelled();
+        }
+    }
+
+    /**
+     * Sleep for given duration, or throw OperationCancelled as soon as the token is cancelled.
+     */
+    void sleepFor(std::chrono::milliseconds const& duration)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mtx);
+            m_cv.wait_for(lock, duration,
+            [this]
+            {
+                return m_bCancelled.load();
+            });
+        }
+
+        throwIfCancelled();
+    }
+
+private:
+    std::atomic<bool> m_bCancelled{false};
+    std::mutex m_mtx;
+    std::condition_variable m_cv;
+};
+
+#endif /* __CANCELLATION_TOKEN_H__ */
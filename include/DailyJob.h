@@ -1,6 +1,8 @@
 #ifndef __DAILY_JOB_H__
 #define __DAILY_JOB_H__
 
+#include "CancellationToken.h"
+
 #include <string>
 #include <functional>
 #include <chrono>
@@ -12,11 +14,12 @@
 
 /**
  * Simple daily job scheduler.
+ * The job is handed a cancellation token, which is cancelled when the scheduler is stopped.
  */
 class DailyJob
 {
 public:
-    DailyJob(int const& hour, std::string const& name, std::function<void()> const& job, std::function<void()> const& jobCallback);
+    DailyJob(int const& hour, std::string const& name, std::function<void(std::shared_ptr<CancellationToken>)> const& job, std::function<void()> const& jobCallback);
     ~DailyJob();
 
     void start();
@@ -28,10 +31,11 @@ private:
 
     int m_hour;
     std::string m_name;
-    const std::function<void()> m_job;
+    const std::function<void(std::shared_ptr<CancellationToken>)> m_job;
     const std::function<void()> m_jobCallback;
 
     std::atomic<bool> m_bRunning{false};
+    std::shared_ptr<CancellationToken> m_pCancelToken = std::make_shared<CancellationToken>();
     std::unique_ptr<std::thread> m_jobThread;
     std::mutex m_jobMtx;
     std::condition_variable m_jobCV;
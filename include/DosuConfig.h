@@ -4,6 +4,7 @@
 #include <string>
 #include <filesystem>
 #include <map>
+#include <vector>
 #include <atomic>
 
 const std::string k_logLevelKey               = "LOG_LEVEL";
@@ -13,10 +14,23 @@ const std::string k_osuClientIdKey            = "OSU_CLIENT_ID";
 const std::string k_osuClientSecretKey        = "OSU_CLIENT_SECRET";
 const std::string k_scrapeRankingsRunHourKey  = "SCRAPE_RANKINGS_RUN_HOUR";
 const std::string k_topPlaysRunHourKey        = "TOP_PLAYS_RUN_HOUR";
+const std::string k_topPlaysWindowDaysKey     = "TOP_PLAYS_WINDOW_DAYS";
+const std::string k_topPlaysCountKey         = "TOP_PLAYS_COUNT";
+const std::string k_scrapeRankingsPagesPerHourKey = "SCRAPE_RANKINGS_PAGES_PER_HOUR";
+const std::string k_scrapeRankingsStagingMaxAgeKey = "SCRAPE_RANKINGS_STAGING_MAX_AGE_HOURS";
+const std::string k_countryRankingsCountriesKey = "COUNTRY_RANKINGS_COUNTRIES";
+const std::string k_countryRankingsDailyCallBudgetKey = "COUNTRY_RANKINGS_DAILY_CALL_BUDGET";
 const std::string k_threadCountKey            = "THREAD_COUNT";
+const std::string k_ioThreadCountKey          = "IO_THREAD_COUNT";
+const std::string k_cpuThreadCountKey         = "CPU_THREAD_COUNT";
+const std::string k_ioThreadCountAutoTuneKey  = "IO_THREAD_COUNT_AUTO_TUNE";
+const std::string k_threadPoolStatsFilePathKey = "THREAD_POOL_STATS_FILE_PATH";
+const std::string k_threadPoolQueueCapacityKey = "THREAD_POOL_QUEUE_CAPACITY";
 const std::string k_rankingsDbFilePathKey     = "RANKINGS_DB_FILE_PATH";
 const std::string k_topPlaysDbFilePathKey     = "TOP_PLAYS_DB_FILE_PATH";
 const std::string k_botConfigDbFilePathKey    = "BOT_CONFIG_DB_FILE_PATH";
+const std::string k_cacheDbFilePathKey        = "CACHE_DB_FILE_PATH";
+const std::string k_rankingsSnapshotFilePathKey = "RANKINGS_SNAPSHOT_FILE_PATH";
 const std::string k_discordBotStringsKey      = "DISCORD_BOT_STRINGS";
 
 const std::string k_letterRankXKey  = "LETTER_RANK_X";
@@ -74,10 +88,22 @@ public:
     static std::string osuClientSecret;
     static int scrapeRankingsRunHour;
     static int topPlaysRunHour;
-    static int threadCount;
+    static int topPlaysWindowDays;
+    static int topPlaysCount;
+    static int scrapeRankingsPagesPerHour;
+    static int scrapeRankingsStagingMaxAgeHours;
+    static std::vector<std::string> countryRankingsCountries;
+    static int countryRankingsDailyCallBudget;
+    static int ioThreadCount;
+    static int cpuThreadCount;
+    static bool ioThreadCountAutoTune;
+    static std::filesystem::path threadPoolStatsFilePath;
+    static int threadPoolQueueCapacity;
     static std::filesystem::path rankingsDatabaseFilePath;
     static std::filesystem::path topPlaysDatabaseFilePath;
     static std::filesystem::path botConfigDatabaseFilePath;
+    static std::filesystem::path cacheDatabaseFilePath;
+    static std::filesystem::path rankingsSnapshotFilePath;
     static std::map<std::string, std::string> discordBotStrings;
 };
 
@@ -0,0 +1,42 @@
+#ifndef __INTERVAL_JOB_H__
+#define __INTERVAL_JOB_H__
+
+#include "CancellationToken.h"
+
+#include <string>
+#include <functional>
+#include <chrono>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/**
+ * Simple fixed-interval job scheduler.
+ * The job is handed a cancellation token, which is cancelled when the scheduler is stopped.
+ */
+class IntervalJob
+{
+public:
+    IntervalJob(std::chrono::seconds const& interval, std::string const& name, std::function<void(std::shared_ptr<CancellationToken>)> const& job);
+    ~IntervalJob();
+
+    void start();
+    void stop();
+
+private:
+    void runJobLoop_();
+
+    std::chrono::seconds m_interval;
+    std::string m_name;
+    const std::function<void(std::shared_ptr<CancellationToken>)> m_job;
+
+    std::atomic<bool> m_bRunning{false};
+    std::shared_ptr<CancellationToken> m_pCancelToken = std::make_shared<CancellationToken>();
+    std::unique_ptr<std::thread> m_jobThread;
+    std::mutex m_jobMtx;
+    std::condition_variable m_jobCV;
+};
+
+#endif /* __INTERVAL_JOB_H__ */
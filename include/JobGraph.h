@@ -0,0 +1,51 @@
+#ifndef __JOB_GRAPH_H__
+#define __JOB_GRAPH_H__
+
+#include "ThreadPool.h"
+#include "CancellationToken.h"
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <chrono>
+#include <memory>
+#include <cstddef>
+#include <unordered_map>
+
+/**
+ * Runs a set of named stages, each only once all of the stages it depends on have finished.
+ * Independent stages run side by side, each on a thread of its own.
+ */
+class JobGraph
+{
+public:
+    explicit JobGraph(std::string const& name);
+
+    void addStage(std::string const& name, std::vector<std::string> const& dependencies, std::function<void()> const& stage);
+    void run(std::shared_ptr<ThreadPool> pThreadPool, std::shared_ptr<CancellationToken> pCancelToken = nullptr, std::shared_ptr<ThreadPool> pCpuThreadPool = nullptr);
+
+    [[nodiscard]] std::vector<std::pair<std::string, std::chrono::milliseconds>> getStageTimings() const;
+
+private:
+    struct Stage_
+    {
+        std::string name;
+        std::vector<std::string> dependencies;
+        std::function<void()> fn;
+        std::vector<std::size_t> dependents;
+        std::size_t numUnmetDependencies = 0;
+        std::chrono::milliseconds duration{0};
+        bool bFinished = false;
+    };
+
+    void resolveDependencies_();
+    void runStage_(std::size_t const& stageIdx);
+    void logStageTimings_() const;
+    void reportThreadPoolStats_(ThreadPool& threadPool, std::string const& poolName) const;
+
+    std::string m_name;
+    std::vector<Stage_> m_stages;
+    std::unordered_map<std::string, std::size_t> m_stageNameToIdx;
+};
+
+#endif /* __JOB_GRAPH_H__ */
@@ -0,0 +1,380 @@
+#ifndef __POOL_TASK_H__
+#define __POOL_TASK_H__
+
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <latch>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <cstddef>
+
+/**
+ * State shared between a task sitting in the ThreadPool and the TaskFuture waiting on it.
+ * The task's callable, its arguments and its result all live in the one allocation, which is freed by whichever side lets go last.
+ */
+class TaskStateBase
+{
+public:
+    /**
+     * A task starts out referenced by the pool and by its future, unless nothing waits on it through a future.
+     */
+    explicit TaskStateBase(std::size_t const& numRefs = 2)
+        : m_refCount(numRefs)
+    {}
+    virtual ~TaskStateBase() = default;
+
+    TaskStateBase(const TaskStateBase&) = delete;
+    TaskStateBase& operator=(const TaskStateBase&) = delete;
+
+    virtual void run() noexcept = 0;
+
+    void release() noexcept
+    {
+        if (m_refCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            delete this;
+        }
+    }
+
+    /**
+     * Block until the task has run.
+     */
+    void wait() const noexcept
+    {
+        m_bReady.wait(false, std::memory_order_acquire);
+    }
+
+    [[nodiscard]] bool isReady() const noexcept { return m_bReady.load(std::memory_order_acquire); }
+
+    /**
+     * Record when the task was queued, and what it was queued under unless it already has a label.
+     */
+    void stamp(char const* pLabel, std::chrono::steady_clock::time_point const& enqueueTime) noexcept
+    {
+        if (!m_pLabel)
+        {
+            m_pLabel = pLabel;
+        }
+        m_enqueueTime = enqueueTime;
+    }
+
+    [[nodiscard]] char const* getLabel() const noexcept { return m_pLabel; }
+    [[nodiscard]] std::chrono::steady_clock::time_point getEnqueueTime() const noexcept { return m_enqueueTime; }
+
+protected:
+    void markReady_() noexcept
+    {
+        m_bReady.store(true, std::memory_order_release);
+        m_bReady.notify_all();
+    }
+
+    std::exception_ptr m_pError;
+
+private:
+    std::atomic<std::size_t> m_refCount;
+    std::atomic<bool> m_bReady = false;
+    char const* m_pLabel = nullptr;
+    std::chrono::steady_clock::time_point m_enqueueTime;
+};
+
+/**
+ * Where a task's return value (or exception) ends up.
+ */
+template<typename T>
+class TaskResult : public TaskStateBase
+{
+public:
+    using TaskStateBase::TaskStateBase;
+
+    [[nodiscard]] T takeResult()
+    {
+        wait();
+        if (m_pError)
+        {
+            std::rethrow_exception(m_pError);
+        }
+        return std::move(*m_oResult);
+    }
+
+protected:
+    std::optional<T> m_oResult;
+};
+
+template<>
+class TaskResult<void> : public TaskStateBase
+{
+public:
+    using TaskStateBase::TaskStateBase;
+
+    void takeResult()
+    {
+        wait();
+        if (m_pError)
+        {
+            std::rethrow_exception(m_pError);
+        }
+    }
+};
+
+/**
+ * A submitted callable along with its arguments, which are moved into it rather than bound and copied.
+ */
+template<typename T, typename Fn, typename... Args>
+class TaskState final : public TaskResult<T>
+{
+public:
+    template<typename F, typename... A>
+    explicit TaskState(F&& f, A&&... args)
+        : m_fn(std::forward<F>(f))
+        , m_args(std::forward<A>(args)...)
+    {}
+
+    void run() noexcept override
+    {
+        try
+        {
+            if constexpr (std::is_void_v<T>)
+            {
+                std::apply(std::move(m_fn), std::move(m_args));
+            }
+            else
+            {
+                this->m_oResult.emplace(std::apply(std::move(m_fn), std::move(m_args)));
+            }
+        }
+        catch (...)
+        {
+            this->m_pError = std::current_exception();
+        }
+
+        this->markReady_();
+    }
+
+private:
+    Fn m_fn;
+    std::tuple<Args...> m_args;
+};
+
+/**
+ * Completion latch shared by every chunk of a bulk operation (e.g. ThreadPool::parallelFor), in place of one future per task.
+ * Lives on the caller's stack; the caller waits on it before anything that the chunks reference goes out of scope.
+ */
+class BulkTaskGroup
+{
+public:
+    explicit BulkTaskGroup(std::ptrdiff_t const& numTasks)
+        : m_latch(numTasks)
+    {}
+
+    BulkTaskGroup(const BulkTaskGroup&) = delete;
+    BulkTaskGroup& operator=(const BulkTaskGroup&) = delete;
+
+    /**
+     * Record an error; only the first one is kept, and the remaining chunks skip whatever they haven't started yet.
+     */
+    void fail(std::exception_ptr pError) noexcept
+    {
+        std::lock_guard<std::mutex> lock(m_errorMtx);
+        if (!m_pFirstError)
+        {
+            m_pFirstError = pError;
+        }
+        m_bFailed.store(true, std::memory_order_release);
+    }
+
+    [[nodiscard]] bool hasFailed() const noexcept { return m_bFailed.load(std::memory_order_acquire); }
+
+    void countDown() noexcept { m_latch.count_down(); }
+
+    /**
+     * Block until every chunk has finished, then rethrow the first error if there was one.
+     */
+    void waitAndRethrow()
+    {
+        m_latch.wait();
+        if (m_pFirstError)
+        {
+            std::rethrow_exception(m_pFirstError);
+        }
+    }
+
+private:
+    std::latch m_latch;
+    std::mutex m_errorMtx;
+    std::exception_ptr m_pFirstError;
+    std::atomic<bool> m_bFailed = false;
+};
+
+/**
+ * A chunk of a bulk operation. Reports to its BulkTaskGroup instead of a future, so the pool holds the only reference to it.
+ */
+template<typename Fn>
+class BulkTaskState final : public TaskStateBase
+{
+public:
+    BulkTaskState(BulkTaskGroup& group, Fn fn)
+        : TaskStateBase(1)
+        , m_group(group)
+        , m_fn(std::move(fn))
+    {}
+
+    void run() noexcept override
+    {
+        try
+        {
+            if (!m_group.hasFailed())
+            {
+                m_fn(m_group);
+            }
+        }
+        catch (...)
+        {
+            m_group.fail(std::current_exception());
+        }
+
+        // The caller may return as soon as this hits zero, so the group can't be touched afterwards
+        m_group.countDown();
+    }
+
+private:
+    BulkTaskGroup& m_group;
+    Fn m_fn;
+};
+
+/**
+ * Move-only handle to a task waiting in the ThreadPool's queues.
+ */
+class PoolTask
+{
+public:
+    PoolTask() noexcept = default;
+    explicit PoolTask(TaskStateBase* pState) noexcept
+        : m_pState(pState)
+    {}
+
+    ~PoolTask()
+    {
+        if (m_pState)
+        {
+            m_pState->release();
+        }
+    }
+
+    PoolTask(PoolTask&& other) noexcept
+        : m_pState(std::exchange(other.m_pState, nullptr))
+    {}
+
+    PoolTask& operator=(PoolTask&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (m_pState)
+            {
+                m_pState->release();
+            }
+            m_pState = std::exchange(other.m_pState, nullptr);
+        }
+        return *this;
+    }
+
+    PoolTask(const PoolTask&) = delete;
+    PoolTask& operator=(const PoolTask&) = delete;
+
+    void operator()() noexcept { m_pState->run(); }
+
+    void stamp(char const* pLabel, std::chrono::steady_clock::time_point const& enqueueTime) noexcept { m_pState->stamp(pLabel, enqueueTime); }
+    [[nodiscard]] char const* getLabel() const noexcept { return m_pState->getLabel(); }
+    [[nodiscard]] std::chrono::steady_clock::time_point getEnqueueTime() const noexcept { return m_pState->getEnqueueTime(); }
+
+    [[nodiscard]] explicit operator bool() const noexcept { return m_pState != nullptr; }
+
+private:
+    TaskStateBase* m_pState = nullptr;
+};
+
+/**
+ * Handle to the result of a task submitted to the ThreadPool, in the same vein as std::future.
+ * Dropping it doesn't wait for the task, the task just runs without anyone looking at its result.
+ */
+template<typename T>
+class TaskFuture
+{
+public:
+    TaskFuture() noexcept = default;
+    explicit TaskFuture(TaskResult<T>* pState) noexcept
+        : m_pState(pState)
+    {}
+
+    ~TaskFuture()
+    {
+        if (m_pState)
+        {
+            m_pState->release();
+        }
+    }
+
+    TaskFuture(TaskFuture&& other) noexcept
+        : m_pState(std::exchange(other.m_pState, nullptr))
+    {}
+
+    TaskFuture& operator=(TaskFuture&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (m_pState)
+            {
+                m_pState->release();
+            }
+            m_pState = std::exchange(other.m_pState, nullptr);
+        }
+        return *this;
+    }
+
+    TaskFuture(const TaskFuture&) = delete;
+    TaskFuture& operator=(const TaskFuture&) = delete;
+
+    [[nodiscard]] bool valid() const noexcept { return m_pState != nullptr; }
+    [[nodiscard]] bool isReady() const noexcept { return m_pState && m_pState->isReady(); }
+
+    /**
+     * Block until the task has run.
+     */
+    void wait() const
+    {
+        if (!m_pState)
+        {
+            throw std::logic_error("Cannot wait on an empty TaskFuture");
+        }
+        m_pState->wait();
+    }
+
+    /**
+     * Block until the task has run, then return its result or rethrow its exception. Can only be called once.
+     */
+    T get()
+    {
+        if (!m_pState)
+        {
+            throw std::logic_error("Cannot get the result of an empty TaskFuture");
+        }
+
+        TaskResult<T>* pState = std::exchange(m_pState, nullptr);
+        struct ReleaseGuard
+        {
+            TaskResult<T>* pState;
+            ~ReleaseGuard() { pState->release(); }
+        } releaseGuard { pState };
+
+        return pState->takeResult();
+    }
+
+private:
+    TaskResult<T>* m_pState = nullptr;
+};
+
+#endif /* __POOL_TASK_H__ */
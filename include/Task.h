@@ -0,0 +1,328 @@
+#ifndef __TASK_H__
+#define __TASK_H__
+
+#include <coroutine>
+#include <atomic>
+#include <exception>
+#include <latch>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+#include <cstddef>
+
+template<typename T>
+class Task;
+
+/**
+ * Bookkeeping that every Task's promise shares, regardless of what it returns.
+ */
+class TaskPromiseBase
+{
+public:
+    /**
+     * Once the coroutine is done, hand control straight to whoever was awaiting it (if anyone).
+     */
+    struct FinalAwaiter
+    {
+        [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+        {
+            std::coroutine_handle<> continuation = handle.promise().m_continuation;
+            return continuation ? continuation : std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+    void unhandled_exception() noexcept { m_pError = std::current_exception(); }
+
+    void setContinuation(std::coroutine_handle<> continuation) noexcept { m_continuation = continuation; }
+
+protected:
+    void rethrowIfFailed_() const
+    {
+        if (m_pError)
+        {
+            std::rethrow_exception(m_pError);
+        }
+    }
+
+private:
+    std::coroutine_handle<> m_continuation;
+    std::exception_ptr m_pError;
+};
+
+template<typename T>
+class TaskPromise : public TaskPromiseBase
+{
+public:
+    Task<T> get_return_object() noexcept;
+
+    template<typename U>
+    void return_value(U&& value) { m_oValue.emplace(std::forward<U>(value)); }
+
+    T takeResult()
+    {
+        rethrowIfFailed_();
+        return std::move(*m_oValue);
+    }
+
+private:
+    std::optional<T> m_oValue;
+};
+
+template<>
+class TaskPromise<void> : public TaskPromiseBase
+{
+public:
+    Task<void> get_return_object() noexcept;
+
+    void return_void() const noexcept {}
+
+    void takeResult() const { rethrowIfFailed_(); }
+};
+
+/**
+ * Lazily-started coroutine that produces a T.
+ * Nothing runs until the task is co_awaited (or handed to whenAll / syncWait), and the awaiting coroutine picks up right where the task finishes.
+ */
+template<typename T>
+class [[nodiscard]] Task
+{
+public:
+    using promise_type = TaskPromise<T>;
+
+    Task() noexcept = default;
+    explicit Task(std::coroutine_handle<promise_type> handle) noexcept
+        : m_handle(handle)
+    {}
+
+    ~Task()
+    {
+        if (m_handle)
+        {
+            m_handle.destroy();
+        }
+    }
+
+    Task(Task&& other) noexcept
+        : m_handle(std::exchange(other.m_handle, nullptr))
+    {}
+
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (m_handle)
+            {
+                m_handle.destroy();
+            }
+            m_handle = std::exchange(other.m_handle, nullptr);
+        }
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    [[nodiscard]] bool await_ready() const noexcept { return !m_handle || m_handle.done(); }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+    {
+        m_handle.promise().setContinuation(awaiting);
+        return m_handle;
+    }
+
+    T await_resume() { return m_handle.promise().takeResult(); }
+
+private:
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+template<typename T>
+Task<T> TaskPromise<T>::get_return_object() noexcept
+{
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() noexcept
+{
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+/**
+ * Fire-and-forget coroutine that starts right away and cleans up after itself.
+ * Only used to drive Tasks from non-coroutine code; its body must not let anything escape.
+ */
+class DetachedTask
+{
+public:
+    struct promise_type
+    {
+        DetachedTask get_return_object() const noexcept { return {}; }
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        std::suspend_never final_suspend() const noexcept { return {}; }
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept { std::terminate(); }
+    };
+};
+
+/**
+ * Where syncWait's task leaves its result.
+ */
+template<typename T>
+struct SyncWaitState
+{
+    std::latch latch { 1 };
+    std::optional<T> oValue;
+    std::exception_ptr pError;
+};
+
+template<>
+struct SyncWaitState<void>
+{
+    std::latch latch { 1 };
+    std::exception_ptr pError;
+};
+
+template<typename T>
+DetachedTask syncWaitDriver(Task<T>& task, SyncWaitState<T>& state)
+{
+    try
+    {
+        if constexpr (std::is_void_v<T>)
+        {
+            co_await task;
+        }
+        else
+        {
+            state.oValue.emplace(co_await task);
+        }
+    }
+    catch (...)
+    {
+        state.pError = std::current_exception();
+    }
+
+    // syncWait may return as soon as this hits zero, so the state can't be touched afterwards
+    state.latch.count_down();
+}
+
+/**
+ * Results of whenAll's tasks, along with how many of them are still running.
+ */
+template<typename T>
+struct WhenAllState
+{
+    explicit WhenAllState(std::size_t const& numTasks)
+        : results(numTasks)
+        , numRemaining(numTasks + 1)
+    {}
+
+    std::vector<std::optional<T>> results;
+    std::atomic<std::size_t> numRemaining;
+    std::coroutine_handle<> awaiting;
+    std::mutex errorMtx;
+    std::exception_ptr pFirstError;
+};
+
+template<typename T>
+DetachedTask whenAllDriver(Task<T>& task, WhenAllState<T>& state, std::size_t const idx)
+{
+    try
+    {
+        state.results[idx].emplace(co_await task);
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(state.errorMtx);
+        if (!state.pFirstError)
+        {
+            state.pFirstError = std::current_exception();
+        }
+    }
+
+    if (state.numRemaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        state.awaiting.resume();
+    }
+}
+
+/**
+ * Starts every task, and only lets the awaiting coroutine carry on once the last of them has finished.
+ * numRemaining starts one higher than the number of tasks so that tasks finishing while they're still being started can't resume it early.
+ */
+template<typename T>
+struct WhenAllAwaiter
+{
+    std::vector<Task<T>>& tasks;
+    WhenAllState<T>& state;
+
+    [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> awaiting)
+    {
+        state.awaiting = awaiting;
+        for (std::size_t i = 0; i < tasks.size(); ++i)
+        {
+            whenAllDriver(tasks[i], state, i);
+        }
+        return state.numRemaining.fetch_sub(1, std::memory_order_acq_rel) != 1;
+    }
+
+    void await_resume() const noexcept {}
+};
+
+/**
+ * Run every task concurrently, and return their results in the same order.
+ * Waits for all of them even if some fail, then rethrows the first error.
+ */
+template<typename T>
+Task<std::vector<T>> whenAll(std::vector<Task<T>> tasks)
+{
+    WhenAllState<T> state(tasks.size());
+    co_await WhenAllAwaiter<T>{ tasks, state };
+
+    if (state.pFirstError)
+    {
+        std::rethrow_exception(state.pFirstError);
+    }
+
+    std::vector<T> results;
+    results.reserve(state.results.size());
+    for (auto& oResult : state.results)
+    {
+        results.push_back(std::move(*oResult));
+    }
+
+    co_return results;
+}
+
+/**
+ * Block the calling thread until the task is done, and return its result.
+ * The task starts on this thread and carries on wherever it gets resumed (e.g. on a ThreadPool worker).
+ */
+template<typename T>
+T syncWait(Task<T> task)
+{
+    SyncWaitState<T> state;
+    syncWaitDriver(task, state);
+    state.latch.wait();
+
+    if (state.pError)
+    {
+        std::rethrow_exception(state.pError);
+    }
+
+    if constexpr (!std::is_void_v<T>)
+    {
+        return std::move(*state.oValue);
+    }
+}
+
+#endif /* __TASK_H__ */
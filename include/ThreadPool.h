@@ -1,142 +1,311 @@
 #ifndef __THREAD_POOL_H__
 #define __THREAD_POOL_H__
 
+#include "PoolTask.h"
+#include "ThreadPoolStats.h"
+
 #include <vector>
-#include <queue>
+#include <deque>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
-#include <functional>
-#include <future>
 #include <memory>
 #include <stdexcept>
+#include <atomic>
 #include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <algorithm>
+#include <coroutine>
+#include <string>
+#include <array>
+
+/**
+ * Which lane of the ThreadPool's queues a task waits in.
+ * Interactive is for user-facing work that shouldn't sit behind a job's batch of thousands of tasks.
+ */
+enum class TaskPriority
+{
+    Interactive,
+    Batch
+};
 
+/**
+ * Work-stealing thread pool.
+ * Each worker has its own deque: tasks submitted from a worker go onto its own deque and are popped LIFO,
+ * while idle workers steal FIFO from the others. Tasks submitted from outside the pool go into a shared queue instead, which workers
+ * take from (FIFO, in the order they were submitted) once their own deque is empty, before they try stealing.
+ * Tasks submitted under a label (see LabelScope) are timed, and their samples kept until collected with takeStats.
+ *
+ * Every deque has a lane per TaskPriority. Workers take interactive tasks first (their own, then stolen), but after a run of them
+ * take a batch task if there is one, so that a steady stream of interactive work can't starve the batch lane.
+ *
+ * If queueCapacity isn't 0, submitting from outside the pool blocks while that many tasks are queued up, so that producers can't run
+ * far ahead of the workers. Submits from the workers themselves (e.g. a task's nested parallelFor) never wait, since that could deadlock the pool.
+ */
 class ThreadPool
 {
 public:
-    explicit ThreadPool(
-        std::size_t numThreads = std::thread::hardware_concurrency())
-        : m_stop(false)
-    {
-        if (numThreads == 0)
-        {
-            numThreads = 1;
-        }
+    explicit ThreadPool(std::size_t numThreads = std::thread::hardware_concurrency(), std::size_t const& queueCapacity = 0);
+    ~ThreadPool();
 
-        m_workers.reserve(numThreads);
-        for (std::size_t i = 0; i < numThreads; ++i)
-        {
-            m_workers.emplace_back(
-            [this]
-            {
-                workerThread_();
-            });
-        }
-    }
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
 
-    ~ThreadPool()
+    /**
+     * Labels every task submitted from the current thread while in scope.
+     * Tasks that are submitted from inside a labelled task (e.g. parallelFor chunks) inherit its label.
+     */
+    class LabelScope
     {
-        shutdown();
-    }
+    public:
+        explicit LabelScope(std::string const& label)
+            : LabelScope(internLabel(label))
+        {}
 
-    ThreadPool(const ThreadPool&) = delete;
-    ThreadPool& operator=(const ThreadPool&) = delete;
+        /**
+         * pLabel has to outlive every task submitted under it, e.g. a string literal or something from internLabel.
+         */
+        explicit LabelScope(char const* pLabel) noexcept
+            : m_pPrevLabel(std::exchange(t_pLabel, pLabel))
+        {}
+
+        ~LabelScope() { t_pLabel = m_pPrevLabel; }
+
+        LabelScope(const LabelScope&) = delete;
+        LabelScope& operator=(const LabelScope&) = delete;
+
+    private:
+        char const* m_pPrevLabel;
+    };
+
+    [[nodiscard]] static char const* internLabel(std::string const& label);
+    [[nodiscard]] static char const* currentLabel() noexcept { return t_pLabel; }
 
     /**
-     * Submit task to thread pool.
+     * Get the priority that tasks submitted from the current thread get by default: that of the task running on it, or else batch.
+     */
+    [[nodiscard]] static TaskPriority currentPriority() noexcept { return t_priority; }
+
+    /**
+     * Submit task to thread pool, with the same priority as whatever is submitting it.
+     * The callable and its arguments are moved (or copied, if given lvalues) into the task, and passed along as rvalues when it runs.
      */
     template<typename F, typename... Args>
-    auto submit(F&& f, Args&&... args) -> std::future<typename std::invoke_result<F, Args...>::type>
+    auto submit(F&& f, Args&&... args) -> TaskFuture<std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>>
     {
-        using ReturnType = typename std::invoke_result<F, Args...>::type;
+        return submit(t_priority, std::forward<F>(f), std::forward<Args>(args)...);
+    }
 
-        auto task = std::make_shared<std::packaged_task<ReturnType()>>(
-            std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+    /**
+     * Submit task to thread pool in the given lane. Anything the task submits itself inherits its priority.
+     * Interactive tasks never wait for room in the queues.
+     */
+    template<typename F, typename... Args>
+    auto submit(TaskPriority const& priority, F&& f, Args&&... args) -> TaskFuture<std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>>
+    {
+        using ReturnType = std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>;
+        using State = TaskState<ReturnType, std::decay_t<F>, std::decay_t<Args>...>;
 
-        std::future<ReturnType> result = task->get_future();
+        auto* pState = new State(std::forward<F>(f), std::forward<Args>(args)...);
+        TaskFuture<ReturnType> result(pState);
+        enqueue_(PoolTask(pState), priority, priority == TaskPriority::Batch);
 
-        {
-            std::unique_lock<std::mutex> lock(m_queueMtx);
+        return result;
+    }
 
-            if (m_stop)
-            {
-                throw std::runtime_error("Cannot submit task to stopped ThreadPool");
-            }
+    /**
+     * Submit f(arg) for every arg in argsList, pushing all of the tasks onto the queues at once (or as many at a time as there's room for).
+     */
+    template<typename F, typename T>
+    auto submitBulk(F const& f, std::vector<T> argsList) -> std::vector<TaskFuture<std::invoke_result_t<F, T>>>
+    {
+        using ReturnType = std::invoke_result_t<F, T>;
+        using State = TaskState<ReturnType, F, T>;
 
-            m_tasks.emplace([task]()
-            {
-                (*task)();
-            });
+        std::vector<TaskFuture<ReturnType>> results;
+        results.reserve(argsList.size());
+        std::vector<PoolTask> tasks;
+        tasks.reserve(argsList.size());
+        for (auto& arg : argsList)
+        {
+            auto* pState = new State(f, std::move(arg));
+            results.emplace_back(pState);
+            tasks.emplace_back(pState);
         }
+        enqueueBulk_(std::move(tasks));
 
-        m_condition.notify_one();
-        return result;
+        return results;
     }
 
     /**
-     * Stop all threads in pool.
+     * Call fn(i) for every i in [begin, end), split into chunks of grainSize indices (by default, enough for ~4 chunks per worker).
+     * Blocks until every chunk is done. If any call throws, the chunks that haven't started are skipped and the first error is rethrown.
      */
-    void shutdown()
+    template<typename F>
+    void parallelFor(std::size_t const& begin, std::size_t const& end, F const& fn, std::size_t grainSize = 0)
     {
+        if (begin >= end)
         {
-            std::unique_lock<std::mutex> lock(m_queueMtx);
-            if (m_stop)
-            {
-                return;
-            }
-            m_stop = true;
+            return;
         }
 
-        m_condition.notify_all();
+        std::size_t numIndices = end - begin;
+        if (grainSize == 0)
+        {
+            grainSize = std::max(numIndices / (getThreadCount() * k_chunksPerWorker), static_cast<std::size_t>(1));
+        }
+        std::size_t numChunks = (numIndices + grainSize - 1) / grainSize;
 
-        for (std::thread& worker : m_workers)
+        BulkTaskGroup group(static_cast<std::ptrdiff_t>(numChunks));
+        std::vector<PoolTask> tasks;
+        tasks.reserve(numChunks);
+        for (std::size_t chunkBegin = begin; chunkBegin < end; chunkBegin += grainSize)
         {
-            if (worker.joinable())
+            std::size_t chunkEnd = std::min(chunkBegin + grainSize, end);
+            auto chunkFn = [&fn, chunkBegin, chunkEnd](BulkTaskGroup const& chunkGroup)
             {
-                worker.join();
-            }
+                for (std::size_t i = chunkBegin; (i < chunkEnd) && !chunkGroup.hasFailed(); ++i)
+                {
+                    fn(i);
+                }
+            };
+            tasks.emplace_back(new BulkTaskState<decltype(chunkFn)>(group, std::move(chunkFn)));
         }
+        enqueueBulk_(std::move(tasks));
+
+        group.waitAndRethrow();
     }
 
+    /**
+     * Return fn(input) for every input, in the same order, computed with parallelFor.
+     */
+    template<typename T, typename F>
+    auto parallelTransform(std::vector<T> const& inputs, F const& fn, std::size_t const& grainSize = 0) -> std::vector<std::invoke_result_t<F const&, T const&>>
+    {
+        using ReturnType = std::invoke_result_t<F const&, T const&>;
+        static_assert(std::is_default_constructible_v<ReturnType>, "parallelTransform writes into a preallocated vector");
+
+        std::vector<ReturnType> results(inputs.size());
+        parallelFor(0, inputs.size(),
+        [&inputs, &fn, &results](std::size_t const& i)
+        {
+            results[i] = fn(inputs[i]);
+        }, grainSize);
+
+        return results;
+    }
+
+    /**
+     * Awaitable that moves the awaiting coroutine onto one of the pool's workers.
+     */
+    struct ScheduleAwaiter
+    {
+        ThreadPool& pool;
+
+        [[nodiscard]] bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) { pool.resume(handle); }
+        void await_resume() const noexcept {}
+    };
+
+    [[nodiscard]] ScheduleAwaiter schedule() noexcept { return ScheduleAwaiter{ *this }; }
+    void resume(std::coroutine_handle<> handle, char const* pLabel = currentLabel());
+
+    /**
+     * Awaitable that suspends the awaiting coroutine while the queues are full, instead of blocking its thread like submit does.
+     * It's resumed on one of the workers once a task is taken off the queues.
+     */
+    struct CapacityAwaiter
+    {
+        ThreadPool& pool;
+
+        [[nodiscard]] bool await_ready() const noexcept { return !pool.isFull_(); }
+        bool await_suspend(std::coroutine_handle<> handle) { return pool.addCapacityAwaiter_(handle); }
+        void await_resume() const noexcept {}
+    };
+
+    [[nodiscard]] CapacityAwaiter waitForCapacity() noexcept { return CapacityAwaiter{ *this }; }
+
+    [[nodiscard]] ThreadPoolStats takeStats(std::string const& labelPrefix);
+
+    void shutdown();
+
     /**
      * Get number of working threads.
      */
     [[nodiscard]] std::size_t getThreadCount() const noexcept { return m_workers.size(); }
 
+    /**
+     * Check whether the current thread is one of this pool's workers.
+     */
+    [[nodiscard]] bool isWorkerThread() const noexcept { return t_pWorkerPool == this; }
+
+    /**
+     * Get how many tasks can be queued up before submits from outside the pool block (0 = unbounded).
+     */
+    [[nodiscard]] std::size_t getQueueCapacity() const noexcept { return m_queueCapacity; }
+
 private:
-    void workerThread_()
-    {
-        while (true)
-        {
-            std::function<void()> task;
-            {
-                std::unique_lock<std::mutex> lock(m_queueMtx);
+    static constexpr std::size_t k_numPriorities = 2;
 
-                m_condition.wait(lock,
-                [this]
-                {
-                    return m_stop || !m_tasks.empty();
-                });
+    struct WorkerQueue_
+    {
+        std::mutex mtx;
+        std::array<std::deque<PoolTask>, k_numPriorities> lanes;
+    };
 
-                if (m_stop && m_tasks.empty())
-                {
-                    return;
-                }
+    struct WorkerStats_
+    {
+        std::mutex mtx;
+        std::vector<TaskSample> samples;
+    };
 
-                task = std::move(m_tasks.front());
-                m_tasks.pop();
-            }
+    static constexpr std::size_t k_chunksPerWorker = 4;
+    static constexpr std::size_t k_maxConsecutiveInteractiveTasks = 8;
 
-            task();
-        }
-    }
+    void enqueue_(PoolTask task, TaskPriority const& priority, bool const& bWaitForCapacity);
+    void enqueueBulk_(std::vector<PoolTask> tasks);
+    [[nodiscard]] bool pushBulk_(std::vector<PoolTask>::iterator begin, std::vector<PoolTask>::iterator end, TaskPriority const& priority);
+    [[nodiscard]] bool countQueuedTasks_(std::size_t const& numTasks, TaskPriority const& priority);
+    void notifySleepers_(std::size_t const& numTasks);
+    [[nodiscard]] bool isFull_() const noexcept;
+    [[nodiscard]] std::size_t waitForCapacity_();
+    [[nodiscard]] bool addCapacityAwaiter_(std::coroutine_handle<> handle);
+    void releaseCapacityWaiters_();
+    [[nodiscard]] bool popTask_(std::size_t const& workerIdx, bool const& bPreferBatch, PoolTask& task /* out */, TaskPriority& priority /* out */);
+    [[nodiscard]] bool popLaneTask_(std::size_t const& workerIdx, TaskPriority const& priority, PoolTask& task /* out */);
+    void runTask_(std::size_t const& workerIdx, PoolTask& task, TaskPriority const& priority);
+    void workerThread_(std::size_t const& workerIdx);
 
+    std::vector<std::unique_ptr<WorkerQueue_>> m_queues;
+    WorkerQueue_ m_externalQueue;
+    std::vector<std::unique_ptr<WorkerStats_>> m_workerStats;
     std::vector<std::thread> m_workers;
-    std::queue<std::function<void()>> m_tasks;
-    std::mutex m_queueMtx;
+
+    // Workers only sleep on this when every deque is empty, so submits don't contend on it
+    std::mutex m_sleepMtx;
     std::condition_variable m_condition;
-    bool m_stop;
+    std::atomic<std::size_t> m_numQueuedTasks;
+    std::atomic<std::size_t> m_numQueuedInteractiveTasks;
+    std::atomic<std::size_t> m_numSleepingWorkers;
+    std::atomic<bool> m_stop;
+
+    // Producers waiting for room in the queues, either blocked in a submit or suspended on a CapacityAwaiter
+    std::size_t m_queueCapacity;
+    std::mutex m_capacityMtx;
+    std::condition_variable m_capacityCondition;
+    std::deque<std::pair<std::coroutine_handle<>, char const*>> m_capacityAwaiters;
+    std::atomic<std::size_t> m_numCapacityWaiters;
+
+    // Which pool (if any) the current thread works for, so that submits from workers stay on their own deque
+    static inline thread_local ThreadPool* t_pWorkerPool = nullptr;
+    static inline thread_local std::size_t t_workerIdx = 0;
+
+    // Label that tasks submitted from the current thread are queued under
+    static inline thread_local char const* t_pLabel = nullptr;
+
+    // Priority that tasks submitted from the current thread get by default
+    static inline thread_local TaskPriority t_priority = TaskPriority::Batch;
 };
 
 #endif /* __THREAD_POOL_H__ */
@@ -0,0 +1,44 @@
+#ifndef __THREAD_POOL_STATS_H__
+#define __THREAD_POOL_STATS_H__
+
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+/**
+ * A labelled task that ran on the ThreadPool: when it was queued, started and finished, on which worker,
+ * and how many tasks were still queued up when it started.
+ */
+struct TaskSample
+{
+    char const* pLabel = nullptr;
+    std::size_t workerIdx = 0;
+    std::size_t queueDepth = 0;
+    std::chrono::steady_clock::time_point enqueueTime;
+    std::chrono::steady_clock::time_point startTime;
+    std::chrono::steady_clock::time_point endTime;
+};
+
+/**
+ * Samples of the tasks that a job ran on the ThreadPool, e.g. to tell whether IO_THREAD_COUNT is too low (tasks wait long in deep queues)
+ * or too high (workers sit idle).
+ */
+class ThreadPoolStats
+{
+public:
+    ThreadPoolStats(std::size_t const& numWorkers, std::vector<TaskSample> samples);
+
+    [[nodiscard]] bool empty() const noexcept { return m_samples.empty(); }
+    [[nodiscard]] std::vector<TaskSample> const& getSamples() const noexcept { return m_samples; }
+
+    void logSummary(std::string const& name) const;
+    void exportCsv(std::filesystem::path const& filePath, std::string const& name) const;
+
+private:
+    std::size_t m_numWorkers;
+    std::vector<TaskSample> m_samples;
+};
+
+#endif /* __THREAD_POOL_STATS_H__ */
@@ -0,0 +1,86 @@
+#ifndef __TIMER_SERVICE_H__
+#define __TIMER_SERVICE_H__
+
+#include "ThreadPool.h"
+#include "CancellationToken.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Resumes coroutines once their delay is up, so that waiting to retry (e.g. backing off after a 429) never parks a ThreadPool worker.
+ * A single thread sleeps until the earliest deadline in a min-heap, then hands the due coroutines to the ThreadPool as ordinary tasks.
+ */
+class TimerService
+{
+public:
+    explicit TimerService(std::shared_ptr<ThreadPool> pThreadPool);
+    ~TimerService() noexcept;
+
+    TimerService(const TimerService&) = delete;
+    TimerService& operator=(const TimerService&) = delete;
+
+    /**
+     * Awaitable that resumes the awaiting coroutine after a delay, or as soon as the token is cancelled.
+     */
+    class SleepAwaiter
+    {
+    public:
+        SleepAwaiter(TimerService& timerService, std::chrono::milliseconds const& delay, std::shared_ptr<CancellationToken> pCancelToken);
+
+        [[nodiscard]] bool await_ready() const noexcept { return (m_delay.count() <= 0) && !m_pCancelToken->isCancelled(); }
+        void await_suspend(std::coroutine_handle<> handle);
+        void await_resume() const { m_pCancelToken->throwIfCancelled(); }
+
+    private:
+        TimerService& m_timerService;
+        std::chrono::milliseconds m_delay;
+        std::shared_ptr<CancellationToken> m_pCancelToken;
+    };
+
+    [[nodiscard]] SleepAwaiter sleepFor(std::chrono::milliseconds const& delay, std::shared_ptr<CancellationToken> pCancelToken);
+
+private:
+    struct Timer_
+    {
+        std::chrono::steady_clock::time_point deadline;
+        uint64_t seq = 0;
+        std::coroutine_handle<> handle;
+        char const* pLabel = nullptr;
+        std::shared_ptr<CancellationToken> pCancelToken;
+    };
+
+    /**
+     * Orders the heap so that the earliest deadline (and, among equal ones, the earliest timer) is on top.
+     */
+    struct TimerLater_
+    {
+        bool operator()(Timer_ const& lhs, Timer_ const& rhs) const noexcept
+        {
+            return (lhs.deadline != rhs.deadline) ? (lhs.deadline > rhs.deadline) : (lhs.seq > rhs.seq);
+        }
+    };
+
+    void addTimer_(std::chrono::steady_clock::time_point const& deadline, std::coroutine_handle<> handle, std::shared_ptr<CancellationToken> pCancelToken);
+    void timerThread_();
+    void takeDueTimers_(std::vector<Timer_>& dueTimers /* out */);
+    void resume_(std::coroutine_handle<> handle, char const* pLabel);
+
+    std::shared_ptr<ThreadPool> m_pThreadPool;
+
+    std::mutex m_mtx;
+    std::condition_variable m_condition;
+    std::vector<Timer_> m_timers;
+    uint64_t m_nextSeq;
+    bool m_bStop;
+
+    std::thread m_timerThread;
+};
+
+#endif /* __TIMER_SERVICE_H__ */
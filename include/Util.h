@@ -24,13 +24,17 @@
 constexpr int k_curlRetryWaitMs = 30000;
 
 constexpr std::size_t k_batchMaxIDs = 50;
+constexpr std::size_t k_userScoresMaxLimit = 100;
 constexpr std::size_t k_getRankingIDMaxPage = 200;
+constexpr std::size_t k_numRankingsUsers = k_getRankingIDMaxPage * k_batchMaxIDs;
 
 constexpr std::size_t k_numDisplayUsersTop = 15;
 constexpr std::size_t k_numDisplayUsersBottom = 5;
 constexpr std::size_t k_numDisplayUsers = std::max(k_numDisplayUsersTop, k_numDisplayUsersBottom);
+constexpr std::size_t k_numDisplayUsernameChanges = 3;
 
-constexpr std::size_t k_numTopPlays = 1000;
+constexpr std::size_t k_defaultNumTopPlays = 1000;
+constexpr std::size_t k_topPlaysChunkSize = 500;
 constexpr std::size_t k_numDisplayTopPlays = 5;
 
 const std::string k_defaultDate = "0000-00-00T00:00:00Z";
@@ -76,6 +80,7 @@ const std::string k_topPlaysSelectModeButtonID = "tp_select_mode_button";
 const std::string k_topPlaysSelectModeModalID = "tp_select_mode_modal";
 const std::string k_topPlaysSelectModeTextInputID = "tp_select_mode_text_input";
 const std::string k_topPlaysResetAllButtonID = "tp_reset_all_button";
+const std::string k_topPlaysTogglePeriodButtonID = "tp_toggle_period_button";
 
 const std::pair<std::string, std::string> k_newsletterPageOptionScrapeRankings = std::make_pair("Rank Increases", "Rank Increases");
 const std::pair<std::string, std::string> k_newsletterPageOptionTopPlays = std::make_pair("Top Plays", "Top Plays");
@@ -325,6 +330,18 @@ public:
         }
     }
 
+    /**
+     * Country rankings are scraped past the global top 10k, so the last range is left open when filtering by country.
+     */
+    [[nodiscard]] std::pair<int64_t, int64_t> toRange(std::string const& countryCode) const noexcept
+    {
+        if ((countryCode != k_global) && (m_value == Value::Third))
+        {
+            return std::make_pair(mk_thirdRange.first, INT64_MAX);
+        }
+        return toRange();
+    }
+
     [[nodiscard]] Value getValue() const noexcept { return m_value; }
 
 private:
@@ -525,11 +542,13 @@ public:
         std::optional<std::string> const& countryCode,
         std::optional<RankRange> const& rankRange,
         std::optional<Gamemode> const& gamemode,
-        std::optional<OsuMods> const& mods) noexcept
+        std::optional<OsuMods> const& mods,
+        std::optional<int> const& periodDays = std::nullopt) noexcept
     : m_oCountryCode(countryCode)
     , m_oRankRange(rankRange)
     , m_oGamemode(gamemode)
     , m_oMods(mods)
+    , m_oPeriodDays(periodDays)
     {}
 
     EmbedMetadata(std::string const& metadataString)
@@ -540,6 +559,7 @@ public:
         std::regex rankRangeRegex = toRegex_(mk_rankRangeKey);
         std::regex gamemodeRegex = toRegex_(mk_gamemodeKey);
         std::regex modsRegex = toRegex_(mk_modsKey);
+        std::regex periodRegex = toRegex_(mk_periodKey);
 
         if ((std::regex_search(metadataString, matches, countryRegex)) && (matches.size() > 1))
         {
@@ -561,6 +581,10 @@ public:
         {
             m_oMods = OsuMods(matches[1].str());
         }
+        if ((std::regex_search(metadataString, matches, periodRegex)) && (matches.size() > 1))
+        {
+            m_oPeriodDays = std::stoi(matches[1].str());
+        }
     }
 
     EmbedMetadata(EmbedMetadata const& other) noexcept
@@ -568,6 +592,7 @@ public:
     , m_oRankRange(other.m_oRankRange)
     , m_oGamemode(other.m_oGamemode)
     , m_oMods(other.m_oMods)
+    , m_oPeriodDays(other.m_oPeriodDays)
     {}
 
     ~EmbedMetadata() = default;
@@ -580,6 +605,7 @@ public:
             m_oRankRange = other.m_oRankRange;
             m_oGamemode = other.m_oGamemode;
             m_oMods = other.m_oMods;
+            m_oPeriodDays = other.m_oPeriodDays;
         }
         return *this;
     }
@@ -588,6 +614,7 @@ public:
     [[nodiscard]] RankRange getRankRange() const noexcept { return (m_oRankRange.has_value() ? m_oRankRange.value() : RankRange()); }
     [[nodiscard]] Gamemode getGamemode() const noexcept { return (m_oGamemode.has_value() ? m_oGamemode.value() : Gamemode()); }
     [[nodiscard]] OsuMods getMods() const noexcept { return (m_oMods.has_value() ? m_oMods.value() : k_allMods); }
+    [[nodiscard]] int getPeriodDays() const noexcept { return (m_oPeriodDays.has_value() ? m_oPeriodDays.value() : 1); }
 
     [[nodiscard]] std::string toEmbedString() const
     {
@@ -614,6 +641,11 @@ public:
             if (!ret.empty()) ret += "\n";
             ret += toTag_(mk_modsKey, m_oMods.value().toString());
         }
+        if (m_oPeriodDays.has_value())
+        {
+            if (!ret.empty()) ret += "\n";
+            ret += toTag_(mk_periodKey, std::to_string(m_oPeriodDays.value()));
+        }
 
         return ret;
     }
@@ -623,11 +655,13 @@ private:
     std::optional<RankRange> m_oRankRange = std::nullopt;
     std::optional<Gamemode> m_oGamemode = std::nullopt;
     std::optional<OsuMods> m_oMods = std::nullopt;
+    std::optional<int> m_oPeriodDays = std::nullopt;
 
     std::string const mk_countryKey = "COUNTRY";
     std::string const mk_rankRangeKey = "RANGE";
     std::string const mk_gamemodeKey = "GAMEMODE";
     std::string const mk_modsKey = "MODS";
+    std::string const mk_periodKey = "DAYS";
 
     [[nodiscard]] std::string toTag_(std::string const& key, std::string const& val) const noexcept { return "`" + key + ": " + val + "`"; }
     [[nodiscard]] std::regex toRegex_(std::string const& key) const noexcept { return std::regex("`" + key + ": (.*)`"); }
@@ -653,6 +687,7 @@ typedef double StarRating;
 typedef std::string DifficultyName;
 typedef std::string BeatmapArtist;
 typedef std::string BeatmapTitle;
+typedef std::string BeatmapStatus;
 
 struct RankingsUser
 {
@@ -687,6 +722,16 @@ struct RankImprovement
     double relativeImprovement;
 };
 
+struct UsernameChange
+{
+    UserID userID = -1;
+    Username oldUsername = "";
+    Username newUsername = "";
+    CountryCode countryCode = "";
+    ProfilePicture pfpLink = "";
+    Rank currentRank = -1;
+};
+
 struct Beatmap
 {
     BeatmapID beatmapID = -1;
@@ -728,7 +773,6 @@ struct TopPlay
     {
         return (
             (rank > 0) &&
-            (rank <= static_cast<int64_t>(k_numTopPlays)) &&
             (score.performancePoints >= 0.) &&
             (score.totalScore > 0) &&
             (score.createdAt.toString() != k_defaultDate) &&
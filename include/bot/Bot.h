@@ -5,6 +5,7 @@
 #include "TopPlaysDatabase.h"
 #include "BotConfigDatabase.h"
 #include "EmbedGenerator.h"
+#include "ThreadPool.h"
 #include "Util.h"
 
 #include <dpp/dpp.h>
@@ -16,6 +17,7 @@
 #include <atomic>
 #include <mutex>
 #include <memory>
+#include <functional>
 
 constexpr std::chrono::seconds k_cmdRateLimitPeriod = std::chrono::seconds(2);
 constexpr std::chrono::seconds k_interactionRateLimitPeriod = std::chrono::seconds(1);
@@ -34,7 +36,12 @@ const std::string k_newsletterPageOptionName = "page";
 class Bot
 {
 public:
-    Bot(std::string const& botToken, std::shared_ptr<RankingsDatabase> pRankingsDb, std::shared_ptr<TopPlaysDatabase> pTopPlaysDb, std::shared_ptr<BotConfigDatabase> pBotConfigDb);
+    Bot(
+        std::string const& botToken,
+        std::shared_ptr<RankingsDatabase> pRankingsDb,
+        std::shared_ptr<TopPlaysDatabase> pTopPlaysDb,
+        std::shared_ptr<BotConfigDatabase> pBotConfigDb,
+        std::shared_ptr<ThreadPool> pThreadPool);
     ~Bot();
 
     void start();
@@ -48,6 +55,7 @@ private:
     void onSlashCommand_(dpp::slashcommand_t const& event);
     void onButtonClick_(dpp::button_click_t const& event);
     void onFormSubmit_(dpp::form_submit_t const& event);
+    void runInteractive_(std::function<void()> handler);
 
     void onCompletion_(dpp::confirmation_callback_t const& callback, std::string const& customID) const;
     void onCompletionReply_(dpp::confirmation_callback_t const& callback, std::string const& customID, dpp::interaction_create_t const& event) const;
@@ -62,13 +70,14 @@ private:
 
     void buildStaticComponents_();
     [[nodiscard]] bool buildScrapeRankingsNewsletter_(std::string const& countryCode, RankRange const& rankRange, Gamemode const& mode, dpp::message& message /* out */);
-    [[nodiscard]] bool buildTopPlaysNewsletter_(std::string const& countryCode, Gamemode const& mode, std::string const& mods, dpp::message& message /* out */);
+    [[nodiscard]] bool buildTopPlaysNewsletter_(std::string const& countryCode, Gamemode const& mode, std::string const& mods, int const& periodDays, dpp::message& message /* out */);
 
     dpp::cluster m_bot;
     std::unique_ptr<EmbedGenerator> m_pEmbedGenerator = std::make_unique<EmbedGenerator>();
     std::shared_ptr<RankingsDatabase> m_pRankingsDb;
     std::shared_ptr<TopPlaysDatabase> m_pTopPlaysDb;
     std::shared_ptr<BotConfigDatabase> m_pBotConfigDb;
+    std::shared_ptr<ThreadPool> m_pThreadPool;
     std::atomic<bool> m_bIsInitialized;
 
     const std::unordered_map<std::string, std::function<void(Bot*, const dpp::slashcommand_t&)>> m_kCommandMap = {
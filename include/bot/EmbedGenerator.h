@@ -36,12 +36,14 @@ public:
         RankRange const& rankRange,
         Gamemode const& mode,
         std::vector<RankImprovement> const& top,
-        std::vector<RankImprovement> const& bottom) const;
+        std::vector<RankImprovement> const& bottom,
+        std::vector<UsernameChange> const& usernameChanges) const;
     [[nodiscard]] dpp::embed topPlaysEmbed(
         std::vector<TopPlay> const& topPlays,
         Gamemode const& mode,
         std::string const& countryCode,
-        std::string const& mods) const;
+        std::string const& mods,
+        int const& periodDays) const;
 
     [[nodiscard]] dpp::component scrapeRankingsActionRow1() const;
     [[nodiscard]] dpp::component scrapeRankingsActionRow2() const;
@@ -59,6 +61,10 @@ private:
         std::vector<RankImprovement> const& players,
         bool const& bIsTop,
         Gamemode const& mode) const noexcept;
+    void addUsernameChangesToDescription_(
+        std::stringstream& description /* out */,
+        std::vector<UsernameChange> const& usernameChanges,
+        Gamemode const& mode) const noexcept;
     void addPlayersToTopPlaysDescription_(
         std::stringstream& description /* out */,
         std::vector<TopPlay> const& topPlays,
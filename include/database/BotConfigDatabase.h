@@ -30,6 +30,8 @@ public:
     void addSubscription(dpp::snowflake const& channelID, std::string const& newsletterPage);
     void removeSubscription(dpp::snowflake const& channelID, std::string const& newsletterPage);
     [[nodiscard]] bool isChannelSubscribed(dpp::snowflake const& channelID, std::string const& newsletterPage);
+    void recordCountryFilterUsage(std::string const& countryCode);
+    [[nodiscard]] std::unordered_map<std::string, int64_t> getCountryFilterUsage();
 
 private:
     [[nodiscard]] bool channelExists_(dpp::snowflake const& channelID);
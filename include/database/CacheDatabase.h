@@ -0,0 +1,47 @@
+#ifndef __CACHE_DATABASE_MANAGER_H__
+#define __CACHE_DATABASE_MANAGER_H__
+
+#include "Util.h"
+
+#include <SQLiteCpp/SQLiteCpp.h>
+
+#include <filesystem>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <utility>
+#include <chrono>
+#include <cstdint>
+
+constexpr std::chrono::hours k_rankedBeatmapTtl = std::chrono::hours(24 * 30);
+constexpr std::chrono::hours k_lovedBeatmapTtl = std::chrono::hours(24 * 7);
+constexpr std::chrono::hours k_unrankedBeatmapTtl = std::chrono::hours(24);
+constexpr std::chrono::hours k_userProfileMaxAge = std::chrono::hours(26);
+
+/**
+ * SQLiteCpp wrapper for data that is reused across days and jobs (e.g. beatmap metadata, user profiles, staged rankings pages).
+ */
+class CacheDatabase
+{
+public:
+    CacheDatabase(std::filesystem::path const& dbFilePath);
+    ~CacheDatabase();
+
+    [[nodiscard]] std::unordered_map<BeatmapID, Beatmap> getBeatmaps(std::vector<BeatmapID> const& beatmapIDs);
+    void upsertBeatmaps(std::vector<std::pair<Beatmap, BeatmapStatus>> const& beatmaps);
+    [[nodiscard]] std::unordered_map<UserID, RankingsUser> getUserProfiles(std::vector<UserID> const& userIDs, Gamemode const& mode);
+    void upsertUserProfiles(std::vector<RankingsUser> const& users, Gamemode const& mode);
+    void replaceStagingPage(Page const& page, std::vector<RankingsUser> const& rankingsUsers, Gamemode const& mode);
+    [[nodiscard]] std::pair<Page, int64_t> getStalestStagingPage(Gamemode const& mode);
+    [[nodiscard]] std::vector<Page> getStaleStagingPages(std::chrono::hours const& maxAge, Gamemode const& mode);
+    [[nodiscard]] std::vector<RankingsUser> getStagingRankingsUsers(Gamemode const& mode);
+
+private:
+    void createTables_();
+
+    std::unique_ptr<SQLite::Database> m_pDatabase;
+    std::filesystem::path m_dbFilePath;
+    std::mutex m_dbMtx;
+};
+
+#endif /* __CACHE_DATABASE_MANAGER_H__ */
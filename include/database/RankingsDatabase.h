@@ -6,6 +6,8 @@
 #include <SQLiteCpp/SQLiteCpp.h>
 
 #include <filesystem>
+#include <chrono>
+#include <string>
 #include <vector>
 #include <mutex>
 #include <cstdint>
@@ -19,6 +21,22 @@ const std::unordered_map<Gamemode, std::string> k_modeToRankingsTable = {
     { Gamemode::Catch, "CatchRankings" }
 };
 
+const std::unordered_map<Gamemode, std::string> k_modeToCountryRankingsTable = {
+    { Gamemode::Osu, "OsuCountryRankings" },
+    { Gamemode::Taiko, "TaikoCountryRankings" },
+    { Gamemode::Mania, "ManiaCountryRankings" },
+    { Gamemode::Catch, "CatchCountryRankings" }
+};
+
+const std::unordered_map<Gamemode, std::string> k_modeToUsernameChangesTable = {
+    { Gamemode::Osu, "OsuUsernameChanges" },
+    { Gamemode::Taiko, "TaikoUsernameChanges" },
+    { Gamemode::Mania, "ManiaUsernameChanges" },
+    { Gamemode::Catch, "CatchUsernameChanges" }
+};
+
+const std::string k_rankingsMetadataTable = "RankingsMetadata";
+
 /**
  * SQLiteCpp wrapper for rankings tables.
  */
@@ -28,13 +46,14 @@ public:
     RankingsDatabase(std::filesystem::path const& dbFilePath);
     ~RankingsDatabase();
 
-    [[nodiscard]] std::filesystem::file_time_type lastWriteTime();
+    [[nodiscard]] std::chrono::system_clock::time_point lastScrapeTime();
+    void setLastScrapeTime(std::chrono::system_clock::time_point const& scrapeTime);
     void wipeTables();
-    void shiftRanks(Gamemode const& mode);
-    void insertRankingsUsers(std::vector<RankingsUser> const& rankingsUsers, Gamemode const& mode);
-    void deleteUsersWithNullCurrentRank(Gamemode const& mode);
-    [[nodiscard]] std::vector<UserID> getUserIDsWithNullYesterdayRank(Gamemode const& mode);
+    [[nodiscard]] std::vector<UserID> applyRankingsSnapshot(std::vector<RankingsUser> const& rankingsUsers, Gamemode const& mode);
     void updateYesterdayRanks(std::vector<std::pair<UserID, Rank>> const& userYesterdayRanks, Gamemode const& mode);
+    [[nodiscard]] std::vector<std::pair<UserID, Rank>> getCurrentRanks(Gamemode const& mode);
+    void applyCountryRankingsSnapshot(std::vector<RankingsUser> const& rankingsUsers, Gamemode const& mode);
+    [[nodiscard]] std::unordered_map<std::string, std::size_t> getNumRankedUsersByCountry(Gamemode const& mode);
     [[nodiscard]] bool hasEmptyTable();
     [[nodiscard]] std::vector<RankImprovement> getTopRankImprovements(
         std::string const& countryCode,
@@ -48,6 +67,12 @@ public:
         int64_t const& maxRank,
         std::size_t const& numUsers,
         Gamemode const& mode);
+    [[nodiscard]] std::vector<UsernameChange> getUsernameChanges(
+        std::string const& countryCode,
+        int64_t const& minRank,
+        int64_t const& maxRank,
+        std::size_t const& numUsers,
+        Gamemode const& mode);
 
 private:
     void createTables_();
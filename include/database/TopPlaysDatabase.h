@@ -18,6 +18,13 @@ const std::unordered_map<Gamemode, std::string> k_modeToTopPlaysTable = {
     { Gamemode::Catch, "CatchTopPlays" }
 };
 
+const std::unordered_map<Gamemode, std::string> k_modeToTopPlaysWindowTable = {
+    { Gamemode::Osu, "OsuTopPlaysWindow" },
+    { Gamemode::Taiko, "TaikoTopPlaysWindow" },
+    { Gamemode::Mania, "ManiaTopPlaysWindow" },
+    { Gamemode::Catch, "CatchTopPlaysWindow" }
+};
+
 /**
  * SQLiteCpp wrapper for top plays tables.
  */
@@ -32,6 +39,8 @@ public:
     [[nodiscard]] bool hasEmptyTable();
     void insertTopPlays(Gamemode const& mode, std::vector<TopPlay> const& topPlays);
     [[nodiscard]] std::vector<TopPlay> getTopPlays(std::string const& countryCode, std::size_t const& numTopPlays, Gamemode const& mode, std::string const& mods);
+    void mergeTopPlaysWindow(Gamemode const& mode, std::vector<TopPlay> const& topPlays, int const& windowDays, std::size_t const& maxNumTopPlays);
+    [[nodiscard]] std::vector<TopPlay> getWindowTopPlays(std::string const& countryCode, std::size_t const& numTopPlays, Gamemode const& mode, std::string const& mods);
 
 private:
     void createTables_();
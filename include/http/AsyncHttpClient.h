@@ -0,0 +1,104 @@
+#ifndef __ASYNC_HTTP_CLIENT_H__
+#define __ASYNC_HTTP_CLIENT_H__
+
+#include "ThreadPool.h"
+#include "TimerService.h"
+#include "CancellationToken.h"
+
+#include <curl/curl.h>
+
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <unordered_set>
+
+/**
+ * Outcome of an asynchronous HTTP request; bSuccess is false if the request itself failed (e.g. no internet connection).
+ */
+struct HttpResponse
+{
+    bool bSuccess = false;
+    bool bCancelled = false;
+    long httpCode = 0;
+    std::string data;
+};
+
+/**
+ * Makes HTTP requests without tying up a thread for each one.
+ * A single event loop thread drives every transfer through a CURL multi handle, and suspended coroutines are resumed on the ThreadPool.
+ * Also has a TimerService for coroutines that want to wait (e.g. to back off), so that those don't park a thread either.
+ */
+class AsyncHttpClient
+{
+public:
+    AsyncHttpClient(std::shared_ptr<ThreadPool> pThreadPool, std::size_t const& maxConnections);
+    ~AsyncHttpClient() noexcept;
+
+    AsyncHttpClient(const AsyncHttpClient&) = delete;
+    AsyncHttpClient& operator=(const AsyncHttpClient&) = delete;
+
+    /**
+     * Awaitable for a single request. Lives in the awaiting coroutine's frame for as long as the transfer is in flight.
+     */
+    class RequestAwaiter
+    {
+    public:
+        RequestAwaiter(AsyncHttpClient& client, std::string url, std::string method, std::vector<std::string> const& headers, std::string body, std::shared_ptr<CancellationToken> pCancelToken);
+        ~RequestAwaiter() noexcept;
+
+        RequestAwaiter(const RequestAwaiter&) = delete;
+        RequestAwaiter& operator=(const RequestAwaiter&) = delete;
+
+        [[nodiscard]] bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle);
+        HttpResponse await_resume();
+
+    private:
+        friend class AsyncHttpClient;
+
+        AsyncHttpClient& m_client;
+        std::string m_url;
+        std::string m_method;
+        std::string m_body;
+        std::shared_ptr<CancellationToken> m_pCancelToken;
+        CURL* m_curlHandle;
+        curl_slist* m_curlHeaders;
+        std::coroutine_handle<> m_handle;
+        char const* m_pLabel;
+        HttpResponse m_response;
+    };
+
+    [[nodiscard]] RequestAwaiter request(
+        std::string const& url,
+        std::string const& method,
+        std::vector<std::string> const& headers,
+        std::string const& body,
+        std::shared_ptr<CancellationToken> pCancelToken);
+    [[nodiscard]] TimerService::SleepAwaiter sleepFor(std::chrono::milliseconds const& delay, std::shared_ptr<CancellationToken> pCancelToken);
+    [[nodiscard]] ThreadPool::ScheduleAwaiter schedule() noexcept;
+
+private:
+    void addRequest_(RequestAwaiter* pRequest);
+    void eventLoop_();
+    void startPendingRequests_(std::unordered_set<RequestAwaiter*>& activeRequests /* out */);
+    void finishRequest_(RequestAwaiter* pRequest, CURLcode const& curlResponse, std::unordered_set<RequestAwaiter*>& activeRequests /* out */);
+    void resume_(std::coroutine_handle<> handle, char const* pLabel);
+
+    std::shared_ptr<ThreadPool> m_pThreadPool;
+    TimerService m_timerService;
+    CURLM* m_curlMultiHandle;
+
+    std::mutex m_pendingMtx;
+    std::vector<RequestAwaiter*> m_pendingRequests;
+
+    std::atomic<bool> m_bStop;
+    std::thread m_eventLoopThread;
+};
+
+#endif /* __ASYNC_HTTP_CLIENT_H__ */
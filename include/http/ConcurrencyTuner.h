@@ -0,0 +1,80 @@
+#ifndef __CONCURRENCY_TUNER_H__
+#define __CONCURRENCY_TUNER_H__
+
+#include "CancellationToken.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+/**
+ * Adaptive cap on how many osu!API requests are in flight at once, i.e. how many of the job threads are actually talking to the API.
+ * Every few seconds, the cap is nudged towards whatever gets the most successful responses per second (hill climbing),
+ * and cut back hard whenever too many requests get ratelimited.
+ */
+class ConcurrencyTuner
+{
+public:
+    ConcurrencyTuner(std::size_t const& minLimit, std::size_t const& maxLimit);
+
+    ConcurrencyTuner(const ConcurrencyTuner&) = delete;
+    ConcurrencyTuner& operator=(const ConcurrencyTuner&) = delete;
+
+    /**
+     * Slot for one request. Given back when destroyed.
+     */
+    class Permit
+    {
+    public:
+        explicit Permit(ConcurrencyTuner* pTuner) noexcept : m_pTuner(pTuner) {}
+        ~Permit() { if (m_pTuner) m_pTuner->release_(); }
+
+        Permit(Permit&& other) noexcept : m_pTuner(std::exchange(other.m_pTuner, nullptr)) {}
+        Permit& operator=(Permit&& other)
+        {
+            if (this != &other)
+            {
+                if (m_pTuner) m_pTuner->release_();
+                m_pTuner = std::exchange(other.m_pTuner, nullptr);
+            }
+            return *this;
+        }
+        Permit(const Permit&) = delete;
+        Permit& operator=(const Permit&) = delete;
+
+    private:
+        ConcurrencyTuner* m_pTuner;
+    };
+
+    [[nodiscard]] Permit acquire(CancellationToken const& cancelToken);
+    [[nodiscard]] std::optional<Permit> tryAcquire();
+    void recordResponse(long const& httpCode);
+    void recordResponse(long const& httpCode, std::chrono::steady_clock::time_point const& now);
+
+    [[nodiscard]] std::size_t getLimit();
+
+private:
+    void release_();
+    void adjustLimit_(std::chrono::steady_clock::time_point const& now);
+    void restartWindow_(std::chrono::steady_clock::time_point const& now);
+
+    std::mutex m_mtx;
+    std::condition_variable m_cv;
+    std::size_t m_minLimit;
+    std::size_t m_maxLimit;
+    std::size_t m_limit;
+    std::size_t m_numInFlight;
+
+    // What the current window has seen so far, and how the last one went
+    std::chrono::steady_clock::time_point m_windowStart;
+    std::chrono::steady_clock::time_point m_lastResponseTime;
+    std::size_t m_numResponses;
+    std::size_t m_numThrottledResponses;
+    double m_prevGoodput;
+    int m_direction;
+};
+
+#endif /* __CONCURRENCY_TUNER_H__ */
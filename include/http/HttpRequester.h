@@ -1,18 +1,22 @@
 #ifndef __HTTP_REQUESTER_H__
 #define __HTTP_REQUESTER_H__
 
+#include "CancellationToken.h"
+
 #include <curl/curl.h>
 
 #include <vector>
 #include <string>
+#include <memory>
 
 /**
  * Makes HTTP requests.
+ * In-flight requests are aborted as soon as the given cancellation token is cancelled.
  */
 class HttpRequester
 {
 public:
-    HttpRequester();
+    explicit HttpRequester(std::shared_ptr<CancellationToken> pCancelToken = nullptr);
     ~HttpRequester() noexcept;
 
     [[nodiscard]] bool makeRequest(
@@ -23,8 +27,18 @@ public:
         long& httpCode /* out */,
         std::string& responseData /* out */);
 
+    static void setRequestOptions(
+        CURL* curlHandle,
+        std::string const& url,
+        std::string const& method,
+        curl_slist* curlHeaders,
+        std::string const& body,
+        CancellationToken const* pCancelToken,
+        std::string* responseData /* out */);
+
 private:
     CURL* m_curlHandle;
+    std::shared_ptr<CancellationToken> m_pCancelToken;
 };
 
 #endif /* __HTTP_REQUESTER_H__ */
\ No newline at end of file
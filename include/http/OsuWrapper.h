@@ -4,6 +4,11 @@
 #include "Util.h"
 #include "TokenManager.h"
 #include "HttpRequester.h"
+#include "AsyncHttpClient.h"
+#include "ConcurrencyTuner.h"
+#include "CancellationToken.h"
+#include "ThreadPool.h"
+#include "Task.h"
 
 #include <nlohmann/json.hpp>
 
@@ -18,7 +23,8 @@
 class OsuWrapper
 {
 public:
-    OsuWrapper(std::shared_ptr<TokenManager> tokenManager, int const& apiCooldownMs) noexcept;
+    OsuWrapper(std::shared_ptr<TokenManager> tokenManager, int const& apiCooldownMs, std::shared_ptr<CancellationToken> pCancelToken = nullptr, std::shared_ptr<ThreadPool> pCpuThreadPool = nullptr);
+    OsuWrapper(std::shared_ptr<TokenManager> tokenManager, AsyncHttpClient& asyncHttpClient, int const& apiCooldownMs, std::shared_ptr<CancellationToken> pCancelToken = nullptr, std::shared_ptr<ThreadPool> pCpuThreadPool = nullptr);
     ~OsuWrapper() = default;
     OsuWrapper(OsuWrapper const&) = delete;
     OsuWrapper& operator=(OsuWrapper const&) = delete;
@@ -26,18 +32,47 @@ public:
     OsuWrapper& operator=(OsuWrapper&&) = default;
 
     bool getRankings(Page page, Gamemode const& mode, nlohmann::json& rankings /* out */);
+    bool getCountryRankings(Page page, std::string const& countryCode, Gamemode const& mode, nlohmann::json& rankings /* out */);
     bool getUser(UserID const& userID, Gamemode const& mode, nlohmann::json& user /* out */);
     bool getUsers(std::vector<UserID> const& userIDs, Gamemode const& mode, nlohmann::json& users /* out */);
+    bool getUserScores(UserID const& userID, std::string const& scoreType, Gamemode const& mode, std::size_t const& limit, nlohmann::json& userScores /* out */);
     bool getUserBeatmapScores(Gamemode const& mode, UserID const& userID, BeatmapID const& beatmapID, nlohmann::json& userBeatmapScores /* out */);
     bool getBeatmap(BeatmapID const& beatmapID, nlohmann::json& beatmap /* out */);
     bool getBeatmaps(std::vector<BeatmapID> const& beatmapIDs, Gamemode const& mode, nlohmann::json& beatmaps /* out */);
 
+    [[nodiscard]] Task<bool> getRankingsAsync(Page page, Gamemode mode, nlohmann::json& rankings /* out */);
+    [[nodiscard]] Task<bool> getCountryRankingsAsync(Page page, std::string countryCode, Gamemode mode, nlohmann::json& rankings /* out */);
+    [[nodiscard]] Task<bool> getUserAsync(UserID userID, Gamemode mode, nlohmann::json& user /* out */);
+    [[nodiscard]] Task<bool> getUsersAsync(std::vector<UserID> userIDs, Gamemode mode, nlohmann::json& users /* out */);
+    [[nodiscard]] Task<bool> getUserBeatmapScoresAsync(Gamemode mode, UserID userID, BeatmapID beatmapID, nlohmann::json& userBeatmapScores /* out */);
+    [[nodiscard]] Task<bool> getBeatmapsAsync(std::vector<BeatmapID> beatmapIDs, Gamemode mode, nlohmann::json& beatmaps /* out */);
+
+    static void setConcurrencyTuner(std::shared_ptr<ConcurrencyTuner> pConcurrencyTuner);
+
 private:
+    enum class ResponseAction_
+    {
+        Return,
+        Retry,
+        RefreshToken,
+        Fail
+    };
+
     [[nodiscard]] bool apiRequest_(std::string const& url, std::string const& method, std::vector<std::string> headers, std::string const& body, nlohmann::json& responseDataJson /* out */);
+    [[nodiscard]] Task<bool> apiRequestAsync_(std::string url, std::string method, std::string body, nlohmann::json& responseDataJson /* out */);
+    [[nodiscard]] std::vector<std::string> requestHeaders_();
+    [[nodiscard]] nlohmann::json decodeResponse_(std::string const& responseData);
+    [[nodiscard]] ResponseAction_ handleResponse_(std::string const& url, std::string const& method, long const& httpCode, std::string const& responseData, std::size_t& retries /* out */, int& delayMs /* out */, nlohmann::json& responseDataJson /* out */);
 
-    std::unique_ptr<HttpRequester> m_pHttpRequester = std::make_unique<HttpRequester>();
+    std::shared_ptr<CancellationToken> m_pCancelToken;
+    std::unique_ptr<HttpRequester> m_pHttpRequester;
+    AsyncHttpClient* m_pAsyncHttpClient;
     std::shared_ptr<TokenManager> m_pTokenManager;
+    std::shared_ptr<ThreadPool> m_pCpuThreadPool;
     int m_apiCooldownMs;
+
+    // Shared by every wrapper, since they all count against the same ratelimit
+    static inline std::shared_ptr<ConcurrencyTuner> s_pConcurrencyTuner = nullptr;
 };
 
 #endif /* __OSU_WRAPPER_H__ */
@@ -3,6 +3,7 @@
 
 #include "Util.h"
 #include "HttpRequester.h"
+#include "CancellationToken.h"
 
 #include <nlohmann/json.hpp>
 
@@ -17,7 +18,7 @@
 class OsutrackWrapper
 {
 public:
-    OsutrackWrapper(int const& apiCooldownMs) noexcept;
+    OsutrackWrapper(int const& apiCooldownMs, std::shared_ptr<CancellationToken> pCancelToken = nullptr);
     ~OsutrackWrapper() = default;
     OsutrackWrapper(OsutrackWrapper const&) = delete;
     OsutrackWrapper& operator=(OsutrackWrapper const&) = delete;
@@ -29,7 +30,8 @@ public:
 private:
     [[nodiscard]] bool apiRequest_(std::string const& url, std::string const& method, std::vector<std::string> headers, std::string const& body, nlohmann::json& responseDataJson /* out */);
 
-    std::unique_ptr<HttpRequester> m_pHttpRequester = std::make_unique<HttpRequester>();
+    std::shared_ptr<CancellationToken> m_pCancelToken;
+    std::unique_ptr<HttpRequester> m_pHttpRequester;
     int m_apiCooldownMs;
 };
 
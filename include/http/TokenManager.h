@@ -2,13 +2,18 @@
 #define __TOKEN_MANAGER_H__
 
 #include "HttpRequester.h"
+#include "AsyncHttpClient.h"
+#include "CancellationToken.h"
+#include "Task.h"
 
 #include <string>
 #include <memory>
 #include <shared_mutex>
 #include <mutex>
+#include <condition_variable>
 
 constexpr int k_tokenWaitMs = 10000;
+constexpr int k_tokenPollMs = 100;
 
 /**
  * Thread-safe class for osu!API v2 OAuth token management.
@@ -20,16 +25,32 @@ public:
     ~TokenManager() = default;
 
     [[nodiscard]] std::string getAccessToken() noexcept;
-    void updateAccessToken();
+    void updateAccessToken(std::shared_ptr<CancellationToken> pCancelToken = nullptr);
+    [[nodiscard]] Task<void> updateAccessTokenAsync(AsyncHttpClient& httpClient, std::shared_ptr<CancellationToken> pCancelToken);
 
 private:
-    std::unique_ptr<HttpRequester> m_pHttpRequester = std::make_unique<HttpRequester>();
+    enum class TokenAction_
+    {
+        Return,
+        Retry
+    };
+
+    [[nodiscard]] bool tryBeginUpdate_();
+    void endUpdate_();
+    [[nodiscard]] bool isUpdating_();
+    [[nodiscard]] std::string requestBody_() const;
+    [[nodiscard]] TokenAction_ handleResponse_(long const& httpCode, std::string const& responseData, std::string& accessToken /* out */) const;
+
     std::string m_clientID;
     std::string m_clientSecret;
 
     std::string m_accessToken;
     std::shared_mutex m_tokenMtx;
+
+    // Only one update runs at a time; the rest wait for it to finish, either blocking or (from a coroutine) polling
     std::mutex m_updateMtx;
+    std::condition_variable m_updateCondition;
+    bool m_bUpdating = false;
 };
 
 #endif /* __TOKEN_MANAGER_H__ */
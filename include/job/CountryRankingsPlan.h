@@ -0,0 +1,19 @@
+#ifndef __COUNTRY_RANKINGS_PLAN_H__
+#define __COUNTRY_RANKINGS_PLAN_H__
+
+#include "Util.h"
+
+#include <vector>
+#include <string>
+#include <utility>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+[[nodiscard]] std::vector<std::pair<CountryCode, Page>> planCountryRankingsPages(
+    std::vector<CountryCode> const& countryCodes,
+    std::unordered_map<std::string, int64_t> const& countryFilterUsage,
+    std::unordered_map<std::string, std::size_t> const& numRankedUsersByCountry,
+    std::size_t const& callBudget);
+
+#endif /* __COUNTRY_RANKINGS_PLAN_H__ */
@@ -2,14 +2,19 @@
 #define __DAILY_TOP_PLAYS_H__
 
 #include "TopPlaysDatabase.h"
+#include "CacheDatabase.h"
 #include "TokenManager.h"
 #include "ThreadPool.h"
+#include "CancellationToken.h"
 
 #include <memory>
 
 void getTopPlays(
     std::shared_ptr<TokenManager> pTokenManager,
+    std::shared_ptr<CancellationToken> pCancelToken,
     std::shared_ptr<TopPlaysDatabase> pTopPlaysDb,
-    std::shared_ptr<ThreadPool> pThreadPool);
+    std::shared_ptr<CacheDatabase> pCacheDb,
+    std::shared_ptr<ThreadPool> pThreadPool,
+    std::shared_ptr<ThreadPool> pCpuThreadPool);
 
 #endif /* __DAILY_TOP_PLAYS_H__ */
@@ -2,14 +2,27 @@
 #define __SCRAPE_RANKINGS_H__
 
 #include "RankingsDatabase.h"
+#include "CacheDatabase.h"
+#include "BotConfigDatabase.h"
 #include "TokenManager.h"
 #include "ThreadPool.h"
+#include "CancellationToken.h"
 
 #include <memory>
 
 void scrapeRankings(
     std::shared_ptr<TokenManager> pTokenManager,
+    std::shared_ptr<CancellationToken> pCancelToken,
     std::shared_ptr<RankingsDatabase> pRankingsDb,
-    std::shared_ptr<ThreadPool> pThreadPool);
+    std::shared_ptr<CacheDatabase> pCacheDb,
+    std::shared_ptr<BotConfigDatabase> pBotConfigDb,
+    std::shared_ptr<ThreadPool> pThreadPool,
+    std::shared_ptr<ThreadPool> pCpuThreadPool);
+
+void stageRankingsPage(
+    std::shared_ptr<TokenManager> pTokenManager,
+    std::shared_ptr<CancellationToken> pCancelToken,
+    std::shared_ptr<CacheDatabase> pCacheDb,
+    std::shared_ptr<ThreadPool> pCpuThreadPool);
 
 #endif /* __SCRAPE_RANKINGS_H__ */
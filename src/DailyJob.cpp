@@ -30,7 +30,7 @@ namespace
 /**
  * DailyJob constructor.
  */
-DailyJob::DailyJob(int const& hour, std::string const& name, std::function<void()> const& job, std::function<void()> const& jobCallback)
+DailyJob::DailyJob(int const& hour, std::string const& name, std::function<void(std::shared_ptr<CancellationToken>)> const& job, std::function<void()> const& jobCallback)
     : m_hour(normalizeHour(hour))
     , m_name(name)
     , m_job(job)
@@ -63,12 +63,14 @@ void DailyJob::start()
     }
 
     LOG_INFO("Running job ", m_name, " at every ", m_hour, "th hour");
+    m_pCancelToken->reset();
     m_bRunning = true;
     m_jobThread = std::make_unique<std::thread>(&DailyJob::runJobLoop_, this);
 }
 
 /**
  * Stop the job scheduler.
+ * If the job is running, it is cancelled and this waits for it to wind down.
  */
 void DailyJob::stop()
 {
@@ -82,6 +84,8 @@ void DailyJob::stop()
         m_bRunning = false;
     }
 
+    m_pCancelToken->cancel();
+
     m_jobCV.notify_one();
 
     if (m_jobThread && m_jobThread->joinable())
@@ -116,7 +120,7 @@ void DailyJob::runJobLoop_()
             LOG_INFO(m_name, " beginning execution");
             auto startTime = std::chrono::steady_clock::now();
 
-            m_job();
+            m_job(m_pCancelToken);
 
             auto endTime = std::chrono::steady_clock::now();
             auto duration = std::chrono::duration_cast<std::chrono::minutes>(endTime - startTime);
@@ -128,6 +132,10 @@ void DailyJob::runJobLoop_()
                 m_jobCallback();
             }
         }
+        catch (OperationCancelled const& e)
+        {
+            LOG_INFO(m_name, " was cancelled");
+        }
         catch(std::exception const& e)
         {
             LOG_ERROR("Caught error in job ", m_name, ": ", e.what());
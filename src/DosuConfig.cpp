@@ -9,6 +9,8 @@
 #include <chrono>
 #include <ctime>
 #include <thread>
+#include <algorithm>
+#include <vector>
 
 int DosuConfig::logLevel;
 bool DosuConfig::logAnsiColors;
@@ -17,10 +19,22 @@ std::string DosuConfig::osuClientID;
 std::string DosuConfig::osuClientSecret;
 int DosuConfig::scrapeRankingsRunHour;
 int DosuConfig::topPlaysRunHour;
-int DosuConfig::threadCount;
+int DosuConfig::topPlaysWindowDays;
+int DosuConfig::topPlaysCount;
+int DosuConfig::scrapeRankingsPagesPerHour;
+int DosuConfig::scrapeRankingsStagingMaxAgeHours;
+std::vector<std::string> DosuConfig::countryRankingsCountries;
+int DosuConfig::countryRankingsDailyCallBudget;
+int DosuConfig::ioThreadCount;
+int DosuConfig::cpuThreadCount;
+bool DosuConfig::ioThreadCountAutoTune;
 std::filesystem::path DosuConfig::rankingsDatabaseFilePath;
 std::filesystem::path DosuConfig::topPlaysDatabaseFilePath;
 std::filesystem::path DosuConfig::botConfigDatabaseFilePath;
+std::filesystem::path DosuConfig::cacheDatabaseFilePath;
+std::filesystem::path DosuConfig::rankingsSnapshotFilePath;
+std::filesystem::path DosuConfig::threadPoolStatsFilePath;
+int DosuConfig::threadPoolQueueCapacity;
 std::map<std::string, std::string> DosuConfig::discordBotStrings;
 
 namespace
@@ -102,15 +116,79 @@ void DosuConfig::load(std::filesystem::path const& filePath)
         DosuConfig::topPlaysRunHour = DosuConfig::topPlaysRunHour % 24;
         LOG_WARN("Configured ", k_topPlaysRunHourKey, " is out of bounds! Normalizing to ", DosuConfig::topPlaysRunHour);
     }
-    DosuConfig::threadCount = configDataJson.at(k_threadCountKey);
-    if (DosuConfig::threadCount < 1)
+    DosuConfig::topPlaysWindowDays = configDataJson.value(k_topPlaysWindowDaysKey, 7);
+    if (DosuConfig::topPlaysWindowDays < 1)
     {
-        DosuConfig::threadCount = static_cast<int>(std::thread::hardware_concurrency());
-        LOG_WARN("Configured ", k_threadCountKey, " is out of bounds! Setting to ", DosuConfig::threadCount);
+        DosuConfig::topPlaysWindowDays = 1;
+        LOG_WARN("Configured ", k_topPlaysWindowDaysKey, " is out of bounds! Setting to 1 (disabled)");
+    }
+    DosuConfig::topPlaysCount = configDataJson.value(k_topPlaysCountKey, static_cast<int>(k_defaultNumTopPlays));
+    if (DosuConfig::topPlaysCount < 1)
+    {
+        DosuConfig::topPlaysCount = static_cast<int>(k_defaultNumTopPlays);
+        LOG_WARN("Configured ", k_topPlaysCountKey, " is out of bounds! Setting to ", DosuConfig::topPlaysCount);
+    }
+    DosuConfig::scrapeRankingsPagesPerHour = configDataJson.value(k_scrapeRankingsPagesPerHourKey, 0);
+    if (DosuConfig::scrapeRankingsPagesPerHour < 0)
+    {
+        DosuConfig::scrapeRankingsPagesPerHour = 0;
+        LOG_WARN("Configured ", k_scrapeRankingsPagesPerHourKey, " is out of bounds! Setting to 0 (disabled)");
+    }
+    DosuConfig::scrapeRankingsStagingMaxAgeHours = configDataJson.value(k_scrapeRankingsStagingMaxAgeKey, 12);
+    if (DosuConfig::scrapeRankingsStagingMaxAgeHours < 1)
+    {
+        DosuConfig::scrapeRankingsStagingMaxAgeHours = 12;
+        LOG_WARN("Configured ", k_scrapeRankingsStagingMaxAgeKey, " is out of bounds! Setting to 12");
+    }
+    DosuConfig::countryRankingsCountries.clear();
+    for (auto const& countryInput : configDataJson.value(k_countryRankingsCountriesKey, std::vector<std::string>()))
+    {
+        std::string countryInputUpper = countryInput;
+        std::transform(countryInputUpper.begin(), countryInputUpper.end(), countryInputUpper.begin(), ::toupper);
+
+        std::string countryCode = std::string(ISO3166Alpha2Converter::toAlpha2(countryInputUpper));
+        if (countryCode.empty() || (countryCode == k_global))
+        {
+            LOG_WARN("Configured ", k_countryRankingsCountriesKey, " contains invalid country ", countryInput, "! Skipping it");
+            continue;
+        }
+        if (std::find(DosuConfig::countryRankingsCountries.begin(), DosuConfig::countryRankingsCountries.end(), countryCode) == DosuConfig::countryRankingsCountries.end())
+        {
+            DosuConfig::countryRankingsCountries.push_back(countryCode);
+        }
+    }
+    DosuConfig::countryRankingsDailyCallBudget = configDataJson.value(k_countryRankingsDailyCallBudgetKey, 0);
+    if (DosuConfig::countryRankingsDailyCallBudget < 0)
+    {
+        DosuConfig::countryRankingsDailyCallBudget = 0;
+        LOG_WARN("Configured ", k_countryRankingsDailyCallBudgetKey, " is out of bounds! Setting to 0 (disabled)");
+    }
+    // Configs from before the executors were split only have THREAD_COUNT, which was used for the same work the I/O threads do now
+    DosuConfig::ioThreadCount = configDataJson.value(k_ioThreadCountKey, configDataJson.value(k_threadCountKey, static_cast<int>(std::thread::hardware_concurrency())));
+    if (DosuConfig::ioThreadCount < 1)
+    {
+        DosuConfig::ioThreadCount = static_cast<int>(std::thread::hardware_concurrency());
+        LOG_WARN("Configured ", k_ioThreadCountKey, " is out of bounds! Setting to ", DosuConfig::ioThreadCount);
+    }
+    DosuConfig::cpuThreadCount = configDataJson.value(k_cpuThreadCountKey, static_cast<int>(std::thread::hardware_concurrency()));
+    if (DosuConfig::cpuThreadCount < 1)
+    {
+        DosuConfig::cpuThreadCount = static_cast<int>(std::thread::hardware_concurrency());
+        LOG_WARN("Configured ", k_cpuThreadCountKey, " is out of bounds! Setting to ", DosuConfig::cpuThreadCount);
+    }
+    DosuConfig::ioThreadCountAutoTune = configDataJson.value(k_ioThreadCountAutoTuneKey, false);
+    DosuConfig::threadPoolQueueCapacity = configDataJson.value(k_threadPoolQueueCapacityKey, 0);
+    if (DosuConfig::threadPoolQueueCapacity < 0)
+    {
+        DosuConfig::threadPoolQueueCapacity = 0;
+        LOG_WARN("Configured ", k_threadPoolQueueCapacityKey, " is out of bounds! Setting to 0 (unbounded)");
     }
     DosuConfig::rankingsDatabaseFilePath = std::filesystem::path(configDataJson.at(k_rankingsDbFilePathKey));
     DosuConfig::topPlaysDatabaseFilePath = std::filesystem::path(configDataJson.at(k_topPlaysDbFilePathKey));
     DosuConfig::botConfigDatabaseFilePath = std::filesystem::path(configDataJson.at(k_botConfigDbFilePathKey));
+    DosuConfig::cacheDatabaseFilePath = std::filesystem::path(configDataJson.value(k_cacheDbFilePathKey, (k_dataDir / "cache.db").string()));
+    DosuConfig::rankingsSnapshotFilePath = std::filesystem::path(configDataJson.value(k_rankingsSnapshotFilePathKey, (k_dataDir / "rankings_snapshot.json").string()));
+    DosuConfig::threadPoolStatsFilePath = std::filesystem::path(configDataJson.value(k_threadPoolStatsFilePathKey, std::string()));
 }
 
 /**
@@ -125,6 +203,12 @@ void DosuConfig::setupConfig(std::filesystem::path const& filePath, std::atomic<
     newConfigJson[k_logAnsiColorsKey] = false;
     newConfigJson[k_scrapeRankingsRunHourKey] = utcToLocal(3);
     newConfigJson[k_topPlaysRunHourKey] = utcToLocal(1);
+    newConfigJson[k_topPlaysWindowDaysKey] = 7;
+    newConfigJson[k_topPlaysCountKey] = k_defaultNumTopPlays;
+    newConfigJson[k_scrapeRankingsPagesPerHourKey] = 0;
+    newConfigJson[k_scrapeRankingsStagingMaxAgeKey] = 12;
+    newConfigJson[k_countryRankingsCountriesKey] = nlohmann::json::array();
+    newConfigJson[k_countryRankingsDailyCallBudgetKey] = 0;
 
     std::string botToken;
     std::string clientID;
@@ -157,7 +241,13 @@ void DosuConfig::setupConfig(std::filesystem::path const& filePath, std::atomic<
     newConfigJson[k_rankingsDbFilePathKey] = k_dataDir / "rankings.db";
     newConfigJson[k_topPlaysDbFilePathKey] = k_dataDir / "top_plays.db";
     newConfigJson[k_botConfigDbFilePathKey] = k_dataDir / "bot_config.db";
-    newConfigJson[k_threadCountKey] = static_cast<int>(std::thread::hardware_concurrency());
+    newConfigJson[k_cacheDbFilePathKey] = k_dataDir / "cache.db";
+    newConfigJson[k_rankingsSnapshotFilePathKey] = k_dataDir / "rankings_snapshot.json";
+    newConfigJson[k_ioThreadCountKey] = static_cast<int>(std::thread::hardware_concurrency());
+    newConfigJson[k_cpuThreadCountKey] = static_cast<int>(std::thread::hardware_concurrency());
+    newConfigJson[k_ioThreadCountAutoTuneKey] = false;
+    newConfigJson[k_threadPoolStatsFilePathKey] = "";
+    newConfigJson[k_threadPoolQueueCapacityKey] = 0;
 
     nlohmann::json defaultDiscordBotStrings;
     defaultDiscordBotStrings[k_letterRankXKey]  = "X";
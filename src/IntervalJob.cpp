@@ -0,0 +1,112 @@
+#include "IntervalJob.h"
+#include "Logger.h"
+
+#include <utility>
+
+/**
+ * IntervalJob constructor.
+ */
+IntervalJob::IntervalJob(std::chrono::seconds const& interval, std::string const& name, std::function<void(std::shared_ptr<CancellationToken>)> const& job)
+    : m_interval(interval)
+    , m_name(name)
+    , m_job(job)
+{
+    LOG_ERROR_THROW(
+        m_job,
+        "Job function for ", name, " must exist!"
+    );
+    LOG_ERROR_THROW(
+        m_interval.count() > 0,
+        "Interval for ", name, " must be positive!"
+    );
+}
+
+/**
+ * IntervalJob destructor.
+ */
+IntervalJob::~IntervalJob()
+{
+    stop();
+}
+
+/**
+ * Start the job scheduler.
+ */
+void IntervalJob::start()
+{
+    std::lock_guard<std::mutex> lock(m_jobMtx);
+
+    if (m_bRunning)
+    {
+        return;
+    }
+
+    LOG_INFO("Running job ", m_name, " every ", m_interval.count(), " seconds");
+    m_pCancelToken->reset();
+    m_bRunning = true;
+    m_jobThread = std::make_unique<std::thread>(&IntervalJob::runJobLoop_, this);
+}
+
+/**
+ * Stop the job scheduler.
+ * If the job is running, it is cancelled and this waits for it to wind down.
+ */
+void IntervalJob::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_jobMtx);
+        if (!m_bRunning)
+        {
+            return;
+        }
+        LOG_INFO("Halting job ", m_name);
+        m_bRunning = false;
+    }
+
+    m_pCancelToken->cancel();
+
+    m_jobCV.notify_one();
+
+    if (m_jobThread && m_jobThread->joinable())
+    {
+        m_jobThread->join();
+        m_jobThread.reset();
+    }
+}
+
+/**
+ * Run job once every interval, looping until told to stop.
+ * The interval is measured from the end of one run to the start of the next, so slow runs never pile up.
+ */
+void IntervalJob::runJobLoop_()
+{
+    LOG_DEBUG("Running job loop");
+    while (m_bRunning)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_jobMtx);
+            if (m_jobCV.wait_for(lock, m_interval, [this] { return !m_bRunning; }))
+            {
+                break;
+            }
+        }
+
+        try
+        {
+            LOG_DEBUG(m_name, " beginning execution");
+            m_job(m_pCancelToken);
+        }
+        catch (OperationCancelled const& e)
+        {
+            LOG_DEBUG(m_name, " was cancelled");
+        }
+        catch(std::exception const& e)
+        {
+            LOG_ERROR("Caught error in job ", m_name, ": ", e.what());
+        }
+        catch (...)
+        {
+            LOG_ERROR("Unknown error in job ", m_name);
+        }
+    }
+}
@@ -0,0 +1,303 @@
+#include "JobGraph.h"
+#include "DosuConfig.h"
+#include "Logger.h"
+
+#include <queue>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <sstream>
+#include <thread>
+#include <utility>
+
+/**
+ * JobGraph constructor.
+ */
+JobGraph::JobGraph(std::string const& name)
+    : m_name(name)
+{}
+
+/**
+ * Add a stage that runs once every stage in dependencies has finished.
+ * Dependencies don't need to be added before the stages that depend on them.
+ */
+void JobGraph::addStage(std::string const& name, std::vector<std::string> const& dependencies, std::function<void()> const& stage)
+{
+    LOG_ERROR_THROW(
+        stage,
+        "Stage function for ", name, " in ", m_name, " must exist!"
+    );
+    LOG_ERROR_THROW(
+        m_stageNameToIdx.find(name) == m_stageNameToIdx.end(),
+        "Stage ", name, " was added to ", m_name, " twice!"
+    );
+
+    m_stageNameToIdx.emplace(name, m_stages.size());
+    Stage_ newStage;
+    newStage.name = name;
+    newStage.dependencies = dependencies;
+    newStage.fn = stage;
+    m_stages.push_back(std::move(newStage));
+}
+
+/**
+ * Run every stage, starting each one as soon as its dependencies are done.
+ * If a stage throws, no new stages are started and the first error is rethrown once the running ones finish.
+ * Cancelling pCancelToken works the same way, except that OperationCancelled is thrown.
+ * Each stage runs on a thread of its own rather than on pThreadPool, since stages spend most of their time waiting on what they submit to
+ * the pools, and a worker that waits can't run anything; with other jobs sharing the pool, every worker could end up waiting like that.
+ * pThreadPool and pCpuThreadPool are only passed in so that what the stages handed off to them gets reported.
+ */
+void JobGraph::run(std::shared_ptr<ThreadPool> pThreadPool, std::shared_ptr<CancellationToken> pCancelToken, std::shared_ptr<ThreadPool> pCpuThreadPool)
+{
+    if (!pCancelToken)
+    {
+        pCancelToken = std::make_shared<CancellationToken>();
+    }
+
+    resolveDependencies_();
+
+    std::queue<std::size_t> readyStages;
+    for (std::size_t i = 0; i < m_stages.size(); ++i)
+    {
+        if (m_stages[i].numUnmetDependencies == 0)
+        {
+            readyStages.push(i);
+        }
+    }
+
+    std::mutex graphMtx;
+    std::condition_variable graphCV;
+    std::size_t numRunningStages = 0;
+    std::exception_ptr pFirstError;
+    std::vector<std::thread> stageThreads;
+    stageThreads.reserve(m_stages.size());
+
+    {
+        std::unique_lock<std::mutex> lock(graphMtx);
+        while (true)
+        {
+            if (!pFirstError && pCancelToken->isCancelled())
+            {
+                pFirstError = std::make_exception_ptr(OperationCancelled());
+            }
+
+            while (!pFirstError && !readyStages.empty())
+            {
+                std::size_t stageIdx = readyStages.front();
+                readyStages.pop();
+
+                try
+                {
+                    stageThreads.emplace_back(
+                    [this, stageIdx, pCancelToken, &graphMtx, &graphCV, &readyStages, &numRunningStages, &pFirstError]()
+                    {
+                        std::exception_ptr pError;
+                        try
+                        {
+                            runStage_(stageIdx);
+                        }
+                        catch (...)
+                        {
+                            pError = std::current_exception();
+                        }
+
+                        std::lock_guard<std::mutex> stageLock(graphMtx);
+                        --numRunningStages;
+                        if (pError)
+                        {
+                            if (!pCancelToken->isCancelled())
+                            {
+                                LOG_ERROR("Stage ", m_stages[stageIdx].name, " of ", m_name, " failed");
+                            }
+                            if (!pFirstError)
+                            {
+                                pFirstError = pError;
+                            }
+                        }
+                        else
+                        {
+                            for (std::size_t const& dependentIdx : m_stages[stageIdx].dependents)
+                            {
+                                if (--m_stages[dependentIdx].numUnmetDependencies == 0)
+                                {
+                                    readyStages.push(dependentIdx);
+                                }
+                            }
+                        }
+
+                        // Notify while still holding the lock, since run() may return as soon as it gets it back
+                        graphCV.notify_one();
+                    });
+                    ++numRunningStages;
+                }
+                catch (...)
+                {
+                    // Couldn't start a thread for it; the stages that are already running still have to be waited for
+                    pFirstError = std::current_exception();
+                }
+            }
+
+            // Nothing is running and nothing else can be started => either everything is done or a stage failed
+            if (numRunningStages == 0)
+            {
+                break;
+            }
+
+            graphCV.wait(lock);
+        }
+    }
+
+    for (std::thread& stageThread : stageThreads)
+    {
+        stageThread.join();
+    }
+
+    reportThreadPoolStats_(*pThreadPool, m_name);
+    if (pCpuThreadPool)
+    {
+        reportThreadPoolStats_(*pCpuThreadPool, m_name + "/cpu");
+    }
+    if (pFirstError)
+    {
+        std::rethrow_exception(pFirstError);
+    }
+
+    logStageTimings_();
+}
+
+/**
+ * Get how long each finished stage took, in the order they were added.
+ */
+[[nodiscard]] std::vector<std::pair<std::string, std::chrono::milliseconds>> JobGraph::getStageTimings() const
+{
+    std::vector<std::pair<std::string, std::chrono::milliseconds>> stageTimings;
+    stageTimings.reserve(m_stages.size());
+    for (auto const& stage : m_stages)
+    {
+        if (stage.bFinished)
+        {
+            stageTimings.emplace_back(stage.name, stage.duration);
+        }
+    }
+
+    return stageTimings;
+}
+
+/**
+ * Link every stage to its dependents, making sure that the graph can actually finish.
+ */
+void JobGraph::resolveDependencies_()
+{
+    for (auto& stage : m_stages)
+    {
+        stage.dependents.clear();
+        stage.numUnmetDependencies = stage.dependencies.size();
+        stage.duration = std::chrono::milliseconds(0);
+        stage.bFinished = false;
+    }
+
+    for (std::size_t i = 0; i < m_stages.size(); ++i)
+    {
+        for (auto const& dependency : m_stages[i].dependencies)
+        {
+            auto it = m_stageNameToIdx.find(dependency);
+            LOG_ERROR_THROW(
+                it != m_stageNameToIdx.end(),
+                "Stage ", m_stages[i].name, " of ", m_name, " depends on unknown stage ", dependency
+            );
+            m_stages[it->second].dependents.push_back(i);
+        }
+    }
+
+    // Kahn's algorithm; if some stages are never reached, they're part of a cycle
+    std::vector<std::size_t> numUnmetDependencies;
+    numUnmetDependencies.reserve(m_stages.size());
+    std::queue<std::size_t> readyStages;
+    for (std::size_t i = 0; i < m_stages.size(); ++i)
+    {
+        numUnmetDependencies.push_back(m_stages[i].numUnmetDependencies);
+        if (numUnmetDependencies[i] == 0)
+        {
+            readyStages.push(i);
+        }
+    }
+
+    std::size_t numReachedStages = 0;
+    while (!readyStages.empty())
+    {
+        std::size_t stageIdx = readyStages.front();
+        readyStages.pop();
+        ++numReachedStages;
+
+        for (std::size_t const& dependentIdx : m_stages[stageIdx].dependents)
+        {
+            if (--numUnmetDependencies[dependentIdx] == 0)
+            {
+                readyStages.push(dependentIdx);
+            }
+        }
+    }
+
+    LOG_ERROR_THROW(
+        numReachedStages == m_stages.size(),
+        m_name, " has a dependency cycle! Only ", numReachedStages, " of ", m_stages.size(), " stages can run"
+    );
+}
+
+/**
+ * Run a single stage and record how long it took.
+ * Whatever the stage submits to the thread pool is labelled "<job>:<stage>"; the stage itself doesn't run on the pool, so it isn't sampled.
+ */
+void JobGraph::runStage_(std::size_t const& stageIdx)
+{
+    Stage_& stage = m_stages[stageIdx];
+    LOG_DEBUG(m_name, " starting stage ", stage.name);
+    ThreadPool::LabelScope labelScope(m_name + ":" + stage.name);
+
+    auto startTime = std::chrono::steady_clock::now();
+    stage.fn();
+    auto endTime = std::chrono::steady_clock::now();
+
+    stage.duration = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime);
+    stage.bFinished = true;
+}
+
+/**
+ * Log how long each stage took.
+ */
+void JobGraph::logStageTimings_() const
+{
+    std::stringstream ss;
+    bool bFirst = true;
+    for (auto const& [name, duration] : getStageTimings())
+    {
+        ss << (bFirst ? "" : ", ") << name << "=" << static_cast<double>(duration.count()) / 1000. << "s";
+        bFirst = false;
+    }
+
+    LOG_INFO(m_name, " stage timings: ", ss.str());
+}
+
+/**
+ * Summarise how the job's tasks fared on a thread pool, and export them if THREAD_POOL_STATS_FILE_PATH is set.
+ */
+void JobGraph::reportThreadPoolStats_(ThreadPool& threadPool, std::string const& poolName) const
+{
+    ThreadPoolStats stats = threadPool.takeStats(m_name + ":");
+    stats.logSummary(poolName);
+
+    if (DosuConfig::threadPoolStatsFilePath.empty() || stats.empty())
+    {
+        return;
+    }
+
+    try
+    {
+        stats.exportCsv(DosuConfig::threadPoolStatsFilePath, poolName);
+    }
+    catch (std::exception const& e)
+    {
+        LOG_ERROR("Failed to export thread pool stats; ", e.what());
+    }
+}
@@ -0,0 +1,515 @@
+#include "ThreadPool.h"
+
+#include <utility>
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <cstddef>
+#include <string_view>
+#include <unordered_set>
+
+/**
+ * ThreadPool constructor.
+ */
+ThreadPool::ThreadPool(std::size_t numThreads, std::size_t const& queueCapacity)
+    : m_numQueuedTasks(0)
+    , m_numQueuedInteractiveTasks(0)
+    , m_numSleepingWorkers(0)
+    , m_stop(false)
+    , m_queueCapacity(queueCapacity)
+    , m_numCapacityWaiters(0)
+{
+    if (numThreads == 0)
+    {
+        numThreads = 1;
+    }
+
+    // Every queue has to exist before any worker starts stealing from it
+    m_queues.reserve(numThreads);
+    m_workerStats.reserve(numThreads);
+    for (std::size_t i = 0; i < numThreads; ++i)
+    {
+        m_queues.push_back(std::make_unique<WorkerQueue_>());
+        m_workerStats.push_back(std::make_unique<WorkerStats_>());
+    }
+
+    m_workers.reserve(numThreads);
+    for (std::size_t i = 0; i < numThreads; ++i)
+    {
+        m_workers.emplace_back(
+        [this, i]
+        {
+            workerThread_(i);
+        });
+    }
+}
+
+/**
+ * ThreadPool destructor.
+ */
+ThreadPool::~ThreadPool()
+{
+    shutdown();
+}
+
+/**
+ * Stop all threads in pool, once every task that was already submitted has run.
+ */
+void ThreadPool::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMtx);
+        if (m_stop)
+        {
+            return;
+        }
+        m_stop = true;
+    }
+
+    m_condition.notify_all();
+    {
+        std::lock_guard<std::mutex> lock(m_capacityMtx);
+    }
+    m_capacityCondition.notify_all();
+
+    for (std::thread& worker : m_workers)
+    {
+        if (worker.joinable())
+        {
+            worker.join();
+        }
+    }
+}
+
+/**
+ * Get a copy of label that lives as long as the program does, so that tasks can carry it around as a plain pointer.
+ * There are only ever a handful of distinct labels (e.g. one per job stage).
+ */
+[[nodiscard]] char const* ThreadPool::internLabel(std::string const& label)
+{
+    static std::mutex s_labelsMtx;
+    static std::unordered_set<std::string> s_labels;
+
+    std::lock_guard<std::mutex> lock(s_labelsMtx);
+    return s_labels.insert(label).first->c_str();
+}
+
+/**
+ * Resume a suspended coroutine on one of the pool's workers, under the label it was suspended under.
+ * Never waits for room in the queues; this gets called from AsyncHttpClient's event loop, which mustn't stall.
+ * Goes in the lane of whoever resumes it, i.e. batch unless resumed from inside an interactive task.
+ */
+void ThreadPool::resume(std::coroutine_handle<> handle, char const* pLabel)
+{
+    auto resumeFn = [handle]()
+    {
+        handle.resume();
+    };
+
+    LabelScope labelScope(pLabel);
+    auto* pState = new TaskState<void, decltype(resumeFn)>(std::move(resumeFn));
+
+    // Nothing waits on a resumed coroutine through a future, so the pool holds the only reference
+    pState->release();
+    enqueue_(PoolTask(pState), t_priority, false);
+}
+
+/**
+ * Take every sample of a task whose label starts with labelPrefix (e.g. a job's name).
+ * Tasks without a label aren't sampled at all.
+ */
+[[nodiscard]] ThreadPoolStats ThreadPool::takeStats(std::string const& labelPrefix)
+{
+    std::vector<TaskSample> samples;
+    for (auto& pWorkerStats : m_workerStats)
+    {
+        std::lock_guard<std::mutex> lock(pWorkerStats->mtx);
+        auto it = std::stable_partition(pWorkerStats->samples.begin(), pWorkerStats->samples.end(),
+        [&labelPrefix](TaskSample const& sample)
+        {
+            return !std::string_view(sample.pLabel).starts_with(labelPrefix);
+        });
+        std::move(it, pWorkerStats->samples.end(), std::back_inserter(samples));
+        pWorkerStats->samples.erase(it, pWorkerStats->samples.end());
+    }
+
+    return ThreadPoolStats(m_workers.size(), std::move(samples));
+}
+
+/**
+ * Push task onto the given lane of the submitting worker's own deque, or of the external queue if submitted from outside the pool.
+ */
+void ThreadPool::enqueue_(PoolTask task, TaskPriority const& priority, bool const& bWaitForCapacity)
+{
+    if (bWaitForCapacity)
+    {
+        static_cast<void>(waitForCapacity_());
+    }
+
+    WorkerQueue_& queue = (t_pWorkerPool == this) ? *m_queues[t_workerIdx] : m_externalQueue;
+    task.stamp(t_pLabel, std::chrono::steady_clock::now());
+
+    // Count the task before it's visible, so that a worker never goes to sleep while it's sitting in a deque
+    if (!countQueuedTasks_(1, priority))
+    {
+        throw std::runtime_error("Cannot submit task to stopped ThreadPool");
+    }
+    {
+        std::lock_guard<std::mutex> lock(queue.mtx);
+        queue.lanes[static_cast<std::size_t>(priority)].push_back(std::move(task));
+    }
+
+    notifySleepers_(1);
+}
+
+/**
+ * Push a batch of tasks with the current thread's priority, as many at a time as there's room for in the queues.
+ */
+void ThreadPool::enqueueBulk_(std::vector<PoolTask> tasks)
+{
+    TaskPriority priority = t_priority;
+    auto enqueueTime = std::chrono::steady_clock::now();
+    for (auto& task : tasks)
+    {
+        task.stamp(t_pLabel, enqueueTime);
+    }
+
+    // Once some of the batch is queued, the rest has to follow since the caller may be waiting on all of it;
+    // if the pool stops in the meantime, whatever's left is run right here instead
+    auto it = tasks.begin();
+    while (it != tasks.end())
+    {
+        std::size_t numRemainingTasks = static_cast<std::size_t>(tasks.end() - it);
+        std::size_t numTasks = (priority == TaskPriority::Batch) ? std::min(waitForCapacity_(), numRemainingTasks) : numRemainingTasks;
+        auto batchEnd = it + static_cast<std::ptrdiff_t>(numTasks);
+        if (!pushBulk_(it, batchEnd, priority))
+        {
+            if (it == tasks.begin())
+            {
+                throw std::runtime_error("Cannot submit task to stopped ThreadPool");
+            }
+
+            TaskPriority prevPriority = std::exchange(t_priority, priority);
+            for (; it != tasks.end(); ++it)
+            {
+                (*it)();
+            }
+            t_priority = prevPriority;
+            return;
+        }
+        it = batchEnd;
+    }
+}
+
+/**
+ * Push tasks onto the queues under a single lock.
+ * From a worker, the whole batch goes onto its own deque for the others to steal; otherwise it goes onto the external queue.
+ * Return false (without pushing anything) if the pool has stopped.
+ */
+[[nodiscard]] bool ThreadPool::pushBulk_(std::vector<PoolTask>::iterator begin, std::vector<PoolTask>::iterator end, TaskPriority const& priority)
+{
+    std::size_t numTasks = static_cast<std::size_t>(end - begin);
+    if (numTasks == 0)
+    {
+        return true;
+    }
+
+    std::size_t laneIdx = static_cast<std::size_t>(priority);
+    if (!countQueuedTasks_(numTasks, priority))
+    {
+        return false;
+    }
+    {
+        WorkerQueue_& queue = (t_pWorkerPool == this) ? *m_queues[t_workerIdx] : m_externalQueue;
+        std::lock_guard<std::mutex> lock(queue.mtx);
+        std::move(begin, end, std::back_inserter(queue.lanes[laneIdx]));
+    }
+
+    notifySleepers_(numTasks);
+    return true;
+}
+
+/**
+ * Count numTasks as queued, ahead of pushing them. Return false (and take the count back) if the pool has stopped.
+ *
+ * Checking m_stop only after counting closes the gap with shutdown(): either this sees m_stop and backs out, or the workers
+ * (which only exit once they see m_stop and no queued tasks) see the count and stay until the tasks have run.
+ */
+[[nodiscard]] bool ThreadPool::countQueuedTasks_(std::size_t const& numTasks, TaskPriority const& priority)
+{
+    m_numQueuedTasks += numTasks;
+    if (priority == TaskPriority::Interactive)
+    {
+        m_numQueuedInteractiveTasks += numTasks;
+    }
+
+    if (m_stop)
+    {
+        m_numQueuedTasks -= numTasks;
+        if (priority == TaskPriority::Interactive)
+        {
+            m_numQueuedInteractiveTasks -= numTasks;
+        }
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Wake up as many sleeping workers as there are new tasks.
+ * Taking the lock makes sure that a worker that is about to sleep is already waiting by the time we notify it.
+ */
+void ThreadPool::notifySleepers_(std::size_t const& numTasks)
+{
+    if (m_numSleepingWorkers == 0)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMtx);
+    }
+
+    if (numTasks == 1)
+    {
+        m_condition.notify_one();
+    }
+    else
+    {
+        m_condition.notify_all();
+    }
+}
+
+/**
+ * Return true if submits from outside the pool would have to wait for room right now.
+ */
+[[nodiscard]] bool ThreadPool::isFull_() const noexcept
+{
+    return (m_queueCapacity > 0) && (m_numQueuedTasks >= m_queueCapacity);
+}
+
+/**
+ * Block until there's room in the queues, unless they're unbounded or this is one of the pool's own workers.
+ * Return how many tasks there's room for (or the max if there's no limit for this thread).
+ *
+ * Waiters count themselves before checking for room, and workers check for waiters after taking a task, so one of the two always
+ * sees the other.
+ */
+[[nodiscard]] std::size_t ThreadPool::waitForCapacity_()
+{
+    if ((m_queueCapacity == 0) || (t_pWorkerPool == this))
+    {
+        return std::numeric_limits<std::size_t>::max();
+    }
+
+    std::unique_lock<std::mutex> lock(m_capacityMtx);
+    ++m_numCapacityWaiters;
+    m_capacityCondition.wait(lock,
+    [this]
+    {
+        return m_stop || !isFull_();
+    });
+    --m_numCapacityWaiters;
+
+    std::size_t numQueuedTasks = m_numQueuedTasks;
+    return (numQueuedTasks < m_queueCapacity) ? (m_queueCapacity - numQueuedTasks) : 1;
+}
+
+/**
+ * Park a coroutine until there's room in the queues. Return false if there already is, in which case it just carries on.
+ */
+[[nodiscard]] bool ThreadPool::addCapacityAwaiter_(std::coroutine_handle<> handle)
+{
+    std::lock_guard<std::mutex> lock(m_capacityMtx);
+    ++m_numCapacityWaiters;
+    if (m_stop || !isFull_())
+    {
+        --m_numCapacityWaiters;
+        return false;
+    }
+
+    m_capacityAwaiters.emplace_back(handle, t_pLabel);
+    return true;
+}
+
+/**
+ * Wake up blocked submitters, and resume as many parked coroutines as there's room for.
+ */
+void ThreadPool::releaseCapacityWaiters_()
+{
+    std::vector<std::pair<std::coroutine_handle<>, char const*>> resumableAwaiters;
+    {
+        std::lock_guard<std::mutex> lock(m_capacityMtx);
+        while (!m_capacityAwaiters.empty() && (m_numQueuedTasks + resumableAwaiters.size() < m_queueCapacity))
+        {
+            resumableAwaiters.push_back(m_capacityAwaiters.front());
+            m_capacityAwaiters.pop_front();
+            --m_numCapacityWaiters;
+        }
+    }
+    m_capacityCondition.notify_all();
+
+    for (auto const& [handle, pLabel] : resumableAwaiters)
+    {
+        resume(handle, pLabel);
+    }
+}
+
+/**
+ * Pop an interactive task if there is one anywhere, else a batch task; or the other way round if bPreferBatch.
+ * Return true if a task was found.
+ */
+[[nodiscard]] bool ThreadPool::popTask_(std::size_t const& workerIdx, bool const& bPreferBatch, PoolTask& task /* out */, TaskPriority& priority /* out */)
+{
+    std::array<TaskPriority, k_numPriorities> lanePriorities = bPreferBatch
+        ? std::array<TaskPriority, k_numPriorities>{ TaskPriority::Batch, TaskPriority::Interactive }
+        : std::array<TaskPriority, k_numPriorities>{ TaskPriority::Interactive, TaskPriority::Batch };
+
+    for (TaskPriority const& lanePriority : lanePriorities)
+    {
+        // Most of the time there's no interactive work at all, so don't go through every deque's lock looking for some
+        if ((lanePriority == TaskPriority::Interactive) && (m_numQueuedInteractiveTasks == 0))
+        {
+            continue;
+        }
+
+        if (popLaneTask_(workerIdx, lanePriority, task))
+        {
+            priority = lanePriority;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Pop the newest task off the given lane of the worker's own deque, or else the oldest task submitted from outside the pool,
+ * or else steal the oldest task off someone else's deque.
+ * Return true if a task was found.
+ */
+[[nodiscard]] bool ThreadPool::popLaneTask_(std::size_t const& workerIdx, TaskPriority const& priority, PoolTask& task /* out */)
+{
+    std::size_t laneIdx = static_cast<std::size_t>(priority);
+    auto countPopped = [this, &priority]()
+    {
+        --m_numQueuedTasks;
+        if (priority == TaskPriority::Interactive)
+        {
+            --m_numQueuedInteractiveTasks;
+        }
+    };
+
+    {
+        std::deque<PoolTask>& ownLane = m_queues[workerIdx]->lanes[laneIdx];
+        std::lock_guard<std::mutex> lock(m_queues[workerIdx]->mtx);
+        if (!ownLane.empty())
+        {
+            task = std::move(ownLane.back());
+            ownLane.pop_back();
+            countPopped();
+            return true;
+        }
+    }
+
+    {
+        std::deque<PoolTask>& externalLane = m_externalQueue.lanes[laneIdx];
+        std::lock_guard<std::mutex> lock(m_externalQueue.mtx);
+        if (!externalLane.empty())
+        {
+            task = std::move(externalLane.front());
+            externalLane.pop_front();
+            countPopped();
+            return true;
+        }
+    }
+
+    for (std::size_t i = 1; i < m_queues.size(); ++i)
+    {
+        WorkerQueue_& victimQueue = *m_queues[(workerIdx + i) % m_queues.size()];
+        std::deque<PoolTask>& victimLane = victimQueue.lanes[laneIdx];
+        std::lock_guard<std::mutex> lock(victimQueue.mtx);
+        if (!victimLane.empty())
+        {
+            task = std::move(victimLane.front());
+            victimLane.pop_front();
+            countPopped();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Run task under its label and priority, sampling how long it waited in the queues and ran for if it has a label.
+ */
+void ThreadPool::runTask_(std::size_t const& workerIdx, PoolTask& task, TaskPriority const& priority)
+{
+    TaskPriority prevPriority = std::exchange(t_priority, priority);
+    char const* pLabel = task.getLabel();
+    if (!pLabel)
+    {
+        task();
+        t_priority = prevPriority;
+        return;
+    }
+
+    TaskSample sample;
+    sample.pLabel = pLabel;
+    sample.workerIdx = workerIdx;
+    sample.queueDepth = m_numQueuedTasks;
+    sample.enqueueTime = task.getEnqueueTime();
+    sample.startTime = std::chrono::steady_clock::now();
+    {
+        LabelScope labelScope(pLabel);
+        task();
+    }
+    sample.endTime = std::chrono::steady_clock::now();
+    t_priority = prevPriority;
+
+    std::lock_guard<std::mutex> lock(m_workerStats[workerIdx]->mtx);
+    m_workerStats[workerIdx]->samples.push_back(sample);
+}
+
+/**
+ * Run tasks until the pool is stopped and there are none left.
+ */
+void ThreadPool::workerThread_(std::size_t const& workerIdx)
+{
+    t_pWorkerPool = this;
+    t_workerIdx = workerIdx;
+
+    std::size_t numConsecutiveInteractiveTasks = 0;
+    while (true)
+    {
+        PoolTask task;
+        TaskPriority priority = TaskPriority::Batch;
+        if (popTask_(workerIdx, numConsecutiveInteractiveTasks >= k_maxConsecutiveInteractiveTasks, task, priority))
+        {
+            numConsecutiveInteractiveTasks = (priority == TaskPriority::Interactive) ? (numConsecutiveInteractiveTasks + 1) : 0;
+            if (m_numCapacityWaiters > 0)
+            {
+                releaseCapacityWaiters_();
+            }
+
+            runTask_(workerIdx, task, priority);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepMtx);
+        ++m_numSleepingWorkers;
+        m_condition.wait(lock,
+        [this]
+        {
+            return m_stop || (m_numQueuedTasks > 0);
+        });
+        --m_numSleepingWorkers;
+
+        if (m_stop && (m_numQueuedTasks == 0))
+        {
+            return;
+        }
+    }
+}
@@ -0,0 +1,168 @@
+#include "ThreadPoolStats.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string_view>
+#include <utility>
+
+namespace
+{
+using Micros = std::chrono::microseconds;
+
+/**
+ * Nearest-rank percentile of already sorted durations.
+ */
+Micros percentile(std::vector<Micros> const& sortedDurations, double const& fraction)
+{
+    if (sortedDurations.empty())
+    {
+        return Micros(0);
+    }
+
+    auto rank = static_cast<std::size_t>(fraction * static_cast<double>(sortedDurations.size() - 1) + 0.5);
+    return sortedDurations[std::min(rank, sortedDurations.size() - 1)];
+}
+
+std::string formatMs(Micros const& duration)
+{
+    std::stringstream ss;
+    ss.precision(1);
+    ss << std::fixed << static_cast<double>(duration.count()) / 1000. << "ms";
+    return ss.str();
+}
+
+/**
+ * Format e.g. "wait p50=1.0ms p95=12.3ms max=40.0ms" out of unsorted durations.
+ */
+std::string formatDistribution(std::string const& name, std::vector<Micros> durations)
+{
+    std::sort(durations.begin(), durations.end());
+    return name + " p50=" + formatMs(percentile(durations, 0.5))
+        + " p95=" + formatMs(percentile(durations, 0.95))
+        + " max=" + formatMs(durations.empty() ? Micros(0) : durations.back());
+}
+} /* namespace */
+
+/**
+ * ThreadPoolStats constructor.
+ */
+ThreadPoolStats::ThreadPoolStats(std::size_t const& numWorkers, std::vector<TaskSample> samples)
+    : m_numWorkers(numWorkers)
+    , m_samples(std::move(samples))
+{
+    std::sort(m_samples.begin(), m_samples.end(),
+    [](TaskSample const& lhs, TaskSample const& rhs)
+    {
+        return lhs.startTime < rhs.startTime;
+    });
+}
+
+/**
+ * Log queue depth, how long tasks waited in the queues and ran for (overall and per label), and how busy each worker was.
+ * Busy ratios only count this job's tasks, so they're understated if other jobs were running at the same time.
+ */
+void ThreadPoolStats::logSummary(std::string const& name) const
+{
+    if (m_samples.empty())
+    {
+        LOG_INFO(name, " ran no labelled tasks on the thread pool");
+        return;
+    }
+
+    auto windowStart = m_samples.front().enqueueTime;
+    auto windowEnd = m_samples.front().endTime;
+    std::size_t maxQueueDepth = 0;
+    double totalQueueDepth = 0.;
+    std::vector<Micros> waitDurations;
+    std::vector<Micros> runDurations;
+    std::map<std::string_view, std::pair<std::vector<Micros>, std::vector<Micros>>> labelDurations;
+    std::vector<Micros> workerBusyDurations(m_numWorkers, Micros(0));
+    for (auto const& sample : m_samples)
+    {
+        windowStart = std::min(windowStart, sample.enqueueTime);
+        windowEnd = std::max(windowEnd, sample.endTime);
+        maxQueueDepth = std::max(maxQueueDepth, sample.queueDepth);
+        totalQueueDepth += static_cast<double>(sample.queueDepth);
+
+        auto waitDuration = std::chrono::duration_cast<Micros>(sample.startTime - sample.enqueueTime);
+        auto runDuration = std::chrono::duration_cast<Micros>(sample.endTime - sample.startTime);
+        waitDurations.push_back(waitDuration);
+        runDurations.push_back(runDuration);
+
+        auto& [labelWaitDurations, labelRunDurations] = labelDurations[sample.pLabel];
+        labelWaitDurations.push_back(waitDuration);
+        labelRunDurations.push_back(runDuration);
+
+        if (sample.workerIdx < workerBusyDurations.size())
+        {
+            workerBusyDurations[sample.workerIdx] += runDuration;
+        }
+    }
+
+    auto window = std::chrono::duration_cast<Micros>(windowEnd - windowStart);
+    LOG_INFO(
+        name, " thread pool: ", m_samples.size(), " tasks over ", formatMs(window),
+        "; queue depth mean=", totalQueueDepth / static_cast<double>(m_samples.size()), " max=", maxQueueDepth,
+        "; ", formatDistribution("wait", waitDurations),
+        "; ", formatDistribution("run", runDurations)
+    );
+
+    for (auto const& [label, durations] : labelDurations)
+    {
+        LOG_INFO(
+            name, " thread pool: ", label, " ran ", durations.first.size(), " tasks; ",
+            formatDistribution("wait", durations.first), "; ",
+            formatDistribution("run", durations.second)
+        );
+    }
+
+    std::stringstream ss;
+    ss.precision(0);
+    ss << std::fixed;
+    for (std::size_t i = 0; i < workerBusyDurations.size(); ++i)
+    {
+        double busyRatio = (window.count() > 0) ? static_cast<double>(workerBusyDurations[i].count()) / static_cast<double>(window.count()) : 0.;
+        ss << ((i == 0) ? "" : ", ") << i << "=" << busyRatio * 100. << "%";
+    }
+    LOG_INFO(name, " thread pool: worker busy ratios ", ss.str());
+}
+
+/**
+ * Append every sample to a CSV file (one row per task), writing the header first if the file is new.
+ * Times are relative to the UNIX epoch, so that runs can be lined up against each other.
+ */
+void ThreadPoolStats::exportCsv(std::filesystem::path const& filePath, std::string const& name) const
+{
+    bool bNewFile = !std::filesystem::exists(filePath) || (std::filesystem::file_size(filePath) == 0);
+    std::ofstream file(filePath, std::ios::app);
+    LOG_ERROR_THROW(
+        file.is_open(),
+        "Failed to open thread pool stats file! filePath=", filePath.string()
+    );
+
+    if (bNewFile)
+    {
+        file << "job,label,worker,enqueued_at_ms,wait_us,run_us,queue_depth\n";
+    }
+
+    auto systemNow = std::chrono::system_clock::now();
+    auto steadyNow = std::chrono::steady_clock::now();
+    for (auto const& sample : m_samples)
+    {
+        auto enqueuedAt = systemNow - std::chrono::duration_cast<std::chrono::system_clock::duration>(steadyNow - sample.enqueueTime);
+        file << name << ",\"" << sample.pLabel << "\"," << sample.workerIdx << ","
+             << std::chrono::duration_cast<std::chrono::milliseconds>(enqueuedAt.time_since_epoch()).count() << ","
+             << std::chrono::duration_cast<Micros>(sample.startTime - sample.enqueueTime).count() << ","
+             << std::chrono::duration_cast<Micros>(sample.endTime - sample.startTime).count() << ","
+             << sample.queueDepth << "\n";
+    }
+
+    LOG_ERROR_THROW(
+        file.good(),
+        "Failed to write thread pool stats file! filePath=", filePath.string()
+    );
+    LOG_DEBUG("Exported ", m_samples.size(), " thread pool samples to ", filePath.string());
+}
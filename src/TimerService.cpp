@@ -0,0 +1,179 @@
+#include "TimerService.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+namespace
+{
+// Cancelled timers are only looked for this often, since finding them means going through the whole heap
+constexpr std::chrono::milliseconds k_cancelCheckInterval(1000);
+} /* namespace */
+
+/**
+ * TimerService constructor.
+ */
+TimerService::TimerService(std::shared_ptr<ThreadPool> pThreadPool)
+    : m_pThreadPool(pThreadPool)
+    , m_nextSeq(0)
+    , m_bStop(false)
+{
+    m_timerThread = std::thread(
+    [this]()
+    {
+        timerThread_();
+    });
+}
+
+/**
+ * TimerService destructor.
+ * Every timer must have fired by now, since their coroutines can't be resumed anymore afterwards.
+ */
+TimerService::~TimerService() noexcept
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_bStop = true;
+    }
+    m_condition.notify_all();
+
+    if (m_timerThread.joinable())
+    {
+        m_timerThread.join();
+    }
+
+    if (!m_timers.empty())
+    {
+        LOG_WARN("TimerService destroyed with ", m_timers.size(), " timers still pending");
+    }
+}
+
+/**
+ * Wait for delay without blocking a thread. The awaiting coroutine is resumed on the ThreadPool.
+ * Throws OperationCancelled if the token is cancelled, including mid-wait.
+ */
+[[nodiscard]] TimerService::SleepAwaiter TimerService::sleepFor(std::chrono::milliseconds const& delay, std::shared_ptr<CancellationToken> pCancelToken)
+{
+    return SleepAwaiter(*this, delay, pCancelToken);
+}
+
+/**
+ * SleepAwaiter constructor.
+ */
+TimerService::SleepAwaiter::SleepAwaiter(TimerService& timerService, std::chrono::milliseconds const& delay, std::shared_ptr<CancellationToken> pCancelToken)
+    : m_timerService(timerService)
+    , m_delay(delay)
+    , m_pCancelToken(pCancelToken ? pCancelToken : std::make_shared<CancellationToken>())
+{}
+
+/**
+ * Hand the wait over to the timer thread.
+ */
+void TimerService::SleepAwaiter::await_suspend(std::coroutine_handle<> handle)
+{
+    m_timerService.addTimer_(std::chrono::steady_clock::now() + m_delay, handle, m_pCancelToken);
+}
+
+/**
+ * Push a timer onto the heap, waking the timer thread up if it's now the earliest one.
+ */
+void TimerService::addTimer_(std::chrono::steady_clock::time_point const& deadline, std::coroutine_handle<> handle, std::shared_ptr<CancellationToken> pCancelToken)
+{
+    bool bEarliest = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+
+        Timer_ timer;
+        timer.deadline = deadline;
+        timer.seq = m_nextSeq++;
+        uint64_t seq = timer.seq;
+        timer.handle = handle;
+        timer.pLabel = ThreadPool::currentLabel();
+        timer.pCancelToken = std::move(pCancelToken);
+
+        m_timers.push_back(std::move(timer));
+        std::push_heap(m_timers.begin(), m_timers.end(), TimerLater_());
+        bEarliest = (m_timers.front().seq == seq);
+    }
+
+    if (bEarliest)
+    {
+        m_condition.notify_one();
+    }
+}
+
+/**
+ * Sleep until the earliest deadline (or the next check for cancelled timers), and resume whatever is due, until the service is destroyed.
+ */
+void TimerService::timerThread_()
+{
+    auto nextCancelCheck = std::chrono::steady_clock::now() + k_cancelCheckInterval;
+    while (true)
+    {
+        std::vector<Timer_> dueTimers;
+        {
+            std::unique_lock<std::mutex> lock(m_mtx);
+            auto wakeTime = m_timers.empty() ? nextCancelCheck : std::min(m_timers.front().deadline, nextCancelCheck);
+            m_condition.wait_until(lock, wakeTime,
+            [this, &wakeTime]()
+            {
+                return m_bStop || (!m_timers.empty() && (m_timers.front().deadline < wakeTime));
+            });
+            if (m_bStop)
+            {
+                return;
+            }
+
+            takeDueTimers_(dueTimers);
+            if (std::chrono::steady_clock::now() >= nextCancelCheck)
+            {
+                auto it = std::partition(m_timers.begin(), m_timers.end(),
+                [](Timer_ const& timer)
+                {
+                    return !timer.pCancelToken->isCancelled();
+                });
+                std::move(it, m_timers.end(), std::back_inserter(dueTimers));
+                m_timers.erase(it, m_timers.end());
+                std::make_heap(m_timers.begin(), m_timers.end(), TimerLater_());
+                nextCancelCheck = std::chrono::steady_clock::now() + k_cancelCheckInterval;
+            }
+        }
+
+        for (auto const& timer : dueTimers)
+        {
+            resume_(timer.handle, timer.pLabel);
+        }
+    }
+}
+
+/**
+ * Pop every timer whose deadline is up. Must be called with m_mtx held.
+ */
+void TimerService::takeDueTimers_(std::vector<Timer_>& dueTimers /* out */)
+{
+    auto now = std::chrono::steady_clock::now();
+    while (!m_timers.empty() && (m_timers.front().deadline <= now))
+    {
+        std::pop_heap(m_timers.begin(), m_timers.end(), TimerLater_());
+        dueTimers.push_back(std::move(m_timers.back()));
+        m_timers.pop_back();
+    }
+}
+
+/**
+ * Resume a coroutine on the ThreadPool, under the label it was suspended under.
+ * If the pool has already been shut down, there's nowhere else to run it but here.
+ */
+void TimerService::resume_(std::coroutine_handle<> handle, char const* pLabel)
+{
+    try
+    {
+        m_pThreadPool->resume(handle, pLabel);
+    }
+    catch (std::runtime_error const& e)
+    {
+        LOG_WARN("Failed to resume coroutine on the thread pool; ", e.what(), " - resuming it on the timer thread instead");
+        handle.resume();
+    }
+}
@@ -1,5 +1,6 @@
 #include "Bot.h"
 #include "Logger.h"
+#include "DosuConfig.h"
 
 #include <iostream>
 #include <fstream>
@@ -12,6 +13,7 @@
 #include <thread>
 #include <algorithm>
 #include <utility>
+#include <stdexcept>
 
 namespace
 {
@@ -47,12 +49,19 @@ bool parseMetadata(dpp::message const& message, EmbedMetadata& metadata /* out *
 
 /**
  * Bot constructor.
+ * User interactions are handled on pThreadPool's interactive lane, so that they don't queue up behind a running job's work.
  */
-Bot::Bot(std::string const& botToken, std::shared_ptr<RankingsDatabase> pRankingsDb, std::shared_ptr<TopPlaysDatabase> pTopPlaysDb, std::shared_ptr<BotConfigDatabase> pBotConfigDb)
+Bot::Bot(
+    std::string const& botToken,
+    std::shared_ptr<RankingsDatabase> pRankingsDb,
+    std::shared_ptr<TopPlaysDatabase> pTopPlaysDb,
+    std::shared_ptr<BotConfigDatabase> pBotConfigDb,
+    std::shared_ptr<ThreadPool> pThreadPool)
     : m_bot(botToken)
     , m_pRankingsDb(pRankingsDb)
     , m_pTopPlaysDb(pTopPlaysDb)
     , m_pBotConfigDb(pBotConfigDb)
+    , m_pThreadPool(pThreadPool)
     , m_bIsInitialized(false)
 {
     LOG_DEBUG("Constructing Bot");
@@ -81,9 +90,21 @@ void Bot::start()
 
     m_onLogId = m_bot.on_log(std::bind(&Bot::onLog_, this, std::placeholders::_1));
     m_onReadyId = m_bot.on_ready(std::bind(&Bot::onReady_, this, std::placeholders::_1));
-    m_onSlashCommandId = m_bot.on_slashcommand(std::bind(&Bot::onSlashCommand_, this, std::placeholders::_1));
-    m_onButtonClickId = m_bot.on_button_click(std::bind(&Bot::onButtonClick_, this, std::placeholders::_1));
-    m_onFormSubmitId = m_bot.on_form_submit(std::bind(&Bot::onFormSubmit_, this, std::placeholders::_1));
+    m_onSlashCommandId = m_bot.on_slashcommand(
+    [this](dpp::slashcommand_t const& event)
+    {
+        runInteractive_([this, event]() { onSlashCommand_(event); });
+    });
+    m_onButtonClickId = m_bot.on_button_click(
+    [this](dpp::button_click_t const& event)
+    {
+        runInteractive_([this, event]() { onButtonClick_(event); });
+    });
+    m_onFormSubmitId = m_bot.on_form_submit(
+    [this](dpp::form_submit_t const& event)
+    {
+        runInteractive_([this, event]() { onFormSubmit_(event); });
+    });
 
     m_bot.start(dpp::st_return);
 
@@ -147,7 +168,7 @@ void Bot::topPlaysCallback()
     // Build message
     dpp::message message;
     LOG_ERROR_THROW(
-        buildTopPlaysNewsletter_(k_global, Gamemode(0), k_allMods, message),
+        buildTopPlaysNewsletter_(k_global, Gamemode(0), k_allMods, 1, message),
         "Callback was triggered, but failed to build newsletter!"
     );
 
@@ -362,13 +383,35 @@ void Bot::onButtonClick_(dpp::button_click_t const& event)
     {
         dpp::message message = event.command.msg;
 
-        if (!buildTopPlaysNewsletter_(k_global, Gamemode(0), k_allMods, message))
+        if (!buildTopPlaysNewsletter_(k_global, Gamemode(0), k_allMods, 1, message))
         {
             LOG_ERROR(k_topPlaysResetAllButtonID, " was pressed, but failed to build newsletter!");
             event.reply(dpp::message("Failed to build new embed! This is a bug.").set_flags(dpp::m_ephemeral));
             return;
         }
 
+        m_bot.message_edit(message, std::bind(&Bot::onCompletionReply_, this, std::placeholders::_1, buttonID, event));
+    }
+    else if (buttonID == k_topPlaysTogglePeriodButtonID)
+    {
+        dpp::message message = event.command.msg;
+
+        EmbedMetadata embedMetadata;
+        if (!parseMetadata(message, embedMetadata))
+        {
+            LOG_ERROR("Failed to parse metadata for current embed!");
+            event.reply(dpp::message("Failed to parse metadata! This is a bug.").set_flags(dpp::m_ephemeral));
+            return;
+        }
+
+        int periodDays = (embedMetadata.getPeriodDays() > 1) ? 1 : DosuConfig::topPlaysWindowDays;
+        if (!buildTopPlaysNewsletter_(embedMetadata.getCountryCode(), embedMetadata.getGamemode(), embedMetadata.getMods().toString(), periodDays, message))
+        {
+            LOG_ERROR(k_topPlaysTogglePeriodButtonID, " was pressed with periodDays=", periodDays, ", but failed to build newsletter!");
+            event.reply(dpp::message("Failed to build new embed! This is a bug.").set_flags(dpp::m_ephemeral));
+            return;
+        }
+
         m_bot.message_edit(message, std::bind(&Bot::onCompletionReply_, this, std::placeholders::_1, buttonID, event));
     }
 }
@@ -398,6 +441,11 @@ void Bot::onFormSubmit_(dpp::form_submit_t const& event)
             return;
         }
 
+        if (countryCode != k_global)
+        {
+            m_pBotConfigDb->recordCountryFilterUsage(countryCode);
+        }
+
         dpp::message message = event.command.msg;
 
         EmbedMetadata embedMetadata;
@@ -466,6 +514,11 @@ void Bot::onFormSubmit_(dpp::form_submit_t const& event)
             return;
         }
 
+        if (countryCode != k_global)
+        {
+            m_pBotConfigDb->recordCountryFilterUsage(countryCode);
+        }
+
         dpp::message message = event.command.msg;
 
         EmbedMetadata embedMetadata;
@@ -476,7 +529,7 @@ void Bot::onFormSubmit_(dpp::form_submit_t const& event)
             return;
         }
 
-        if (!buildTopPlaysNewsletter_(countryCode, embedMetadata.getGamemode(), embedMetadata.getMods().toString(), message))
+        if (!buildTopPlaysNewsletter_(countryCode, embedMetadata.getGamemode(), embedMetadata.getMods().toString(), embedMetadata.getPeriodDays(), message))
         {
             LOG_ERROR(k_topPlaysFilterCountryModalID, " was submitted with countryCode=", countryInput, ", but failed to build newsletter!");
             event.reply(dpp::message("Failed to build new embed! This is a bug.").set_flags(dpp::m_ephemeral));
@@ -513,7 +566,7 @@ void Bot::onFormSubmit_(dpp::form_submit_t const& event)
             return;
         }
 
-        if(!buildTopPlaysNewsletter_(embedMetadata.getCountryCode(), embedMetadata.getGamemode(), mods.toString(), message))
+        if(!buildTopPlaysNewsletter_(embedMetadata.getCountryCode(), embedMetadata.getGamemode(), mods.toString(), embedMetadata.getPeriodDays(), message))
         {
             LOG_ERROR(k_topPlaysFilterModsModalID, " was submitted with mods=", mods.toString(), ", but failed to build newsletter!");
             event.reply(dpp::message("Failed to build new embed! This is a bug.").set_flags(dpp::m_ephemeral));
@@ -546,7 +599,7 @@ void Bot::onFormSubmit_(dpp::form_submit_t const& event)
             return;
         }
 
-        if (!buildTopPlaysNewsletter_(embedMetadata.getCountryCode(), mode, embedMetadata.getMods().toString(), message))
+        if (!buildTopPlaysNewsletter_(embedMetadata.getCountryCode(), mode, embedMetadata.getMods().toString(), embedMetadata.getPeriodDays(), message))
         {
             LOG_ERROR(k_topPlaysSelectModeModalID, " was submitted with mode=", modeInput, ", but failed to build newsletter!");
             event.reply(dpp::message("Failed to build new embed! This is a bug.").set_flags(dpp::m_ephemeral));
@@ -557,6 +610,36 @@ void Bot::onFormSubmit_(dpp::form_submit_t const& event)
     }
 }
 
+/**
+ * Run an event handler on the thread pool's interactive lane, so that it's picked up ahead of whatever batch of work a job has queued up,
+ * and doesn't hold up DPP's event threads while it queries the databases.
+ * If the pool has already been shut down (i.e. we're shutting down), the handler runs right here instead.
+ */
+void Bot::runInteractive_(std::function<void()> handler)
+{
+    auto guardedHandler = [handler]()
+    {
+        try
+        {
+            handler();
+        }
+        catch (std::exception const& e)
+        {
+            LOG_ERROR("Failed to handle Discord event; ", e.what());
+        }
+    };
+
+    try
+    {
+        static_cast<void>(m_pThreadPool->submit(TaskPriority::Interactive, guardedHandler));
+    }
+    catch (std::runtime_error const& e)
+    {
+        LOG_WARN("Failed to hand Discord event to the thread pool; ", e.what(), " - handling it on the event thread instead");
+        guardedHandler();
+    }
+}
+
 /**
  * Generic completion callback handler.
  */
@@ -639,7 +722,7 @@ void Bot::cmdNewsletter_(dpp::slashcommand_t const& event)
     }
     else if (newsletterPage == k_newsletterPageOptionTopPlays.second)
     {
-        if (!buildTopPlaysNewsletter_(k_global, Gamemode(0), k_allMods, message))
+        if (!buildTopPlaysNewsletter_(k_global, Gamemode(0), k_allMods, 1, message))
         {
             LOG_WARN("Got command, but failed to build newsletter! newsletterPage=", newsletterPage);
             event.reply(dpp::message("Couldn't find newsletter! If you still see this message tomorrow, it might be a bug.").set_flags(dpp::m_ephemeral));
@@ -764,9 +847,9 @@ void Bot::deleteGlobalCommand_(std::string const& cmdName)
 {
     LOG_DEBUG("Building scrapeRankings newsletter for countryCode=", countryCode, ", rankRange=", rankRange.toString(), ", mode=", mode.toString());
 
-    auto lastWriteTime = m_pRankingsDb->lastWriteTime();
-    auto now = std::filesystem::file_time_type::clock::now();
-    std::chrono::hours ageHours = std::chrono::duration_cast<std::chrono::hours>(now - lastWriteTime);
+    auto lastScrapeTime = m_pRankingsDb->lastScrapeTime();
+    auto now = std::chrono::system_clock::now();
+    std::chrono::hours ageHours = std::chrono::duration_cast<std::chrono::hours>(now - lastScrapeTime);
     if (ageHours > k_maxValidScrapeRankingsHour)
     {
         LOG_WARN("Data is invalid - ageHours=", ageHours.count(), " > ", k_maxValidScrapeRankingsHour.count());
@@ -781,10 +864,11 @@ void Bot::deleteGlobalCommand_(std::string const& cmdName)
 
     LOG_DEBUG("Data is valid - building rankings newsletter");
 
-    auto range = rankRange.toRange();
+    auto range = rankRange.toRange(countryCode);
     std::vector<RankImprovement> rangeTop = m_pRankingsDb->getTopRankImprovements(countryCode, range.first, range.second, k_numDisplayUsers, mode);
     std::vector<RankImprovement> rangeBottom = m_pRankingsDb->getBottomRankImprovements(countryCode, range.first, range.second, k_numDisplayUsers, mode);
-    dpp::embed newsletterEmbed = m_pEmbedGenerator->scrapeRankingsEmbed(countryCode, rankRange, mode, rangeTop, rangeBottom);
+    std::vector<UsernameChange> rangeUsernameChanges = m_pRankingsDb->getUsernameChanges(countryCode, range.first, range.second, k_numDisplayUsernameChanges, mode);
+    dpp::embed newsletterEmbed = m_pEmbedGenerator->scrapeRankingsEmbed(countryCode, rankRange, mode, rangeTop, rangeBottom, rangeUsernameChanges);
 
     message.embeds.clear();
     message.components.clear();
@@ -799,9 +883,9 @@ void Bot::deleteGlobalCommand_(std::string const& cmdName)
 /**
  * Build scrapeRankings newsletter. Returns true if data was valid, false otherwise.
  */
-[[nodiscard]] bool Bot::buildTopPlaysNewsletter_(std::string const& countryCode, Gamemode const& mode, std::string const& mods, dpp::message& message /* out */)
+[[nodiscard]] bool Bot::buildTopPlaysNewsletter_(std::string const& countryCode, Gamemode const& mode, std::string const& mods, int const& periodDays, dpp::message& message /* out */)
 {
-    LOG_DEBUG("Building getTopPlays newsletter for countryCode=", countryCode, ", mode=", mode.toString(), ", mods=", mods);
+    LOG_DEBUG("Building getTopPlays newsletter for countryCode=", countryCode, ", mode=", mode.toString(), ", mods=", mods, ", periodDays=", periodDays);
 
     auto lastWriteTime = m_pTopPlaysDb->lastWriteTime();
     auto now = std::filesystem::file_time_type::clock::now();
@@ -820,9 +904,11 @@ void Bot::deleteGlobalCommand_(std::string const& cmdName)
 
     LOG_DEBUG("Data is valid - building top plays newsletter");
 
-    std::vector<TopPlay> topPlays = m_pTopPlaysDb->getTopPlays(countryCode, k_numDisplayTopPlays, mode, mods);
+    std::vector<TopPlay> topPlays = (periodDays > 1)
+        ? m_pTopPlaysDb->getWindowTopPlays(countryCode, k_numDisplayTopPlays, mode, mods)
+        : m_pTopPlaysDb->getTopPlays(countryCode, k_numDisplayTopPlays, mode, mods);
 
-    dpp::embed newsletterEmbed = m_pEmbedGenerator->topPlaysEmbed(topPlays, mode, countryCode, mods);
+    dpp::embed newsletterEmbed = m_pEmbedGenerator->topPlaysEmbed(topPlays, mode, countryCode, mods, periodDays);
 
     message.embeds.clear();
     message.components.clear();
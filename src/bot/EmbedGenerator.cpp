@@ -112,6 +112,18 @@ namespace
     }
 }
 
+/**
+ * Convert rank range bounds to a label, e.g. "#101 - #1000", or "#1001+" if the range is open-ended.
+ */
+[[nodiscard]] std::string rangeToLabel(std::pair<int64_t, int64_t> const& range) noexcept
+{
+    if (range.second == INT64_MAX)
+    {
+        return "#" + std::to_string(range.first) + "+";
+    }
+    return "#" + std::to_string(range.first) + " - #" + std::to_string(range.second);
+}
+
 /**
  * Convert mods to discord emoji string.
  */
@@ -229,7 +241,8 @@ namespace
     RankRange const& rankRange,
     Gamemode const& mode,
     std::vector<RankImprovement> const& top,
-    std::vector<RankImprovement> const& bottom) const
+    std::vector<RankImprovement> const& bottom,
+    std::vector<UsernameChange> const& usernameChanges) const
 {
     LOG_DEBUG("Building scrapeRankings embed for range=", rankRange.toString(), ", mode=", mode.toString(), "countryCode=", countryCode);
 
@@ -267,10 +280,16 @@ namespace
     description << std::fixed << std::setprecision(2);
 
     embed.set_color(rankRangeToColor(rankRange));
-    description << "## :up_arrow: Largest rank increases (#" << rankRange.toRange().first << " - #" << rankRange.toRange().second << "):\n";
+    std::string rangeLabel = rangeToLabel(rankRange.toRange(countryCode));
+    description << "## :up_arrow: Largest rank increases (" << rangeLabel << "):\n";
     addPlayersToScrapeRankingsDescription_(description, top, true, mode);
-    description << "## :down_arrow: Largest rank decreases (#" << rankRange.toRange().first << " - #" << rankRange.toRange().second << "):\n";
+    description << "## :down_arrow: Largest rank decreases (" << rangeLabel << "):\n";
     addPlayersToScrapeRankingsDescription_(description, bottom, false, mode);
+    if (!usernameChanges.empty())
+    {
+        description << "## :pencil: Name changes (" << rangeLabel << "):\n";
+        addUsernameChangesToDescription_(description, usernameChanges, mode);
+    }
 
     embed.set_description(description.str());
 
@@ -284,9 +303,10 @@ namespace
     std::vector<TopPlay> const& topPlays,
     Gamemode const& mode,
     std::string const& countryCode,
-    std::string const& mods) const
+    std::string const& mods,
+    int const& periodDays) const
 {
-    LOG_DEBUG("Building getTopPlays embed for mode=", mode.toString(), ", countryCode=", countryCode, ", mods=", mods);
+    LOG_DEBUG("Building getTopPlays embed for mode=", mode.toString(), ", countryCode=", countryCode, ", mods=", mods, ", periodDays=", periodDays);
 
     // Add static embed fields
     int utcHour = localToUtc(DosuConfig::topPlaysRunHour);
@@ -304,7 +324,7 @@ namespace
         );
 
     // Add variable embed fields
-    embed.add_field("", EmbedMetadata(countryCode, std::nullopt, mode, OsuMods(mods)).toEmbedString());
+    embed.add_field("", EmbedMetadata(countryCode, std::nullopt, mode, OsuMods(mods), periodDays).toEmbedString());
     if (!topPlays.empty())
     {
         embed.set_thumbnail(topPlays.at(0).score.user.pfpLink);
@@ -317,7 +337,14 @@ namespace
     std::stringstream description;
     description << std::fixed << std::setprecision(2);
 
-    description << "## :medal: Top plays:\n";
+    if (periodDays > 1)
+    {
+        description << "## :medal: Top plays of the last " << periodDays << " days:\n";
+    }
+    else
+    {
+        description << "## :medal: Top plays:\n";
+    }
     addPlayersToTopPlaysDescription_(description, topPlays, mode);
 
     embed.set_description(description.str());
@@ -434,6 +461,17 @@ namespace
     actionRow.add_component(selectModeButton);
     actionRow.add_component(clearFiltersButton);
 
+    // Only useful if there's a rolling window to switch to
+    if (DosuConfig::topPlaysWindowDays > 1)
+    {
+        dpp::component togglePeriodButton;
+        togglePeriodButton.set_type(dpp::cot_button);
+        togglePeriodButton.set_label("Today / last " + std::to_string(DosuConfig::topPlaysWindowDays) + " days");
+        togglePeriodButton.set_style(dpp::cos_primary);
+        togglePeriodButton.set_id(k_topPlaysTogglePeriodButtonID);
+        actionRow.add_component(togglePeriodButton);
+    }
+
     return actionRow;
 }
 
@@ -596,6 +634,25 @@ void EmbedGenerator::addPlayersToScrapeRankingsDescription_(
     }
 }
 
+/**
+ * Helper function for scrapeRankingsEmbed.
+ * Format and pipe to description.
+ */
+void EmbedGenerator::addUsernameChangesToDescription_(
+    std::stringstream& description /* out */,
+    std::vector<UsernameChange> const& usernameChanges,
+    Gamemode const& mode) const noexcept
+{
+    for (std::size_t i = 0; (i < usernameChanges.size()) && (i < k_numDisplayUsernameChanges); ++i)
+    {
+        UsernameChange usernameChange = usernameChanges.at(i);
+        std::transform(usernameChange.countryCode.begin(), usernameChange.countryCode.end(), usernameChange.countryCode.begin(), ::tolower);
+
+        description << "▸ :flag_" << usernameChange.countryCode << ": " << usernameChange.oldUsername << " is now **[" << usernameChange.newUsername << \
+            "](https://osu.ppy.sh/users/" << usernameChange.userID << "/" << mode.toString() << ")** (#" << usernameChange.currentRank << ")\n";
+    }
+}
+
 /**
  * Helper function for topPlaysEmbed.
  * Format and pipe to description.
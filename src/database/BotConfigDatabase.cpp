@@ -2,6 +2,7 @@
 #include "Logger.h"
 
 #include <cstdint>
+#include <chrono>
 
 /**
  * BotConfigDatabase constructor.
@@ -127,6 +128,43 @@ void BotConfigDatabase::removeSubscription(dpp::snowflake const& channelID, std:
     return (query.executeStep() && query.getColumn(0).getInt64() > 0);
 }
 
+/**
+ * Count a newsletter being filtered by countryCode.
+ */
+void BotConfigDatabase::recordCountryFilterUsage(std::string const& countryCode)
+{
+    std::lock_guard<std::mutex> lock(m_dbMtx);
+    LOG_DEBUG("Recording country filter usage for ", countryCode);
+
+    int64_t now = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    SQLite::Statement query(*m_pDatabase,
+        "INSERT INTO CountryFilterUsage (countryCode, numUses, lastUsedAt) "
+        "VALUES (?, 1, ?) "
+        "ON CONFLICT(countryCode) DO UPDATE SET numUses = numUses + 1, lastUsedAt = excluded.lastUsedAt"
+    );
+    query.bind(1, countryCode);
+    query.bind(2, now);
+    query.exec();
+}
+
+/**
+ * Get how many times each country has been filtered by.
+ */
+[[nodiscard]] std::unordered_map<std::string, int64_t> BotConfigDatabase::getCountryFilterUsage()
+{
+    std::lock_guard<std::mutex> lock(m_dbMtx);
+    LOG_DEBUG("Retrieving country filter usage");
+
+    std::unordered_map<std::string, int64_t> countryFilterUsage;
+    SQLite::Statement query(*m_pDatabase, "SELECT countryCode, numUses FROM CountryFilterUsage");
+    while (query.executeStep())
+    {
+        countryFilterUsage.emplace(query.getColumn(0).getString(), query.getColumn(1).getInt64());
+    }
+
+    return countryFilterUsage;
+}
+
 /**
  * WARNING: This function is not thread-safe!
  * Check if channel exists.
@@ -158,4 +196,12 @@ void BotConfigDatabase::createTables_()
         k_newsletterToTableMap.at(k_newsletterPageOptionTopPlays.second) + " INTEGER NOT NULL"
         ")"
     );
+
+    m_pDatabase->exec(
+        "CREATE TABLE IF NOT EXISTS CountryFilterUsage ("
+        "countryCode TEXT PRIMARY KEY, "
+        "numUses INTEGER NOT NULL, "
+        "lastUsedAt INTEGER NOT NULL"
+        ")"
+    );
 }
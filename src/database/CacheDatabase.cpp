@@ -0,0 +1,475 @@
+#include "CacheDatabase.h"
+#include "Logger.h"
+
+#include <cstdint>
+#include <unordered_set>
+
+namespace
+{
+/**
+ * How long beatmap metadata can be reused for, based on its ranked status.
+ * Ranked/approved maps basically never change (barring star rating reworks), unranked ones can be updated at any time.
+ */
+[[nodiscard]] std::chrono::hours beatmapStatusToTtl(BeatmapStatus const& status) noexcept
+{
+    if ((status == "ranked") || (status == "approved"))
+    {
+        return k_rankedBeatmapTtl;
+    }
+    else if (status == "loved")
+    {
+        return k_lovedBeatmapTtl;
+    }
+    else
+    {
+        return k_unrankedBeatmapTtl;
+    }
+}
+
+/**
+ * Comma-separated list of n SQL placeholders.
+ */
+[[nodiscard]] std::string placeholderList(std::size_t const& n)
+{
+    std::string placeholders = "";
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        placeholders += (i == 0) ? "?" : ", ?";
+    }
+    return placeholders;
+}
+
+/**
+ * Current time in seconds since epoch.
+ */
+[[nodiscard]] int64_t nowEpochSeconds() noexcept
+{
+    return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+} /* namespace */
+
+/**
+ * CacheDatabase constructor.
+ */
+CacheDatabase::CacheDatabase(std::filesystem::path const& dbFilePath)
+: m_dbFilePath(dbFilePath)
+{
+    std::lock_guard<std::mutex> lock(m_dbMtx);
+    LOG_DEBUG("Opening database connection for cache; dbFilePath=", dbFilePath.string());
+    m_pDatabase = std::make_unique<SQLite::Database>(dbFilePath.string(), SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+    createTables_();
+}
+
+/**
+ * CacheDatabase destructor.
+ */
+CacheDatabase::~CacheDatabase()
+{
+    std::lock_guard<std::mutex> lock(m_dbMtx);
+    LOG_DEBUG("Closing database connection for cache");
+    if (m_pDatabase->getTotalChanges() > 0)
+    {
+        try
+        {
+            m_pDatabase->exec("COMMIT");
+        }
+        catch(SQLite::Exception const& e)
+        {}
+    }
+
+    m_pDatabase.reset();
+}
+
+/**
+ * Get cached beatmaps that haven't expired yet.
+ * Beatmaps that are unknown or stale are simply missing from the returned map.
+ */
+[[nodiscard]] std::unordered_map<BeatmapID, Beatmap> CacheDatabase::getBeatmaps(std::vector<BeatmapID> const& beatmapIDs)
+{
+    std::lock_guard<std::mutex> lock(m_dbMtx);
+    LOG_DEBUG("Retrieving ", beatmapIDs.size(), " beatmaps from cache");
+
+    std::unordered_map<BeatmapID, Beatmap> results;
+    if (beatmapIDs.empty())
+    {
+        return results;
+    }
+
+    SQLite::Statement query(*m_pDatabase,
+        "SELECT beatmapID, starRating, difficultyName, artist, title, mapsetCreator, maxCombo "
+        "FROM Beatmaps "
+        "WHERE expiresAt > ? AND beatmapID IN (" + placeholderList(beatmapIDs.size()) + ")"
+    );
+
+    query.bind(1, nowEpochSeconds());
+    for (std::size_t i = 0; i < beatmapIDs.size(); ++i)
+    {
+        query.bind(static_cast<int>(i) + 2, beatmapIDs[i]);
+    }
+
+    while (query.executeStep())
+    {
+        Beatmap beatmap;
+        beatmap.beatmapID      = query.getColumn(0).getInt64();
+        beatmap.starRating     = query.getColumn(1).getDouble();
+        beatmap.difficultyName = query.getColumn(2).getString();
+        beatmap.artist         = query.getColumn(3).getString();
+        beatmap.title          = query.getColumn(4).getString();
+        beatmap.mapsetCreator  = query.getColumn(5).getString();
+        beatmap.maxCombo       = query.getColumn(6).getInt64();
+
+        results[beatmap.beatmapID] = beatmap;
+    }
+
+    return results;
+}
+
+/**
+ * Perform batch upsert of beatmaps, setting their expiry according to their ranked status.
+ */
+void CacheDatabase::upsertBeatmaps(std::vector<std::pair<Beatmap, BeatmapStatus>> const& beatmaps)
+{
+    std::lock_guard<std::mutex> lock(m_dbMtx);
+    LOG_DEBUG("Upserting ", beatmaps.size(), " beatmaps into cache");
+
+    int64_t now = nowEpochSeconds();
+
+    SQLite::Transaction txn(*m_pDatabase);
+    SQLite::Statement query(*m_pDatabase,
+        "INSERT OR REPLACE INTO Beatmaps "
+        "(beatmapID, starRating, difficultyName, artist, title, mapsetCreator, maxCombo, status, fetchedAt, expiresAt) "
+        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)"
+    );
+
+    for (auto const& [beatmap, status] : beatmaps)
+    {
+        int64_t ttlSeconds = std::chrono::duration_cast<std::chrono::seconds>(beatmapStatusToTtl(status)).count();
+
+        query.reset();
+        query.bind(1, beatmap.beatmapID);
+        query.bind(2, beatmap.starRating);
+        query.bind(3, beatmap.difficultyName);
+        query.bind(4, beatmap.artist);
+        query.bind(5, beatmap.title);
+        query.bind(6, beatmap.mapsetCreator);
+        query.bind(7, beatmap.maxCombo);
+        query.bind(8, status);
+        query.bind(9, now);
+        query.bind(10, now + ttlSeconds);
+        query.exec();
+    }
+
+    txn.commit();
+}
+
+/**
+ * Get cached user profiles for given mode that are younger than k_userProfileMaxAge.
+ * Users that are unknown or stale are simply missing from the returned map.
+ */
+[[nodiscard]] std::unordered_map<UserID, RankingsUser> CacheDatabase::getUserProfiles(std::vector<UserID> const& userIDs, Gamemode const& mode)
+{
+    std::lock_guard<std::mutex> lock(m_dbMtx);
+    LOG_DEBUG("Retrieving ", userIDs.size(), " ", mode.toString(), " user profiles from cache");
+
+    std::unordered_map<UserID, RankingsUser> results;
+    if (userIDs.empty())
+    {
+        return results;
+    }
+
+    SQLite::Statement query(*m_pDatabase,
+        "SELECT userID, username, countryCode, pfpLink, performancePoints, accuracy, hoursPlayed, globalRank "
+        "FROM UserProfiles "
+        "WHERE mode = ? AND updatedAt > ? AND userID IN (" + placeholderList(userIDs.size()) + ")"
+    );
+
+    query.bind(1, mode.toInt());
+    query.bind(2, nowEpochSeconds() - std::chrono::duration_cast<std::chrono::seconds>(k_userProfileMaxAge).count());
+    for (std::size_t i = 0; i < userIDs.size(); ++i)
+    {
+        query.bind(static_cast<int>(i) + 3, userIDs[i]);
+    }
+
+    while (query.executeStep())
+    {
+        RankingsUser user;
+        user.userID            = query.getColumn(0).getInt64();
+        user.username          = query.getColumn(1).getString();
+        user.countryCode       = query.getColumn(2).getString();
+        user.pfpLink           = query.getColumn(3).getString();
+        user.performancePoints = query.getColumn(4).getDouble();
+        user.accuracy          = query.getColumn(5).getDouble();
+        user.hoursPlayed       = query.getColumn(6).getInt64();
+        user.currentRank       = query.getColumn(7).getInt64();
+
+        results[user.userID] = user;
+    }
+
+    return results;
+}
+
+/**
+ * Perform batch upsert of user profiles for given mode, marking them as fresh.
+ */
+void CacheDatabase::upsertUserProfiles(std::vector<RankingsUser> const& users, Gamemode const& mode)
+{
+    std::lock_guard<std::mutex> lock(m_dbMtx);
+    LOG_DEBUG("Upserting ", users.size(), " ", mode.toString(), " user profiles into cache");
+
+    int64_t now = nowEpochSeconds();
+
+    SQLite::Transaction txn(*m_pDatabase);
+    SQLite::Statement query(*m_pDatabase,
+        "INSERT OR REPLACE INTO UserProfiles "
+        "(userID, mode, username, countryCode, pfpLink, performancePoints, accuracy, hoursPlayed, globalRank, updatedAt) "
+        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)"
+    );
+
+    for (auto const& user : users)
+    {
+        if (user.isValid())
+        {
+            query.reset();
+            query.bind(1, user.userID);
+            query.bind(2, mode.toInt());
+            query.bind(3, user.username);
+            query.bind(4, user.countryCode);
+            query.bind(5, user.pfpLink);
+            query.bind(6, user.performancePoints);
+            query.bind(7, user.accuracy);
+            query.bind(8, user.hoursPlayed);
+            query.bind(9, user.currentRank);
+            query.bind(10, now);
+            query.exec();
+        }
+    }
+
+    txn.commit();
+}
+
+/**
+ * Replace everything staged for a rankings page with a freshly fetched copy of it.
+ * Users that moved to another page since are overwritten by whichever page was fetched last.
+ */
+void CacheDatabase::replaceStagingPage(Page const& page, std::vector<RankingsUser> const& rankingsUsers, Gamemode const& mode)
+{
+    std::lock_guard<std::mutex> lock(m_dbMtx);
+    LOG_DEBUG("Staging ", rankingsUsers.size(), " ", mode.toString(), " rankings users from page ", page);
+
+    SQLite::Transaction txn(*m_pDatabase);
+
+    SQLite::Statement deleteQuery(*m_pDatabase, "DELETE FROM StagingRankings WHERE mode = ? AND page = ?");
+    deleteQuery.bind(1, mode.toInt());
+    deleteQuery.bind(2, static_cast<int64_t>(page));
+    deleteQuery.exec();
+
+    SQLite::Statement insertQuery(*m_pDatabase,
+        "INSERT OR REPLACE INTO StagingRankings "
+        "(userID, mode, username, countryCode, pfpLink, performancePoints, accuracy, hoursPlayed, currentRank, page) "
+        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)"
+    );
+
+    for (auto const& rankingsUser : rankingsUsers)
+    {
+        if (rankingsUser.isValid())
+        {
+            insertQuery.reset();
+            insertQuery.bind(1, rankingsUser.userID);
+            insertQuery.bind(2, mode.toInt());
+            insertQuery.bind(3, rankingsUser.username);
+            insertQuery.bind(4, rankingsUser.countryCode);
+            insertQuery.bind(5, rankingsUser.pfpLink);
+            insertQuery.bind(6, rankingsUser.performancePoints);
+            insertQuery.bind(7, rankingsUser.accuracy);
+            insertQuery.bind(8, rankingsUser.hoursPlayed);
+            insertQuery.bind(9, rankingsUser.currentRank);
+            insertQuery.bind(10, static_cast<int64_t>(page));
+            insertQuery.exec();
+        }
+    }
+
+    SQLite::Statement pageQuery(*m_pDatabase,
+        "INSERT OR REPLACE INTO StagingPages (mode, page, fetchedAt) VALUES (?, ?, ?)"
+    );
+    pageQuery.bind(1, mode.toInt());
+    pageQuery.bind(2, static_cast<int64_t>(page));
+    pageQuery.bind(3, nowEpochSeconds());
+    pageQuery.exec();
+
+    txn.commit();
+}
+
+/**
+ * Get the staged rankings page that was fetched the longest time ago, along with when it was fetched.
+ * Pages that were never fetched come first, with a fetch time of 0.
+ */
+[[nodiscard]] std::pair<Page, int64_t> CacheDatabase::getStalestStagingPage(Gamemode const& mode)
+{
+    std::lock_guard<std::mutex> lock(m_dbMtx);
+    LOG_DEBUG("Finding stalest staged rankings page for ", mode.toString());
+
+    std::unordered_map<Page, int64_t> pageFetchTimes;
+    SQLite::Statement query(*m_pDatabase, "SELECT page, fetchedAt FROM StagingPages WHERE mode = ?");
+    query.bind(1, mode.toInt());
+    while (query.executeStep())
+    {
+        pageFetchTimes[static_cast<Page>(query.getColumn(0).getInt64())] = query.getColumn(1).getInt64();
+    }
+
+    std::pair<Page, int64_t> stalestPage = { 0, INT64_MAX };
+    for (Page page = 0; page < k_getRankingIDMaxPage; ++page)
+    {
+        auto it = pageFetchTimes.find(page);
+        int64_t fetchedAt = (it == pageFetchTimes.end()) ? 0 : it->second;
+        if (fetchedAt < stalestPage.second)
+        {
+            stalestPage = { page, fetchedAt };
+        }
+    }
+
+    return stalestPage;
+}
+
+/**
+ * Get every rankings page that hasn't been staged within maxAge.
+ */
+[[nodiscard]] std::vector<Page> CacheDatabase::getStaleStagingPages(std::chrono::hours const& maxAge, Gamemode const& mode)
+{
+    std::lock_guard<std::mutex> lock(m_dbMtx);
+    LOG_DEBUG("Finding staged rankings pages older than ", maxAge.count(), " hours for ", mode.toString());
+
+    std::unordered_set<Page> freshPages;
+    SQLite::Statement query(*m_pDatabase, "SELECT page FROM StagingPages WHERE mode = ? AND fetchedAt > ?");
+    query.bind(1, mode.toInt());
+    query.bind(2, nowEpochSeconds() - std::chrono::duration_cast<std::chrono::seconds>(maxAge).count());
+    while (query.executeStep())
+    {
+        freshPages.insert(static_cast<Page>(query.getColumn(0).getInt64()));
+    }
+
+    std::vector<Page> stalePages;
+    for (Page page = 0; page < k_getRankingIDMaxPage; ++page)
+    {
+        if (!freshPages.contains(page))
+        {
+            stalePages.push_back(page);
+        }
+    }
+
+    return stalePages;
+}
+
+/**
+ * Get every staged rankings user for given mode, sorted by rank.
+ */
+[[nodiscard]] std::vector<RankingsUser> CacheDatabase::getStagingRankingsUsers(Gamemode const& mode)
+{
+    std::lock_guard<std::mutex> lock(m_dbMtx);
+    LOG_DEBUG("Retrieving staged rankings users for ", mode.toString());
+
+    std::vector<RankingsUser> rankingsUsers;
+    rankingsUsers.reserve(k_numRankingsUsers);
+
+    SQLite::Statement query(*m_pDatabase,
+        "SELECT userID, username, countryCode, pfpLink, performancePoints, accuracy, hoursPlayed, currentRank "
+        "FROM StagingRankings "
+        "WHERE mode = ? "
+        "ORDER BY currentRank ASC"
+    );
+    query.bind(1, mode.toInt());
+
+    while (query.executeStep())
+    {
+        RankingsUser rankingsUser;
+        rankingsUser.userID            = query.getColumn(0).getInt64();
+        rankingsUser.username          = query.getColumn(1).getString();
+        rankingsUser.countryCode       = query.getColumn(2).getString();
+        rankingsUser.pfpLink           = query.getColumn(3).getString();
+        rankingsUser.performancePoints = query.getColumn(4).getDouble();
+        rankingsUser.accuracy          = query.getColumn(5).getDouble();
+        rankingsUser.hoursPlayed       = query.getColumn(6).getInt64();
+        rankingsUser.currentRank       = query.getColumn(7).getInt64();
+
+        rankingsUsers.push_back(rankingsUser);
+    }
+
+    return rankingsUsers;
+}
+
+/**
+ * Create database tables if they don't exist.
+ * Does not use a mutex.
+ */
+void CacheDatabase::createTables_()
+{
+    LOG_DEBUG("Creating tables");
+
+    try
+    {
+        SQLite::Transaction txn(*m_pDatabase);
+
+        m_pDatabase->exec(
+            "CREATE TABLE IF NOT EXISTS Beatmaps ("
+            "   beatmapID      INTEGER  PRIMARY KEY, "
+            "   starRating     REAL     NOT NULL,    "
+            "   difficultyName TEXT     NOT NULL,    "
+            "   artist         TEXT     NOT NULL,    "
+            "   title          TEXT     NOT NULL,    "
+            "   mapsetCreator  TEXT     NOT NULL,    "
+            "   maxCombo       INTEGER  NOT NULL,    "
+            "   status         TEXT     NOT NULL,    "
+            "   fetchedAt      INTEGER  NOT NULL,    "
+            "   expiresAt      INTEGER  NOT NULL     "
+            ")"
+        );
+
+        m_pDatabase->exec(
+            "CREATE TABLE IF NOT EXISTS UserProfiles ("
+            "   userID            INTEGER  NOT NULL, "
+            "   mode              INTEGER  NOT NULL, "
+            "   username          TEXT     NOT NULL, "
+            "   countryCode       TEXT     NOT NULL, "
+            "   pfpLink           TEXT     NOT NULL, "
+            "   performancePoints REAL     NOT NULL, "
+            "   accuracy          REAL     NOT NULL, "
+            "   hoursPlayed       INTEGER  NOT NULL, "
+            "   globalRank        INTEGER  NOT NULL, "
+            "   updatedAt         INTEGER  NOT NULL, "
+            "   PRIMARY KEY (userID, mode)           "
+            ")"
+        );
+
+        m_pDatabase->exec(
+            "CREATE TABLE IF NOT EXISTS StagingRankings ("
+            "   userID            INTEGER  NOT NULL, "
+            "   mode              INTEGER  NOT NULL, "
+            "   username          TEXT     NOT NULL, "
+            "   countryCode       TEXT     NOT NULL, "
+            "   pfpLink           TEXT     NOT NULL, "
+            "   performancePoints REAL     NOT NULL, "
+            "   accuracy          REAL     NOT NULL, "
+            "   hoursPlayed       INTEGER  NOT NULL, "
+            "   currentRank       INTEGER  NOT NULL, "
+            "   page              INTEGER  NOT NULL, "
+            "   PRIMARY KEY (userID, mode)           "
+            ")"
+        );
+        m_pDatabase->exec("CREATE INDEX IF NOT EXISTS StagingRankingsPageIdx ON StagingRankings (mode, page)");
+
+        m_pDatabase->exec(
+            "CREATE TABLE IF NOT EXISTS StagingPages ("
+            "   mode      INTEGER  NOT NULL, "
+            "   page      INTEGER  NOT NULL, "
+            "   fetchedAt INTEGER  NOT NULL, "
+            "   PRIMARY KEY (mode, page)     "
+            ")"
+        );
+
+        txn.commit();
+    }
+    catch (std::exception const& e)
+    {
+        LOG_ERROR("Failed to create tables; ", e.what());
+        throw;
+    }
+}
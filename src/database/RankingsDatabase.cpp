@@ -1,16 +1,55 @@
 #include "RankingsDatabase.h"
 #include "Logger.h"
 
+#include <unordered_set>
+#include <optional>
+
+namespace
+{
+/**
+ * Get what to select rank improvements from. When filtering by country, players that were scraped
+ * from the country rankings (past the global top 10k) are included as well.
+ */
+[[nodiscard]] std::string rankImprovementsSource(std::string const& countryCode, Gamemode const& mode)
+{
+    std::string table = k_modeToRankingsTable.at(mode);
+    if (countryCode == k_global)
+    {
+        return table;
+    }
+
+    std::string columns = "userID, username, countryCode, pfpLink, performancePoints, accuracy, hoursPlayed, yesterdayRank, currentRank";
+    return
+        "(SELECT " + columns + " FROM " + table + " "
+        "UNION ALL "
+        "SELECT " + columns + " FROM " + k_modeToCountryRankingsTable.at(mode) + ")";
+}
+
+const std::string k_lastScrapeTimeKey = "lastScrapeTime";
+} /* namespace */
+
 /**
  * RankingsDatabase constructor.
+ * Creating (or migrating) tables doesn't count as a write, so the database file's modification time is left as it was.
  */
 RankingsDatabase::RankingsDatabase(std::filesystem::path const& dbFilePath)
 : m_dbFilePath(dbFilePath)
 {
     std::lock_guard<std::mutex> lock(m_dbMtx);
     LOG_DEBUG("Opening database connection for rankings; dbFilePath=", dbFilePath.string());
+    std::optional<std::filesystem::file_time_type> oLastWriteTime;
+    if (std::filesystem::exists(dbFilePath))
+    {
+        oLastWriteTime = std::filesystem::last_write_time(dbFilePath);
+    }
+
     m_pDatabase = std::make_unique<SQLite::Database>(dbFilePath.string(), SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
     createTables_();
+
+    if (oLastWriteTime)
+    {
+        std::filesystem::last_write_time(dbFilePath, *oLastWriteTime);
+    }
 }
 
 /**
@@ -34,15 +73,38 @@ RankingsDatabase::~RankingsDatabase()
 }
 
 /**
- * Return time of last write to database.
- * NOTE: The whole database, not a specific table!
+ * Return when the last scrape finished.
+ * Databases that have never recorded one fall back to the time of last write to the database (NOTE: the whole database, not a specific table!).
+ */
+[[nodiscard]] std::chrono::system_clock::time_point RankingsDatabase::lastScrapeTime()
+{
+    std::lock_guard<std::mutex> lock(m_dbMtx);
+    LOG_DEBUG("Getting time of last scrape");
+
+    SQLite::Statement query(*m_pDatabase, "SELECT value FROM " + k_rankingsMetadataTable + " WHERE key = ?");
+    query.bind(1, k_lastScrapeTimeKey);
+    if (query.executeStep())
+    {
+        return std::chrono::system_clock::time_point(std::chrono::seconds(query.getColumn(0).getInt64()));
+    }
+
+    return std::chrono::time_point_cast<std::chrono::system_clock::duration>(
+        std::chrono::file_clock::to_sys(std::filesystem::last_write_time(m_dbFilePath))
+    );
+}
+
+/**
+ * Record when a scrape finished. Wiping tables leaves it as it was, so that a scrape that fails halfway isn't mistaken for a fresh one.
  */
-[[nodiscard]] std::filesystem::file_time_type RankingsDatabase::lastWriteTime()
+void RankingsDatabase::setLastScrapeTime(std::chrono::system_clock::time_point const& scrapeTime)
 {
     std::lock_guard<std::mutex> lock(m_dbMtx);
-    LOG_DEBUG("Getting time of last write to database");
+    LOG_DEBUG("Setting time of last scrape");
 
-    return std::filesystem::last_write_time(m_dbFilePath);
+    SQLite::Statement query(*m_pDatabase, "INSERT OR REPLACE INTO " + k_rankingsMetadataTable + " (key, value) VALUES (?, ?)");
+    query.bind(1, k_lastScrapeTimeKey);
+    query.bind(2, static_cast<int64_t>(std::chrono::duration_cast<std::chrono::seconds>(scrapeTime.time_since_epoch()).count()));
+    query.exec();
 }
 
 /**
@@ -61,6 +123,14 @@ void RankingsDatabase::wipeTables()
         {
             m_pDatabase->exec("DELETE FROM " + table);
         }
+        for (auto const& [_, countryTable] : k_modeToCountryRankingsTable)
+        {
+            m_pDatabase->exec("DELETE FROM " + countryTable);
+        }
+        for (auto const& [_, usernameChangesTable] : k_modeToUsernameChangesTable)
+        {
+            m_pDatabase->exec("DELETE FROM " + usernameChangesTable);
+        }
 
         txn.commit();
     }
@@ -72,120 +142,440 @@ void RankingsDatabase::wipeTables()
 }
 
 /**
- * Clear yesterday's ranks and move current ranks into their place.
+ * Replace yesterday's snapshot of the rankings with today's, in a single transaction.
+ * The diff is done in memory (keyed by userID), so each row is written at most once, only with the columns that changed, and not at all
+ * if nothing did:
+ * - users that are still ranked get their current rank shifted into yesterdayRank,
+ * - users that dropped out are deleted,
+ * - users whose username changed are recorded as today's username changes.
+ * Users that show up more than once (e.g. they moved between two pages while those were being fetched) are only counted once, at their better rank.
+ * Returns the IDs of users that weren't ranked yesterday, whose yesterdayRank is unknown (and needs to be fetched).
  */
-void RankingsDatabase::shiftRanks(Gamemode const& mode)
+[[nodiscard]] std::vector<UserID> RankingsDatabase::applyRankingsSnapshot(std::vector<RankingsUser> const& rankingsUsers, Gamemode const& mode)
 {
     std::lock_guard<std::mutex> lock(m_dbMtx);
-    LOG_DEBUG("Shifting ranks for ", mode.toString());
+    LOG_DEBUG("Applying snapshot of ", rankingsUsers.size(), " rankings users to ", mode.toString());
 
     const std::string table = k_modeToRankingsTable.at(mode);
-    const std::string query =
-        "UPDATE " + table + " "
-        "SET yesterdayRank = currentRank, "
-        "currentRank = NULL;";
+    const std::string usernameChangesTable = k_modeToUsernameChangesTable.at(mode);
 
-    m_pDatabase->exec(query);
-}
+    SQLite::Transaction txn(*m_pDatabase);
 
-/**
- * Perform batch insert of users.
- */
-void RankingsDatabase::insertRankingsUsers(std::vector<RankingsUser> const& rankingsUsers, Gamemode const& mode)
-{
-    std::lock_guard<std::mutex> lock(m_dbMtx);
-    LOG_DEBUG("Inserting ", rankingsUsers.size(), " rankings users into ", mode.toString());
+    // Only the latest day's username changes are kept
+    m_pDatabase->exec("DELETE FROM " + usernameChangesTable);
 
-    const std::string table = k_modeToRankingsTable.at(mode);
+    // Load yesterday's snapshot
+    std::unordered_map<UserID, RankingsUser> existingUsers;
+    {
+        SQLite::Statement selectQuery(*m_pDatabase,
+            "SELECT userID, username, countryCode, pfpLink, performancePoints, accuracy, hoursPlayed, yesterdayRank, currentRank FROM " + table
+        );
+        while (selectQuery.executeStep())
+        {
+            RankingsUser existingUser;
+            existingUser.userID = selectQuery.getColumn(0).getInt64();
+            existingUser.username = selectQuery.getColumn(1).getString();
+            existingUser.countryCode = selectQuery.getColumn(2).getString();
+            existingUser.pfpLink = selectQuery.getColumn(3).getString();
+            existingUser.performancePoints = selectQuery.getColumn(4).getDouble();
+            existingUser.accuracy = selectQuery.getColumn(5).getDouble();
+            existingUser.hoursPlayed = selectQuery.getColumn(6).getInt64();
+            existingUser.yesterdayRank = selectQuery.getColumn(7).isNull() ? 0 : selectQuery.getColumn(7).getInt64();
+            existingUser.currentRank = selectQuery.getColumn(8).isNull() ? 0 : selectQuery.getColumn(8).getInt64();
+            existingUsers[existingUser.userID] = existingUser;
+        }
+    }
 
-    SQLite::Transaction txn(*m_pDatabase);
-    SQLite::Statement query(*m_pDatabase,
+    std::unordered_map<UserID, RankingsUser const*> rankedUsers;
+    rankedUsers.reserve(rankingsUsers.size());
+    for (auto const& rankingsUser : rankingsUsers)
+    {
+        if (!rankingsUser.isValid())
+        {
+            continue;
+        }
+
+        auto [it, bInserted] = rankedUsers.try_emplace(rankingsUser.userID, &rankingsUser);
+        if (!bInserted && (rankingsUser.currentRank < it->second->currentRank))
+        {
+            it->second = &rankingsUser;
+        }
+    }
+
+    // Users that dropped out go first
+    SQLite::Statement deleteQuery(*m_pDatabase, "DELETE FROM " + table + " WHERE userID = ?");
+
+    std::size_t numDropped = 0;
+    for (auto const& [userID, _] : existingUsers)
+    {
+        if (rankedUsers.contains(userID))
+        {
+            continue;
+        }
+
+        deleteQuery.reset();
+        deleteQuery.bind(1, userID);
+        deleteQuery.exec();
+        ++numDropped;
+    }
+
+    SQLite::Statement insertQuery(*m_pDatabase,
         "INSERT OR REPLACE INTO " + table + " "
-        "(userID, username, countryCode, pfpLink, performancePoints, accuracy, hoursPlayed, currentRank, yesterdayRank) "
-        "SELECT ?, ?, ?, ?, ?, ?, ?, ?, "
-        "   (SELECT yesterdayRank FROM " + table + " WHERE userID = ?)"
+        "(userID, username, countryCode, pfpLink, performancePoints, accuracy, hoursPlayed, yesterdayRank, currentRank) "
+        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)"
+    );
+    SQLite::Statement profileUpdateQuery(*m_pDatabase,
+        "UPDATE " + table + " "
+        "SET username = ?, countryCode = ?, pfpLink = ?, performancePoints = ?, accuracy = ?, hoursPlayed = ?, yesterdayRank = ?, currentRank = ? "
+        "WHERE userID = ?"
+    );
+    SQLite::Statement statsUpdateQuery(*m_pDatabase,
+        "UPDATE " + table + " "
+        "SET performancePoints = ?, accuracy = ?, hoursPlayed = ?, yesterdayRank = ?, currentRank = ? "
+        "WHERE userID = ?"
+    );
+    SQLite::Statement rankUpdateQuery(*m_pDatabase,
+        "UPDATE " + table + " "
+        "SET yesterdayRank = ?, currentRank = ? "
+        "WHERE userID = ?"
+    );
+    SQLite::Statement usernameChangeQuery(*m_pDatabase,
+        "INSERT INTO " + usernameChangesTable + " "
+        "(userID, oldUsername, newUsername, countryCode, pfpLink, currentRank) "
+        "VALUES (?, ?, ?, ?, ?, ?)"
     );
 
+    std::vector<UserID> unknownYesterdayRankUserIDs;
+    std::size_t numInserted = 0;
+    std::size_t numProfileUpdates = 0;
+    std::size_t numStatsUpdates = 0;
+    std::size_t numRankOnlyUpdates = 0;
+    std::size_t numUnchanged = 0;
+    std::size_t numUsernameChanges = 0;
     for (auto const& rankingsUser : rankingsUsers)
     {
-        if (rankingsUser.isValid())
+        if (!rankingsUser.isValid() || (rankedUsers.at(rankingsUser.userID) != &rankingsUser))
+        {
+            continue;
+        }
+
+        auto existingIt = existingUsers.find(rankingsUser.userID);
+        if (existingIt == existingUsers.end())
+        {
+            insertQuery.reset();
+            insertQuery.bind(1, rankingsUser.userID);
+            insertQuery.bind(2, rankingsUser.username);
+            insertQuery.bind(3, rankingsUser.countryCode);
+            insertQuery.bind(4, rankingsUser.pfpLink);
+            insertQuery.bind(5, rankingsUser.performancePoints);
+            insertQuery.bind(6, rankingsUser.accuracy);
+            insertQuery.bind(7, rankingsUser.hoursPlayed);
+            insertQuery.bind(8);
+            insertQuery.bind(9, rankingsUser.currentRank);
+            insertQuery.exec();
+
+            // They weren't ranked yesterday, so only the API knows where they were
+            unknownYesterdayRankUserIDs.push_back(rankingsUser.userID);
+            ++numInserted;
+            continue;
+        }
+
+        RankingsUser const& existingUser = existingIt->second;
+        bool bProfileChanged = (
+            (existingUser.username != rankingsUser.username) ||
+            (existingUser.countryCode != rankingsUser.countryCode) ||
+            (existingUser.pfpLink != rankingsUser.pfpLink)
+        );
+        bool bStatsChanged = (
+            (existingUser.performancePoints != rankingsUser.performancePoints) ||
+            (existingUser.accuracy != rankingsUser.accuracy) ||
+            (existingUser.hoursPlayed != rankingsUser.hoursPlayed)
+        );
+
+        // Yesterday's current rank is today's yesterday rank; if it's somehow missing, the API has to fill it in
+        std::optional<Rank> yesterdayRank = (existingUser.currentRank > 0) ? std::optional<Rank>(existingUser.currentRank) : std::nullopt;
+        if (!yesterdayRank)
+        {
+            unknownYesterdayRankUserIDs.push_back(rankingsUser.userID);
+        }
+
+        // Same rank two days running, so even the rank shift leaves the row as it is
+        if (!bProfileChanged && !bStatsChanged && yesterdayRank && (*yesterdayRank == existingUser.yesterdayRank) && (rankingsUser.currentRank == existingUser.currentRank))
+        {
+            ++numUnchanged;
+            continue;
+        }
+
+        if (existingUser.username != rankingsUser.username)
+        {
+            usernameChangeQuery.reset();
+            usernameChangeQuery.bind(1, rankingsUser.userID);
+            usernameChangeQuery.bind(2, existingUser.username);
+            usernameChangeQuery.bind(3, rankingsUser.username);
+            usernameChangeQuery.bind(4, rankingsUser.countryCode);
+            usernameChangeQuery.bind(5, rankingsUser.pfpLink);
+            usernameChangeQuery.bind(6, rankingsUser.currentRank);
+            usernameChangeQuery.exec();
+            ++numUsernameChanges;
+        }
+
+        if (bProfileChanged)
+        {
+            profileUpdateQuery.reset();
+            profileUpdateQuery.bind(1, rankingsUser.username);
+            profileUpdateQuery.bind(2, rankingsUser.countryCode);
+            profileUpdateQuery.bind(3, rankingsUser.pfpLink);
+            profileUpdateQuery.bind(4, rankingsUser.performancePoints);
+            profileUpdateQuery.bind(5, rankingsUser.accuracy);
+            profileUpdateQuery.bind(6, rankingsUser.hoursPlayed);
+            if (yesterdayRank)
+            {
+                profileUpdateQuery.bind(7, *yesterdayRank);
+            }
+            else
+            {
+                profileUpdateQuery.bind(7);
+            }
+            profileUpdateQuery.bind(8, rankingsUser.currentRank);
+            profileUpdateQuery.bind(9, rankingsUser.userID);
+            profileUpdateQuery.exec();
+            ++numProfileUpdates;
+        }
+        else if (bStatsChanged)
+        {
+            statsUpdateQuery.reset();
+            statsUpdateQuery.bind(1, rankingsUser.performancePoints);
+            statsUpdateQuery.bind(2, rankingsUser.accuracy);
+            statsUpdateQuery.bind(3, rankingsUser.hoursPlayed);
+            if (yesterdayRank)
+            {
+                statsUpdateQuery.bind(4, *yesterdayRank);
+            }
+            else
+            {
+                statsUpdateQuery.bind(4);
+            }
+            statsUpdateQuery.bind(5, rankingsUser.currentRank);
+            statsUpdateQuery.bind(6, rankingsUser.userID);
+            statsUpdateQuery.exec();
+            ++numStatsUpdates;
+        }
+        else
         {
-            query.reset();
-            query.bind(1, rankingsUser.userID);
-            query.bind(2, rankingsUser.username);
-            query.bind(3, rankingsUser.countryCode);
-            query.bind(4, rankingsUser.pfpLink);
-            query.bind(5, rankingsUser.performancePoints);
-            query.bind(6, rankingsUser.accuracy);
-            query.bind(7, rankingsUser.hoursPlayed);
-            query.bind(8, rankingsUser.currentRank);
-            query.bind(9, rankingsUser.userID);
-            query.exec();
+            rankUpdateQuery.reset();
+            if (yesterdayRank)
+            {
+                rankUpdateQuery.bind(1, *yesterdayRank);
+            }
+            else
+            {
+                rankUpdateQuery.bind(1);
+            }
+            rankUpdateQuery.bind(2, rankingsUser.currentRank);
+            rankUpdateQuery.bind(3, rankingsUser.userID);
+            rankUpdateQuery.exec();
+            ++numRankOnlyUpdates;
         }
     }
 
     txn.commit();
+
+    LOG_INFO(
+        "Applied ", mode.toString(), " rankings snapshot: ",
+        numInserted, " new, ",
+        numDropped, " dropped, ",
+        numProfileUpdates, " profile updates, ",
+        numStatsUpdates, " stats/rank updates, ",
+        numRankOnlyUpdates, " rank-only updates (profile and stats unchanged), ",
+        numUnchanged, " unchanged, ",
+        numUsernameChanges, " username changes"
+    );
+
+    return unknownYesterdayRankUserIDs;
 }
 
 /**
- * Remove users with NULL currentRank.
+ * Update yesterdayRank values.
  */
-void RankingsDatabase::deleteUsersWithNullCurrentRank(Gamemode const& mode)
+void RankingsDatabase::updateYesterdayRanks(std::vector<std::pair<UserID, Rank>> const& userYesterdayRanks, Gamemode const& mode)
 {
     std::lock_guard<std::mutex> lock(m_dbMtx);
-    LOG_DEBUG("Removing users with NULL current rank from ", mode.toString());
+    LOG_DEBUG("Updating yesterday ranks of ", userYesterdayRanks.size(), " users from ", mode.toString());
 
     const std::string table = k_modeToRankingsTable.at(mode);
 
-    m_pDatabase->exec("DELETE FROM " + table + " WHERE currentRank IS NULL");
+    SQLite::Transaction txn(*m_pDatabase);
+    SQLite::Statement query(*m_pDatabase,
+        "UPDATE " + table + " "
+        "SET yesterdayRank = ? "
+        "WHERE userID = ?"
+    );
+
+    for (auto const& userYesterdayRank : userYesterdayRanks)
+    {
+        query.reset();
+        query.bind(1, userYesterdayRank.second);
+        query.bind(2, userYesterdayRank.first);
+        query.exec();
+    }
+
+    txn.commit();
 }
 
 /**
- * Get userIDs with NULL yesterdayRank.
+ * Get every ranked user's current rank.
  */
-[[nodiscard]] std::vector<UserID> RankingsDatabase::getUserIDsWithNullYesterdayRank(Gamemode const& mode)
+[[nodiscard]] std::vector<std::pair<UserID, Rank>> RankingsDatabase::getCurrentRanks(Gamemode const& mode)
 {
     std::lock_guard<std::mutex> lock(m_dbMtx);
-    LOG_DEBUG("Finding users with NULL yesterday rank from ", mode.toString());
-
-    const std::string table = k_modeToRankingsTable.at(mode);
+    LOG_DEBUG("Retrieving current ranks from ", mode.toString());
 
-    std::vector<UserID> userIDs;
-    SQLite::Statement query(*m_pDatabase, "SELECT userID FROM " + table + " WHERE yesterdayRank IS NULL");
+    std::vector<std::pair<UserID, Rank>> userCurrentRanks;
+    SQLite::Statement query(*m_pDatabase,
+        "SELECT userID, currentRank FROM " + k_modeToRankingsTable.at(mode) + " WHERE currentRank IS NOT NULL ORDER BY currentRank ASC"
+    );
     while (query.executeStep())
     {
-        userIDs.push_back(query.getColumn(0).getInt64());
+        userCurrentRanks.emplace_back(query.getColumn(0).getInt64(), query.getColumn(1).getInt64());
     }
 
-    return userIDs;
+    return userCurrentRanks;
 }
 
 /**
- * Update yesterdayRank values.
+ * Replace yesterday's snapshot of the country rankings (i.e. players outside the global top 10k) with today's, in a single transaction.
+ * Players that were fetched get their current rank shifted into yesterdayRank, same as the main table.
+ * Players that weren't fetched (the scraped pages change from day to day) only have their ranks shifted, and are removed if they're missed again.
+ * Players that made it into the main table are removed, since they're already covered there.
  */
-void RankingsDatabase::updateYesterdayRanks(std::vector<std::pair<UserID, Rank>> const& userYesterdayRanks, Gamemode const& mode)
+void RankingsDatabase::applyCountryRankingsSnapshot(std::vector<RankingsUser> const& rankingsUsers, Gamemode const& mode)
 {
     std::lock_guard<std::mutex> lock(m_dbMtx);
-    LOG_DEBUG("Updating yesterday ranks of ", userYesterdayRanks.size(), " users from ", mode.toString());
+    LOG_DEBUG("Applying snapshot of ", rankingsUsers.size(), " country rankings users to ", mode.toString());
 
     const std::string table = k_modeToRankingsTable.at(mode);
+    const std::string countryTable = k_modeToCountryRankingsTable.at(mode);
 
     SQLite::Transaction txn(*m_pDatabase);
-    SQLite::Statement query(*m_pDatabase,
-        "UPDATE " + table + " "
-        "SET yesterdayRank = ? "
+
+    std::unordered_set<UserID> globalUserIDs;
+    {
+        SQLite::Statement selectQuery(*m_pDatabase, "SELECT userID FROM " + table);
+        while (selectQuery.executeStep())
+        {
+            globalUserIDs.insert(selectQuery.getColumn(0).getInt64());
+        }
+    }
+
+    std::unordered_map<UserID, std::optional<Rank>> existingUserRanks;
+    {
+        SQLite::Statement selectQuery(*m_pDatabase, "SELECT userID, currentRank FROM " + countryTable);
+        while (selectQuery.executeStep())
+        {
+            existingUserRanks[selectQuery.getColumn(0).getInt64()] = selectQuery.getColumn(1).isNull()
+                ? std::nullopt
+                : std::optional<Rank>(selectQuery.getColumn(1).getInt64());
+        }
+    }
+
+    SQLite::Statement upsertQuery(*m_pDatabase,
+        "INSERT OR REPLACE INTO " + countryTable + " "
+        "(userID, username, countryCode, pfpLink, performancePoints, accuracy, hoursPlayed, yesterdayRank, currentRank) "
+        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)"
+    );
+
+    std::unordered_set<UserID> fetchedUserIDs;
+    fetchedUserIDs.reserve(rankingsUsers.size());
+    std::size_t numUpserted = 0;
+    for (auto const& rankingsUser : rankingsUsers)
+    {
+        if (!rankingsUser.isValid() || globalUserIDs.contains(rankingsUser.userID) || !fetchedUserIDs.insert(rankingsUser.userID).second)
+        {
+            continue;
+        }
+
+        upsertQuery.reset();
+        upsertQuery.bind(1, rankingsUser.userID);
+        upsertQuery.bind(2, rankingsUser.username);
+        upsertQuery.bind(3, rankingsUser.countryCode);
+        upsertQuery.bind(4, rankingsUser.pfpLink);
+        upsertQuery.bind(5, rankingsUser.performancePoints);
+        upsertQuery.bind(6, rankingsUser.accuracy);
+        upsertQuery.bind(7, rankingsUser.hoursPlayed);
+        auto existingIt = existingUserRanks.find(rankingsUser.userID);
+        if ((existingIt != existingUserRanks.end()) && existingIt->second)
+        {
+            upsertQuery.bind(8, *existingIt->second);
+        }
+        else
+        {
+            upsertQuery.bind(8);
+        }
+        upsertQuery.bind(9, rankingsUser.currentRank);
+        upsertQuery.exec();
+        ++numUpserted;
+    }
+
+    SQLite::Statement shiftQuery(*m_pDatabase,
+        "UPDATE " + countryTable + " "
+        "SET yesterdayRank = currentRank, currentRank = NULL "
         "WHERE userID = ?"
     );
+    SQLite::Statement deleteQuery(*m_pDatabase, "DELETE FROM " + countryTable + " WHERE userID = ?");
 
-    for (auto const& userYesterdayRank : userYesterdayRanks)
+    std::size_t numShifted = 0;
+    std::size_t numRemoved = 0;
+    for (auto const& [userID, currentRank] : existingUserRanks)
     {
-        query.reset();
-        query.bind(1, userYesterdayRank.second);
-        query.bind(2, userYesterdayRank.first);
-        query.exec();
+        if (fetchedUserIDs.contains(userID))
+        {
+            continue;
+        }
+
+        if (currentRank && !globalUserIDs.contains(userID))
+        {
+            shiftQuery.reset();
+            shiftQuery.bind(1, userID);
+            shiftQuery.exec();
+            ++numShifted;
+        }
+        else
+        {
+            deleteQuery.reset();
+            deleteQuery.bind(1, userID);
+            deleteQuery.exec();
+            ++numRemoved;
+        }
     }
 
     txn.commit();
+
+    LOG_INFO(
+        "Applied ", mode.toString(), " country rankings snapshot: ",
+        numUpserted, " fetched, ",
+        numShifted, " not fetched today, ",
+        numRemoved, " removed"
+    );
+}
+
+/**
+ * Get how many players from each country are in the main rankings table.
+ */
+[[nodiscard]] std::unordered_map<std::string, std::size_t> RankingsDatabase::getNumRankedUsersByCountry(Gamemode const& mode)
+{
+    std::lock_guard<std::mutex> lock(m_dbMtx);
+    LOG_DEBUG("Counting ranked users per country from ", mode.toString());
+
+    std::unordered_map<std::string, std::size_t> numRankedUsersByCountry;
+    SQLite::Statement query(*m_pDatabase,
+        "SELECT countryCode, COUNT(*) FROM " + k_modeToRankingsTable.at(mode) + " GROUP BY countryCode"
+    );
+    while (query.executeStep())
+    {
+        numRankedUsersByCountry.emplace(query.getColumn(0).getString(), static_cast<std::size_t>(query.getColumn(1).getInt64()));
+    }
+
+    return numRankedUsersByCountry;
 }
 
 /**
@@ -223,7 +613,7 @@ void RankingsDatabase::updateYesterdayRanks(std::vector<std::pair<UserID, Rank>>
     std::lock_guard<std::mutex> lock(m_dbMtx);
     LOG_DEBUG("Retrieving top users by rank improvement from ", mode.toString());
 
-    std::string table = k_modeToRankingsTable.at(mode);
+    std::string source = rankImprovementsSource(countryCode, mode);
 
     std::vector<RankImprovement> results;
     SQLite::Statement query(*m_pDatabase,
@@ -238,7 +628,7 @@ void RankingsDatabase::updateYesterdayRanks(std::vector<std::pair<UserID, Rank>>
         "   yesterdayRank, "
         "   currentRank, "
         "   CAST(yesterdayRank - currentRank AS FLOAT) / currentRank AS relative_improvement "
-        "FROM " + table + " "
+        "FROM " + source + " "
         "WHERE "
         "   currentRank IS NOT NULL "
         "   AND yesterdayRank IS NOT NULL "
@@ -291,7 +681,7 @@ void RankingsDatabase::updateYesterdayRanks(std::vector<std::pair<UserID, Rank>>
     std::lock_guard<std::mutex> lock(m_dbMtx);
     LOG_DEBUG("Retrieving bottom users by rank improvement from ", mode.toString());
 
-    std::string table = k_modeToRankingsTable.at(mode);
+    std::string source = rankImprovementsSource(countryCode, mode);
 
     std::vector<RankImprovement> results;
     SQLite::Statement query(*m_pDatabase,
@@ -306,7 +696,7 @@ void RankingsDatabase::updateYesterdayRanks(std::vector<std::pair<UserID, Rank>>
         "   yesterdayRank, "
         "   currentRank, "
         "   CAST(currentRank - yesterdayRank AS FLOAT) / currentRank AS relative_improvement "
-        "FROM " + table + " "
+        "FROM " + source + " "
         "WHERE "
         "   currentRank IS NOT NULL "
         "   AND yesterdayRank IS NOT NULL "
@@ -345,6 +735,56 @@ void RankingsDatabase::updateYesterdayRanks(std::vector<std::pair<UserID, Rank>>
     return results;
 }
 
+/**
+ * Get players whose username changed in the latest snapshot, sorted by rank.
+ * Entering "GLOBAL" for countryCode means no filter.
+ */
+[[nodiscard]] std::vector<UsernameChange> RankingsDatabase::getUsernameChanges(
+    std::string const& countryCode,
+    int64_t const& minRank,
+    int64_t const& maxRank,
+    std::size_t const& numUsers,
+    Gamemode const& mode)
+{
+    std::lock_guard<std::mutex> lock(m_dbMtx);
+    LOG_DEBUG("Retrieving username changes from ", mode.toString());
+
+    std::string usernameChangesTable = k_modeToUsernameChangesTable.at(mode);
+
+    std::vector<UsernameChange> results;
+    SQLite::Statement query(*m_pDatabase,
+        "SELECT userID, oldUsername, newUsername, countryCode, pfpLink, currentRank "
+        "FROM " + usernameChangesTable + " "
+        "WHERE "
+        "   currentRank >= ? "
+        "   AND currentRank <= ? "
+        "   AND (countryCode = ? OR ? = '" + k_global + "') "
+        "ORDER BY currentRank ASC "
+        "LIMIT ?"
+    );
+
+    query.bind(1, minRank);
+    query.bind(2, maxRank);
+    query.bind(3, countryCode);
+    query.bind(4, countryCode);
+    query.bind(5, static_cast<int64_t>(numUsers));
+
+    while (query.executeStep())
+    {
+        UsernameChange usernameChange;
+        usernameChange.userID = query.getColumn(0).getInt64();
+        usernameChange.oldUsername = query.getColumn(1).getString();
+        usernameChange.newUsername = query.getColumn(2).getString();
+        usernameChange.countryCode = query.getColumn(3).getString();
+        usernameChange.pfpLink = query.getColumn(4).getString();
+        usernameChange.currentRank = query.getColumn(5).getInt64();
+
+        results.push_back(usernameChange);
+    }
+
+    return results;
+}
+
 /**
  * Create database tables if they don't exist.
  * Does not use a mutex.
@@ -359,21 +799,79 @@ void RankingsDatabase::createTables_()
 
         for (auto const& [_, table] : k_modeToRankingsTable)
         {
+            // Usernames used to be UNIQUE, which broke as soon as two players swapped names; rebuild old tables without it
+            bool bHasUniqueUsername = false;
+            {
+                SQLite::Statement query(*m_pDatabase, "SELECT sql FROM sqlite_master WHERE type = 'table' AND name = ?");
+                query.bind(1, table);
+                bHasUniqueUsername = (query.executeStep() && (query.getColumn(0).getString().find("UNIQUE") != std::string::npos));
+            }
+            if (bHasUniqueUsername)
+            {
+                LOG_INFO("Rebuilding ", table, " without a unique constraint on username");
+                m_pDatabase->exec("ALTER TABLE " + table + " RENAME TO " + table + "Old");
+            }
+
             m_pDatabase->exec(
                 "CREATE TABLE IF NOT EXISTS " + table + " ("
-                "   userID            INTEGER  PRIMARY KEY,     "
-                "   username          TEXT     NOT NULL UNIQUE, "
-                "   countryCode       TEXT     NOT NULL,        "
-                "   pfpLink           TEXT     NOT NULL,        "
-                "   performancePoints REAL     NOT NULL,        "
-                "   accuracy          REAL     NOT NULL,        "
-                "   hoursPlayed       INTEGER  NOT NULL,        "
-                "   yesterdayRank     INTEGER,                  "
-                "   currentRank       INTEGER                   "
+                "   userID            INTEGER  PRIMARY KEY, "
+                "   username          TEXT     NOT NULL,    "
+                "   countryCode       TEXT     NOT NULL,    "
+                "   pfpLink           TEXT     NOT NULL,    "
+                "   performancePoints REAL     NOT NULL,    "
+                "   accuracy          REAL     NOT NULL,    "
+                "   hoursPlayed       INTEGER  NOT NULL,    "
+                "   yesterdayRank     INTEGER,              "
+                "   currentRank       INTEGER               "
+                ")"
+            );
+
+            if (bHasUniqueUsername)
+            {
+                m_pDatabase->exec("INSERT INTO " + table + " SELECT * FROM " + table + "Old");
+                m_pDatabase->exec("DROP TABLE " + table + "Old");
+            }
+        }
+
+        // Same as the main table
+        for (auto const& [_, countryTable] : k_modeToCountryRankingsTable)
+        {
+            m_pDatabase->exec(
+                "CREATE TABLE IF NOT EXISTS " + countryTable + " ("
+                "   userID            INTEGER  PRIMARY KEY, "
+                "   username          TEXT     NOT NULL,    "
+                "   countryCode       TEXT     NOT NULL,    "
+                "   pfpLink           TEXT     NOT NULL,    "
+                "   performancePoints REAL     NOT NULL,    "
+                "   accuracy          REAL     NOT NULL,    "
+                "   hoursPlayed       INTEGER  NOT NULL,    "
+                "   yesterdayRank     INTEGER,              "
+                "   currentRank       INTEGER               "
                 ")"
             );
         }
 
+        for (auto const& [_, usernameChangesTable] : k_modeToUsernameChangesTable)
+        {
+            m_pDatabase->exec(
+                "CREATE TABLE IF NOT EXISTS " + usernameChangesTable + " ("
+                "   userID      INTEGER  PRIMARY KEY, "
+                "   oldUsername TEXT     NOT NULL,    "
+                "   newUsername TEXT     NOT NULL,    "
+                "   countryCode TEXT     NOT NULL,    "
+                "   pfpLink     TEXT     NOT NULL,    "
+                "   currentRank INTEGER  NOT NULL     "
+                ")"
+            );
+        }
+
+        m_pDatabase->exec(
+            "CREATE TABLE IF NOT EXISTS " + k_rankingsMetadataTable + " ("
+            "   key   TEXT     PRIMARY KEY, "
+            "   value INTEGER  NOT NULL     "
+            ")"
+        );
+
         txn.commit();
     }
     catch (std::exception const& e)
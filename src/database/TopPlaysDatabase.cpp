@@ -1,6 +1,94 @@
 #include "TopPlaysDatabase.h"
 #include "Logger.h"
 
+namespace
+{
+const std::string k_topPlayColumns =
+    "scoreID, mods, performancePoints, accuracy, totalScore, createdAt, combo, letterRank, count300, count100, count50, countMiss, "
+    "beatmapID, beatmapStarRating, beatmapDifficultyName, beatmapArtist, beatmapTitle, mapsetCreator, beatmapMaxCombo, "
+    "userID, username, userCountryCode, userPfpLink, userPerformancePoints, userAccuracy, userHoursPlayed, userCurrentRank";
+
+/**
+ * Bind everything but the rank of a top play, in the order of k_topPlayColumns, starting at firstIdx.
+ */
+void bindTopPlay(SQLite::Statement& query /* out */, TopPlay const& topPlay, int const& firstIdx)
+{
+    int i = firstIdx;
+
+    query.bind(i++, topPlay.score.scoreID);
+    query.bind(i++, topPlay.score.mods.toString());
+    query.bind(i++, topPlay.score.performancePoints);
+    query.bind(i++, topPlay.score.accuracy);
+    query.bind(i++, topPlay.score.totalScore);
+    query.bind(i++, topPlay.score.createdAt.toString());
+    query.bind(i++, topPlay.score.combo);
+    query.bind(i++, topPlay.score.letterRank);
+    query.bind(i++, topPlay.score.count300);
+    query.bind(i++, topPlay.score.count100);
+    query.bind(i++, topPlay.score.count50);
+    query.bind(i++, topPlay.score.countMiss);
+
+    query.bind(i++, topPlay.score.beatmap.beatmapID);
+    query.bind(i++, topPlay.score.beatmap.starRating);
+    query.bind(i++, topPlay.score.beatmap.difficultyName);
+    query.bind(i++, topPlay.score.beatmap.artist);
+    query.bind(i++, topPlay.score.beatmap.title);
+    query.bind(i++, topPlay.score.beatmap.mapsetCreator);
+    query.bind(i++, topPlay.score.beatmap.maxCombo);
+
+    query.bind(i++, topPlay.score.user.userID);
+    query.bind(i++, topPlay.score.user.username);
+    query.bind(i++, topPlay.score.user.countryCode);
+    query.bind(i++, topPlay.score.user.pfpLink);
+    query.bind(i++, topPlay.score.user.performancePoints);
+    query.bind(i++, topPlay.score.user.accuracy);
+    query.bind(i++, topPlay.score.user.hoursPlayed);
+    query.bind(i++, topPlay.score.user.currentRank);
+}
+
+/**
+ * Read a top play out of a row of rank followed by k_topPlayColumns.
+ */
+TopPlay topPlayFromRow(SQLite::Statement& query)
+{
+    TopPlay topPlay;
+
+    topPlay.rank = query.getColumn(0).getInt64();
+
+    topPlay.score.scoreID           = query.getColumn(1).getInt64();
+    topPlay.score.mods              = OsuMods(query.getColumn(2).getString());
+    topPlay.score.performancePoints = query.getColumn(3).getDouble();
+    topPlay.score.accuracy          = query.getColumn(4).getDouble();
+    topPlay.score.totalScore        = query.getColumn(5).getInt64();
+    topPlay.score.createdAt         = ISO8601DateTimeUTC(query.getColumn(6).getString());
+    topPlay.score.combo             = query.getColumn(7).getInt64();
+    topPlay.score.letterRank        = query.getColumn(8).getString();
+    topPlay.score.count300          = query.getColumn(9).getInt64();
+    topPlay.score.count100          = query.getColumn(10).getInt64();
+    topPlay.score.count50           = query.getColumn(11).getInt64();
+    topPlay.score.countMiss         = query.getColumn(12).getInt64();
+
+    topPlay.score.beatmap.beatmapID      = query.getColumn(13).getInt64();
+    topPlay.score.beatmap.starRating     = query.getColumn(14).getDouble();
+    topPlay.score.beatmap.difficultyName = query.getColumn(15).getString();
+    topPlay.score.beatmap.artist         = query.getColumn(16).getString();
+    topPlay.score.beatmap.title          = query.getColumn(17).getString();
+    topPlay.score.beatmap.mapsetCreator  = query.getColumn(18).getString();
+    topPlay.score.beatmap.maxCombo       = query.getColumn(19).getInt64();
+
+    topPlay.score.user.userID            = query.getColumn(20).getInt64();
+    topPlay.score.user.username          = query.getColumn(21).getString();
+    topPlay.score.user.countryCode       = query.getColumn(22).getString();
+    topPlay.score.user.pfpLink           = query.getColumn(23).getString();
+    topPlay.score.user.performancePoints = query.getColumn(24).getDouble();
+    topPlay.score.user.accuracy          = query.getColumn(25).getDouble();
+    topPlay.score.user.hoursPlayed       = query.getColumn(26).getInt64();
+    topPlay.score.user.currentRank       = query.getColumn(27).getInt64();
+
+    return topPlay;
+}
+} /* namespace */
+
 /**
  * TopPlaysDatabase constructor.
  */
@@ -105,12 +193,7 @@ void TopPlaysDatabase::insertTopPlays(Gamemode const& mode, std::vector<TopPlay>
     SQLite::Transaction txn(*m_pDatabase);
     SQLite::Statement query(*m_pDatabase,
         "INSERT INTO " + table + " "
-        "("
-        "rank, "
-        "scoreID, mods, performancePoints, accuracy, totalScore, createdAt, combo, letterRank, count300, count100, count50, countMiss, "
-        "beatmapID, beatmapStarRating, beatmapDifficultyName, beatmapArtist, beatmapTitle, mapsetCreator, beatmapMaxCombo, "
-        "userID, username, userCountryCode, userPfpLink, userPerformancePoints, userAccuracy, userHoursPlayed, userCurrentRank"
-        ")"
+        "(rank, " + k_topPlayColumns + ") "
         "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)"
     );
 
@@ -119,39 +202,8 @@ void TopPlaysDatabase::insertTopPlays(Gamemode const& mode, std::vector<TopPlay>
         if (topPlay.isValid())
         {
             query.reset();
-
             query.bind(1, topPlay.rank);
-
-            query.bind(2, topPlay.score.scoreID);
-            query.bind(3, topPlay.score.mods.toString());
-            query.bind(4, topPlay.score.performancePoints);
-            query.bind(5, topPlay.score.accuracy);
-            query.bind(6, topPlay.score.totalScore);
-            query.bind(7, topPlay.score.createdAt.toString());
-            query.bind(8, topPlay.score.combo);
-            query.bind(9, topPlay.score.letterRank);
-            query.bind(10, topPlay.score.count300);
-            query.bind(11, topPlay.score.count100);
-            query.bind(12, topPlay.score.count50);
-            query.bind(13, topPlay.score.countMiss);
-
-            query.bind(14, topPlay.score.beatmap.beatmapID);
-            query.bind(15, topPlay.score.beatmap.starRating);
-            query.bind(16, topPlay.score.beatmap.difficultyName);
-            query.bind(17, topPlay.score.beatmap.artist);
-            query.bind(18, topPlay.score.beatmap.title);
-            query.bind(19, topPlay.score.beatmap.mapsetCreator);
-            query.bind(20, topPlay.score.beatmap.maxCombo);
-
-            query.bind(21, topPlay.score.user.userID);
-            query.bind(22, topPlay.score.user.username);
-            query.bind(23, topPlay.score.user.countryCode);
-            query.bind(24, topPlay.score.user.pfpLink);
-            query.bind(25, topPlay.score.user.performancePoints);
-            query.bind(26, topPlay.score.user.accuracy);
-            query.bind(27, topPlay.score.user.hoursPlayed);
-            query.bind(28, topPlay.score.user.currentRank);
-
+            bindTopPlay(query, topPlay, 2);
             query.exec();
         }
     }
@@ -168,11 +220,7 @@ void TopPlaysDatabase::insertTopPlays(Gamemode const& mode, std::vector<TopPlay>
 
     std::vector<TopPlay> results;
     SQLite::Statement query(*m_pDatabase,
-        "SELECT "
-        "   rank, "
-        "   scoreID, mods, performancePoints, accuracy, totalScore, createdAt, combo, letterRank, count300, count100, count50, countMiss, "
-        "   beatmapID, beatmapStarRating, beatmapDifficultyName, beatmapArtist, beatmapTitle, mapsetCreator, beatmapMaxCombo, "
-        "   userID, username, userCountryCode, userPfpLink, userPerformancePoints, userAccuracy, userHoursPlayed, userCurrentRank "
+        "SELECT rank, " + k_topPlayColumns + " "
         "FROM " + table + " "
         "WHERE "
         "   (userCountryCode = ? OR ? = '" + k_global + "') "
@@ -189,41 +237,95 @@ void TopPlaysDatabase::insertTopPlays(Gamemode const& mode, std::vector<TopPlay>
 
     while (query.executeStep())
     {
-        TopPlay topPlay;
-
-        topPlay.rank = query.getColumn(0).getInt64();
-
-        topPlay.score.scoreID           = query.getColumn(1).getInt64();
-        topPlay.score.mods              = OsuMods(query.getColumn(2).getString());
-        topPlay.score.performancePoints = query.getColumn(3).getDouble();
-        topPlay.score.accuracy          = query.getColumn(4).getDouble();
-        topPlay.score.totalScore        = query.getColumn(5).getInt64();
-        topPlay.score.createdAt         = ISO8601DateTimeUTC(query.getColumn(6).getString());
-        topPlay.score.combo             = query.getColumn(7).getInt64();
-        topPlay.score.letterRank        = query.getColumn(8).getString();
-        topPlay.score.count300          = query.getColumn(9).getInt64();
-        topPlay.score.count100          = query.getColumn(10).getInt64();
-        topPlay.score.count50           = query.getColumn(11).getInt64();
-        topPlay.score.countMiss         = query.getColumn(12).getInt64();
-
-        topPlay.score.beatmap.beatmapID      = query.getColumn(13).getInt64();
-        topPlay.score.beatmap.starRating     = query.getColumn(14).getDouble();
-        topPlay.score.beatmap.difficultyName = query.getColumn(15).getString();
-        topPlay.score.beatmap.artist         = query.getColumn(16).getString();
-        topPlay.score.beatmap.title          = query.getColumn(17).getString();
-        topPlay.score.beatmap.mapsetCreator  = query.getColumn(18).getString();
-        topPlay.score.beatmap.maxCombo       = query.getColumn(19).getInt64();
-
-        topPlay.score.user.userID            = query.getColumn(20).getInt64();
-        topPlay.score.user.username          = query.getColumn(21).getString();
-        topPlay.score.user.countryCode       = query.getColumn(22).getString();
-        topPlay.score.user.pfpLink           = query.getColumn(23).getString();
-        topPlay.score.user.performancePoints = query.getColumn(24).getDouble();
-        topPlay.score.user.accuracy          = query.getColumn(25).getDouble();
-        topPlay.score.user.hoursPlayed       = query.getColumn(26).getInt64();
-        topPlay.score.user.currentRank       = query.getColumn(27).getInt64();
-
-        results.push_back(topPlay);
+        results.push_back(topPlayFromRow(query));
+    }
+
+    return results;
+}
+
+/**
+ * Merge the newest day of top plays into the rolling window, in a single transaction.
+ * Plays are keyed by scoreID, so days that overlap don't count a play twice.
+ * Plays older than windowDays are evicted, and only the best maxNumTopPlays of each day are kept; the window's best plays are always
+ * among its days' best plays, so it never needs more than a day's worth of plays fetched at once. Trimming per day (rather than the whole
+ * window) keeps at most windowDays * maxNumTopPlays plays, and means that once a strong day ages out, the next best plays are still there.
+ */
+void TopPlaysDatabase::mergeTopPlaysWindow(Gamemode const& mode, std::vector<TopPlay> const& topPlays, int const& windowDays, std::size_t const& maxNumTopPlays)
+{
+    std::lock_guard<std::mutex> lock(m_dbMtx);
+    LOG_DEBUG("Merging ", topPlays.size(), " top plays into the ", windowDays, " day ", mode.toString(), " window");
+
+    const std::string table = k_modeToTopPlaysWindowTable.at(mode);
+
+    ISO8601DateTimeUTC cutoff;
+    cutoff.addDays(-windowDays);
+
+    SQLite::Transaction txn(*m_pDatabase);
+    SQLite::Statement query(*m_pDatabase,
+        "INSERT OR REPLACE INTO " + table + " "
+        "(" + k_topPlayColumns + ") "
+        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)"
+    );
+
+    for (auto const& topPlay : topPlays)
+    {
+        if (topPlay.isValid())
+        {
+            query.reset();
+            bindTopPlay(query, topPlay, 1);
+            query.exec();
+        }
+    }
+
+    SQLite::Statement evictQuery(*m_pDatabase, "DELETE FROM " + table + " WHERE createdAt < ?");
+    evictQuery.bind(1, cutoff.toString());
+    int numEvicted = evictQuery.exec();
+
+    SQLite::Statement trimQuery(*m_pDatabase,
+        "DELETE FROM " + table + " "
+        "WHERE scoreID IN ("
+        "   SELECT scoreID FROM (SELECT scoreID, ROW_NUMBER() OVER (PARTITION BY date(createdAt) ORDER BY performancePoints DESC) AS dayRank FROM " + table + ") "
+        "   WHERE dayRank > ?"
+        ")"
+    );
+    trimQuery.bind(1, static_cast<int64_t>(maxNumTopPlays));
+    int numTrimmed = trimQuery.exec();
+
+    txn.commit();
+
+    LOG_INFO("Merged ", topPlays.size(), " plays into the ", windowDays, " day ", mode.toString(), " window; ", numEvicted, " aged out, ", numTrimmed, " trimmed");
+}
+
+/**
+ * Get the best plays in the rolling window, ranked by pp.
+ */
+[[nodiscard]] std::vector<TopPlay> TopPlaysDatabase::getWindowTopPlays(std::string const& countryCode, std::size_t const& numTopPlays, Gamemode const& mode, std::string const& mods)
+{
+    std::lock_guard<std::mutex> lock(m_dbMtx);
+    LOG_DEBUG("Retrieving window top plays for mode ", mode.toString());
+
+    std::string table = k_modeToTopPlaysWindowTable.at(mode);
+
+    std::vector<TopPlay> results;
+    SQLite::Statement query(*m_pDatabase,
+        "SELECT rank, " + k_topPlayColumns + " "
+        "FROM (SELECT ROW_NUMBER() OVER (ORDER BY performancePoints DESC) AS rank, * FROM " + table + ") "
+        "WHERE "
+        "   (userCountryCode = ? OR ? = '" + k_global + "') "
+        "   AND (mods = ? OR ? = '" + k_allMods + "') "
+        "ORDER BY rank ASC "
+        "LIMIT ?"
+    );
+
+    query.bind(1, countryCode);
+    query.bind(2, countryCode);
+    query.bind(3, mods);
+    query.bind(4, mods);
+    query.bind(5, static_cast<int64_t>(numTopPlays));
+
+    while (query.executeStep())
+    {
+        results.push_back(topPlayFromRow(query));
     }
 
     return results;
@@ -279,6 +381,44 @@ void TopPlaysDatabase::createTables_()
             );
         }
 
+        // Not wiped with the daily tables; plays are evicted from it as they age out instead
+        for (auto const& [_, windowTable] : k_modeToTopPlaysWindowTable)
+        {
+            m_pDatabase->exec(
+                "CREATE TABLE IF NOT EXISTS " + windowTable + " ("
+                "   scoreID           INTEGER  PRIMARY KEY, "
+                "   mods              TEXT,                 "
+                "   performancePoints REAL     NOT NULL,    "
+                "   accuracy          REAL,                 "
+                "   totalScore        INTEGER  NOT NULL,    "
+                "   createdAt         TEXT     NOT NULL,    "
+                "   combo             INTEGER,              "
+                "   letterRank        TEXT     NOT NULL,    "
+                "   count300          INTEGER,              "
+                "   count100          INTEGER,              "
+                "   count50           INTEGER,              "
+                "   countMiss         INTEGER,              "
+
+                "   beatmapID             INTEGER  NOT NULL, "
+                "   beatmapStarRating     REAL,              "
+                "   beatmapDifficultyName TEXT,              "
+                "   beatmapArtist         TEXT,              "
+                "   beatmapTitle          TEXT,              "
+                "   mapsetCreator         TEXT,              "
+                "   beatmapMaxCombo       INTEGER,           "
+
+                "   userID                INTEGER  NOT NULL, "
+                "   username              TEXT,              "
+                "   userCountryCode       TEXT,              "
+                "   userPfpLink           TEXT,              "
+                "   userPerformancePoints REAL,              "
+                "   userAccuracy          REAL,              "
+                "   userHoursPlayed       INTEGER,           "
+                "   userCurrentRank       INTEGER            "
+                ")"
+            );
+        }
+
         txn.commit();
     }
     catch (std::exception const& e)
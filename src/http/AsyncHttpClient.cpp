@@ -0,0 +1,277 @@
+#include "AsyncHttpClient.h"
+#include "HttpRequester.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace
+{
+constexpr int k_maxPollWaitMs = 1000;
+} /* namespace */
+
+/**
+ * AsyncHttpClient constructor.
+ * maxConnections caps how many transfers are in flight at once; CURL queues up the rest.
+ */
+AsyncHttpClient::AsyncHttpClient(std::shared_ptr<ThreadPool> pThreadPool, std::size_t const& maxConnections)
+    : m_pThreadPool(pThreadPool)
+    , m_timerService(pThreadPool)
+    , m_curlMultiHandle(curl_multi_init())
+    , m_bStop(false)
+{
+    LOG_ERROR_THROW(
+        m_curlMultiHandle,
+        "Failed to initialize CURL multi handle!"
+    );
+    curl_multi_setopt(m_curlMultiHandle, CURLMOPT_MAX_TOTAL_CONNECTIONS, static_cast<long>(std::max(maxConnections, static_cast<std::size_t>(1))));
+
+    m_eventLoopThread = std::thread(
+    [this]()
+    {
+        eventLoop_();
+    });
+}
+
+/**
+ * AsyncHttpClient destructor.
+ * Every request and timer must have finished by now, since their coroutines can't be resumed anymore afterwards.
+ */
+AsyncHttpClient::~AsyncHttpClient() noexcept
+{
+    m_bStop = true;
+    curl_multi_wakeup(m_curlMultiHandle);
+    if (m_eventLoopThread.joinable())
+    {
+        m_eventLoopThread.join();
+    }
+
+    curl_multi_cleanup(m_curlMultiHandle);
+}
+
+/**
+ * Send HTTP request. The awaiting coroutine is resumed on the ThreadPool once the response is in.
+ */
+[[nodiscard]] AsyncHttpClient::RequestAwaiter AsyncHttpClient::request(
+    std::string const& url,
+    std::string const& method,
+    std::vector<std::string> const& headers,
+    std::string const& body,
+    std::shared_ptr<CancellationToken> pCancelToken)
+{
+    return RequestAwaiter(*this, url, method, headers, body, pCancelToken);
+}
+
+/**
+ * Wait for delay without blocking a thread (see TimerService::sleepFor).
+ */
+[[nodiscard]] TimerService::SleepAwaiter AsyncHttpClient::sleepFor(std::chrono::milliseconds const& delay, std::shared_ptr<CancellationToken> pCancelToken)
+{
+    return m_timerService.sleepFor(delay, pCancelToken);
+}
+
+/**
+ * Move the awaiting coroutine onto the ThreadPool that requests are resumed on, e.g. after a detour onto some other pool.
+ */
+[[nodiscard]] ThreadPool::ScheduleAwaiter AsyncHttpClient::schedule() noexcept
+{
+    return m_pThreadPool->schedule();
+}
+
+/**
+ * RequestAwaiter constructor.
+ */
+AsyncHttpClient::RequestAwaiter::RequestAwaiter(AsyncHttpClient& client, std::string url, std::string method, std::vector<std::string> const& headers, std::string body, std::shared_ptr<CancellationToken> pCancelToken)
+    : m_client(client)
+    , m_url(std::move(url))
+    , m_method(std::move(method))
+    , m_body(std::move(body))
+    , m_pCancelToken(pCancelToken ? pCancelToken : std::make_shared<CancellationToken>())
+    , m_curlHandle(nullptr)
+    , m_curlHeaders(nullptr)
+    , m_pLabel(nullptr)
+{
+    for (auto const& header : headers)
+    {
+        m_curlHeaders = curl_slist_append(m_curlHeaders, header.c_str());
+    }
+}
+
+/**
+ * RequestAwaiter destructor.
+ */
+AsyncHttpClient::RequestAwaiter::~RequestAwaiter() noexcept
+{
+    if (m_curlHandle)
+    {
+        curl_easy_cleanup(m_curlHandle);
+    }
+    if (m_curlHeaders)
+    {
+        curl_slist_free_all(m_curlHeaders);
+    }
+}
+
+/**
+ * Hand the request over to the event loop.
+ * The coroutine may be resumed on another thread before this even returns, so nothing here can be touched after handing it over.
+ */
+void AsyncHttpClient::RequestAwaiter::await_suspend(std::coroutine_handle<> handle)
+{
+    m_pCancelToken->throwIfCancelled();
+
+    m_curlHandle = curl_easy_init();
+    LOG_ERROR_THROW(
+        m_curlHandle,
+        "Failed to initialize CURL handle!"
+    );
+    HttpRequester::setRequestOptions(m_curlHandle, m_url, m_method, m_curlHeaders, m_body, m_pCancelToken.get(), &m_response.data);
+    curl_easy_setopt(m_curlHandle, CURLOPT_PRIVATE, this);
+    m_handle = handle;
+    m_pLabel = ThreadPool::currentLabel();
+
+    m_client.addRequest_(this);
+}
+
+/**
+ * Return the response, or throw OperationCancelled if the request was aborted because of the token.
+ */
+HttpResponse AsyncHttpClient::RequestAwaiter::await_resume()
+{
+    if (m_response.bCancelled)
+    {
+        m_pCancelToken->throwIfCancelled();
+    }
+    return std::move(m_response);
+}
+
+/**
+ * Queue up a request for the event loop to start.
+ */
+void AsyncHttpClient::addRequest_(RequestAwaiter* pRequest)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_pendingMtx);
+        m_pendingRequests.push_back(pRequest);
+    }
+    curl_multi_wakeup(m_curlMultiHandle);
+}
+
+/**
+ * Drive every transfer until the client is destroyed.
+ */
+void AsyncHttpClient::eventLoop_()
+{
+    std::unordered_set<RequestAwaiter*> activeRequests;
+    while (!m_bStop)
+    {
+        startPendingRequests_(activeRequests);
+
+        int numRunning = 0;
+        curl_multi_perform(m_curlMultiHandle, &numRunning);
+
+        CURLMsg* pMessage = nullptr;
+        int numMessages = 0;
+        while ((pMessage = curl_multi_info_read(m_curlMultiHandle, &numMessages)) != nullptr)
+        {
+            if (pMessage->msg != CURLMSG_DONE)
+            {
+                continue;
+            }
+
+            RequestAwaiter* pRequest = nullptr;
+            curl_easy_getinfo(pMessage->easy_handle, CURLINFO_PRIVATE, &pRequest);
+            finishRequest_(pRequest, pMessage->data.result, activeRequests);
+        }
+
+        // Transfers that CURL hasn't started yet never call back into the cancellation check, so look for those here
+        std::vector<RequestAwaiter*> cancelledRequests;
+        for (RequestAwaiter* pRequest : activeRequests)
+        {
+            if (pRequest->m_pCancelToken->isCancelled())
+            {
+                cancelledRequests.push_back(pRequest);
+            }
+        }
+        for (RequestAwaiter* pRequest : cancelledRequests)
+        {
+            finishRequest_(pRequest, CURLE_ABORTED_BY_CALLBACK, activeRequests);
+        }
+
+        curl_multi_poll(m_curlMultiHandle, nullptr, 0, k_maxPollWaitMs, nullptr);
+    }
+
+    for (RequestAwaiter* pRequest : activeRequests)
+    {
+        LOG_WARN("AsyncHttpClient destroyed while a request to ", pRequest->m_url, " was in flight");
+        curl_multi_remove_handle(m_curlMultiHandle, pRequest->m_curlHandle);
+    }
+}
+
+/**
+ * Move requests queued up by awaiting coroutines into the multi handle.
+ */
+void AsyncHttpClient::startPendingRequests_(std::unordered_set<RequestAwaiter*>& activeRequests /* out */)
+{
+    std::vector<RequestAwaiter*> pendingRequests;
+    {
+        std::lock_guard<std::mutex> lock(m_pendingMtx);
+        pendingRequests.swap(m_pendingRequests);
+    }
+
+    for (RequestAwaiter* pRequest : pendingRequests)
+    {
+        CURLMcode curlMultiResponse = curl_multi_add_handle(m_curlMultiHandle, pRequest->m_curlHandle);
+        if (curlMultiResponse != CURLM_OK)
+        {
+            LOG_ERROR("Failed to start HTTP request: ", curl_multi_strerror(curlMultiResponse));
+            pRequest->m_response.bSuccess = false;
+            resume_(pRequest->m_handle, pRequest->m_pLabel);
+            continue;
+        }
+        activeRequests.insert(pRequest);
+    }
+}
+
+/**
+ * Take a finished (or aborted) transfer out of the multi handle, fill in its response and resume its coroutine.
+ */
+void AsyncHttpClient::finishRequest_(RequestAwaiter* pRequest, CURLcode const& curlResponse, std::unordered_set<RequestAwaiter*>& activeRequests /* out */)
+{
+    curl_multi_remove_handle(m_curlMultiHandle, pRequest->m_curlHandle);
+    activeRequests.erase(pRequest);
+
+    HttpResponse& response = pRequest->m_response;
+    if (curlResponse == CURLE_OK)
+    {
+        curl_easy_getinfo(pRequest->m_curlHandle, CURLINFO_RESPONSE_CODE, &response.httpCode);
+        response.bSuccess = true;
+    }
+    else if (curlResponse == CURLE_ABORTED_BY_CALLBACK)
+    {
+        response.bCancelled = true;
+    }
+    else
+    {
+        LOG_ERROR("Failed to send HTTP request: ", curl_easy_strerror(curlResponse));
+    }
+
+    resume_(pRequest->m_handle, pRequest->m_pLabel);
+}
+
+/**
+ * Resume a coroutine on the ThreadPool (under the label it was suspended under), so that the event loop never runs job code itself.
+ * If the pool has already been shut down, there's nowhere else to run it but here.
+ */
+void AsyncHttpClient::resume_(std::coroutine_handle<> handle, char const* pLabel)
+{
+    try
+    {
+        m_pThreadPool->resume(handle, pLabel);
+    }
+    catch (std::runtime_error const& e)
+    {
+        LOG_WARN("Failed to resume coroutine on the thread pool; ", e.what(), " - resuming it on the event loop instead");
+        handle.resume();
+    }
+}
@@ -0,0 +1,182 @@
+#include "ConcurrencyTuner.h"
+#include "Logger.h"
+
+#include <algorithm>
+
+namespace
+{
+constexpr std::chrono::seconds k_tuneInterval(10);
+constexpr std::chrono::seconds k_maxWindowDuration(30);
+constexpr std::size_t k_minResponsesPerWindow = 20;
+constexpr double k_maxThrottledRatio = 0.05;
+constexpr double k_goodputTolerance = 0.05;
+constexpr std::chrono::milliseconds k_cancelCheckInterval(100);
+} /* namespace */
+
+/**
+ * ConcurrencyTuner constructor. Starts off at maxLimit, i.e. the same as not tuning at all, and works its way down from there.
+ */
+ConcurrencyTuner::ConcurrencyTuner(std::size_t const& minLimit, std::size_t const& maxLimit)
+    : m_minLimit(std::max(minLimit, static_cast<std::size_t>(1)))
+    , m_maxLimit(std::max(maxLimit, m_minLimit))
+    , m_limit(m_maxLimit)
+    , m_numInFlight(0)
+    , m_windowStart(std::chrono::steady_clock::now())
+    , m_lastResponseTime(m_windowStart)
+    , m_numResponses(0)
+    , m_numThrottledResponses(0)
+    , m_prevGoodput(0.)
+    , m_direction(-1)
+{}
+
+/**
+ * Block until a request may be sent, or throw OperationCancelled if the token is cancelled first.
+ */
+[[nodiscard]] ConcurrencyTuner::Permit ConcurrencyTuner::acquire(CancellationToken const& cancelToken)
+{
+    std::unique_lock<std::mutex> lock(m_mtx);
+    while (!m_cv.wait_for(lock, k_cancelCheckInterval, [this] { return m_numInFlight < m_limit; }))
+    {
+        cancelToken.throwIfCancelled();
+    }
+
+    ++m_numInFlight;
+    return Permit(this);
+}
+
+/**
+ * Get a permit if a request may be sent right now, for callers that would rather wait some other way than blocking their thread.
+ */
+[[nodiscard]] std::optional<ConcurrencyTuner::Permit> ConcurrencyTuner::tryAcquire()
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    if (m_numInFlight >= m_limit)
+    {
+        return std::nullopt;
+    }
+
+    ++m_numInFlight;
+    return Permit(this);
+}
+
+/**
+ * Count a response towards the current window, and move the limit if the window is over.
+ */
+void ConcurrencyTuner::recordResponse(long const& httpCode)
+{
+    recordResponse(httpCode, std::chrono::steady_clock::now());
+}
+
+/**
+ * Same as above, for a response that came in at the given time (e.g. so that tests don't have to wait out real windows).
+ */
+void ConcurrencyTuner::recordResponse(long const& httpCode, std::chrono::steady_clock::time_point const& now)
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+
+    // Nothing from before an idle gap (e.g. between jobs) says anything about how the API is holding up now
+    if ((now - m_lastResponseTime) > k_tuneInterval)
+    {
+        restartWindow_(now);
+    }
+    m_lastResponseTime = now;
+
+    ++m_numResponses;
+    if (httpCode == 429)
+    {
+        ++m_numThrottledResponses;
+    }
+
+    adjustLimit_(now);
+}
+
+/**
+ * Get how many requests may currently be in flight at once.
+ */
+[[nodiscard]] std::size_t ConcurrencyTuner::getLimit()
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    return m_limit;
+}
+
+void ConcurrencyTuner::release_()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        --m_numInFlight;
+    }
+
+    m_cv.notify_one();
+}
+
+/**
+ * Must be called with m_mtx held.
+ * Windows that saw too few responses are stretched out rather than judged, up to a point; past that, they're started over
+ * without touching the limit, since their goodput can't be fairly compared to anything.
+ * Getting ratelimited cuts the limit by a quarter. Otherwise it keeps stepping in the same direction while that raises goodput
+ * (successful responses per second), turns around when goodput drops, and steps down when it's flat, since the extra requests weren't buying anything.
+ */
+void ConcurrencyTuner::adjustLimit_(std::chrono::steady_clock::time_point const& now)
+{
+    auto windowDuration = std::chrono::duration<double>(now - m_windowStart);
+    if (windowDuration < k_tuneInterval)
+    {
+        return;
+    }
+    if (m_numResponses < k_minResponsesPerWindow)
+    {
+        if (windowDuration > k_maxWindowDuration)
+        {
+            restartWindow_(now);
+        }
+        return;
+    }
+
+    double throttledRatio = static_cast<double>(m_numThrottledResponses) / static_cast<double>(m_numResponses);
+    double goodput = static_cast<double>(m_numResponses - m_numThrottledResponses) / windowDuration.count();
+    std::size_t prevLimit = m_limit;
+
+    if (throttledRatio > k_maxThrottledRatio)
+    {
+        m_limit = std::max(m_limit * 3 / 4, m_minLimit);
+        m_direction = -1;
+    }
+    else
+    {
+        if (goodput < m_prevGoodput * (1. - k_goodputTolerance))
+        {
+            m_direction = -m_direction;
+        }
+        else if (goodput <= m_prevGoodput * (1. + k_goodputTolerance))
+        {
+            m_direction = -1;
+        }
+
+        m_limit = (m_direction > 0) ? std::min(m_limit + 1, m_maxLimit) : std::max(m_limit - 1, m_minLimit);
+    }
+
+    LOG_DEBUG(
+        "osu!API concurrency ", prevLimit, " -> ", m_limit, " (", m_numResponses, " responses over ", windowDuration.count(),
+        "s, goodput=", goodput, "/s, throttled=", throttledRatio * 100., "%)"
+    );
+
+    restartWindow_(now);
+    m_prevGoodput = goodput;
+
+    if (m_limit > prevLimit)
+    {
+        m_cv.notify_all();
+    }
+}
+
+/**
+ * Must be called with m_mtx held.
+ * Start a window with nothing to compare against; the next window that gets judged just keeps stepping in the same direction.
+ */
+void ConcurrencyTuner::restartWindow_(std::chrono::steady_clock::time_point const& now)
+{
+    m_windowStart = now;
+    m_numResponses = 0;
+    m_numThrottledResponses = 0;
+    m_prevGoodput = 0.;
+}
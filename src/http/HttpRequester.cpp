@@ -12,12 +12,23 @@ std::size_t curlWriteCallback(void* contents, std::size_t size, std::size_t nmem
     response->append(static_cast<char*>(contents), totalSize);
     return totalSize;
 }
+
+/**
+ * Abort the transfer (by returning non-zero) once the token is cancelled.
+ * libcurl calls this roughly once a second even when nothing is being transferred.
+ */
+int curlXferInfoCallback(void* clientp, curl_off_t, curl_off_t, curl_off_t, curl_off_t)
+{
+    CancellationToken const* pCancelToken = static_cast<CancellationToken const*>(clientp);
+    return pCancelToken->isCancelled() ? 1 : 0;
+}
 } /* namespace */
 
 /**
  * HTTPRequester constructor.
  */
-HttpRequester::HttpRequester()
+HttpRequester::HttpRequester(std::shared_ptr<CancellationToken> pCancelToken)
+: m_pCancelToken(pCancelToken ? pCancelToken : std::make_shared<CancellationToken>())
 {
     m_curlHandle = curl_easy_init();
     LOG_ERROR_THROW(
@@ -48,79 +59,106 @@ HttpRequester::~HttpRequester() noexcept
     long& httpCode /* out */,
     std::string& responseData /* out */)
 {
+    m_pCancelToken->throwIfCancelled();
+
+    struct curl_slist* curlHeaders = nullptr;
+    for (auto const& header : headers)
+    {
+        curlHeaders = curl_slist_append(curlHeaders, header.c_str());
+    }
+
     curl_easy_reset(m_curlHandle);
+    setRequestOptions(m_curlHandle, url, method, curlHeaders, body, m_pCancelToken.get(), &responseData);
 
-    curl_easy_setopt(m_curlHandle, CURLOPT_URL, url.c_str());
+    CURLcode curlResponse = curl_easy_perform(m_curlHandle);
+
+    bool bSuccess = false;
+    if (curlResponse == CURLE_OK)
+    {
+        curl_easy_getinfo(m_curlHandle, CURLINFO_RESPONSE_CODE, &httpCode);
+        bSuccess = true;
+    }
+    else if (curlResponse != CURLE_ABORTED_BY_CALLBACK)
+    {
+        LOG_ERROR("Failed to send HTTP request: ", curl_easy_strerror(curlResponse));
+    }
+
+    if (curlHeaders)
+    {
+        curl_slist_free_all(curlHeaders);
+    }
+
+    if (curlResponse == CURLE_ABORTED_BY_CALLBACK)
+    {
+        m_pCancelToken->throwIfCancelled();
+    }
+
+    return bSuccess;
+}
+
+/**
+ * Set up a CURL handle for a request. Shared with AsyncHttpClient, so that both send exactly the same requests.
+ * curlHeaders, body, pCancelToken and responseData have to outlive the transfer.
+ */
+void HttpRequester::setRequestOptions(
+    CURL* curlHandle,
+    std::string const& url,
+    std::string const& method,
+    curl_slist* curlHeaders,
+    std::string const& body,
+    CancellationToken const* pCancelToken,
+    std::string* responseData /* out */)
+{
+    curl_easy_setopt(curlHandle, CURLOPT_URL, url.c_str());
 
     if (method == "GET")
     {
-        curl_easy_setopt(m_curlHandle, CURLOPT_HTTPGET, 1L);
+        curl_easy_setopt(curlHandle, CURLOPT_HTTPGET, 1L);
     }
     else if (method == "POST")
     {
-        curl_easy_setopt(m_curlHandle, CURLOPT_POST, 1L);
+        curl_easy_setopt(curlHandle, CURLOPT_POST, 1L);
     }
     else
     {
-        curl_easy_setopt(m_curlHandle, CURLOPT_CUSTOMREQUEST, method);
+        curl_easy_setopt(curlHandle, CURLOPT_CUSTOMREQUEST, method.c_str());
     }
 
     if (!body.empty())
     {
-        curl_easy_setopt(m_curlHandle, CURLOPT_POSTFIELDS, body.c_str());
-        curl_easy_setopt(m_curlHandle, CURLOPT_POSTFIELDSIZE, body.length());
+        curl_easy_setopt(curlHandle, CURLOPT_POSTFIELDS, body.c_str());
+        curl_easy_setopt(curlHandle, CURLOPT_POSTFIELDSIZE, body.length());
     }
 
-    struct curl_slist* curlHeaders = nullptr;
-    for (auto const& header : headers)
-    {
-        curlHeaders = curl_slist_append(curlHeaders, header.c_str());
-    }
     if (curlHeaders)
     {
-        curl_easy_setopt(m_curlHandle, CURLOPT_HTTPHEADER, curlHeaders);
+        curl_easy_setopt(curlHandle, CURLOPT_HTTPHEADER, curlHeaders);
     }
 
-    curl_easy_setopt(m_curlHandle, CURLOPT_WRITEFUNCTION, curlWriteCallback);
-    curl_easy_setopt(m_curlHandle, CURLOPT_WRITEDATA, &responseData);
-
-    curl_easy_setopt(m_curlHandle, CURLOPT_USERAGENT, "daily-dosu");
-    curl_easy_setopt(m_curlHandle, CURLOPT_FOLLOWLOCATION, 1L);
-    curl_easy_setopt(m_curlHandle, CURLOPT_MAXREDIRS, 10L);
-    curl_easy_setopt(m_curlHandle, CURLOPT_TIMEOUT, 120L);
-    curl_easy_setopt(m_curlHandle, CURLOPT_CONNECTTIMEOUT, 30L);
-    curl_easy_setopt(m_curlHandle, CURLOPT_NOSIGNAL, 1L);
-
-    curl_easy_setopt(m_curlHandle, CURLOPT_TCP_KEEPALIVE, 1L);
-    curl_easy_setopt(m_curlHandle, CURLOPT_TCP_KEEPIDLE, 120L);
-    curl_easy_setopt(m_curlHandle, CURLOPT_TCP_KEEPINTVL, 60L);
-
-    curl_easy_setopt(m_curlHandle, CURLOPT_LOW_SPEED_LIMIT, 100L);
-    curl_easy_setopt(m_curlHandle, CURLOPT_LOW_SPEED_TIME, 60L);
+    curl_easy_setopt(curlHandle, CURLOPT_WRITEFUNCTION, curlWriteCallback);
+    curl_easy_setopt(curlHandle, CURLOPT_WRITEDATA, responseData);
 
-    curl_easy_setopt(m_curlHandle, CURLOPT_SSLVERSION, CURL_SSLVERSION_TLSv1_2);
-    curl_easy_setopt(m_curlHandle, CURLOPT_SSL_VERIFYPEER, 1L);
-    curl_easy_setopt(m_curlHandle, CURLOPT_SSL_VERIFYHOST, 2L);
+    curl_easy_setopt(curlHandle, CURLOPT_NOPROGRESS, 0L);
+    curl_easy_setopt(curlHandle, CURLOPT_XFERINFOFUNCTION, curlXferInfoCallback);
+    curl_easy_setopt(curlHandle, CURLOPT_XFERINFODATA, pCancelToken);
 
-    curl_easy_setopt(m_curlHandle, CURLOPT_DNS_SERVERS, "1.1.1.1,8.8.8.8");
+    curl_easy_setopt(curlHandle, CURLOPT_USERAGENT, "daily-dosu");
+    curl_easy_setopt(curlHandle, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curlHandle, CURLOPT_MAXREDIRS, 10L);
+    curl_easy_setopt(curlHandle, CURLOPT_TIMEOUT, 120L);
+    curl_easy_setopt(curlHandle, CURLOPT_CONNECTTIMEOUT, 30L);
+    curl_easy_setopt(curlHandle, CURLOPT_NOSIGNAL, 1L);
 
-    CURLcode curlResponse = curl_easy_perform(m_curlHandle);
+    curl_easy_setopt(curlHandle, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curlHandle, CURLOPT_TCP_KEEPIDLE, 120L);
+    curl_easy_setopt(curlHandle, CURLOPT_TCP_KEEPINTVL, 60L);
 
-    bool bSuccess = false;
-    if (curlResponse == CURLE_OK)
-    {
-        curl_easy_getinfo(m_curlHandle, CURLINFO_RESPONSE_CODE, &httpCode);
-        bSuccess = true;
-    }
-    else
-    {
-        LOG_ERROR("Failed to send HTTP request: ", curl_easy_strerror(curlResponse));
-    }
+    curl_easy_setopt(curlHandle, CURLOPT_LOW_SPEED_LIMIT, 100L);
+    curl_easy_setopt(curlHandle, CURLOPT_LOW_SPEED_TIME, 60L);
 
-    if (curlHeaders)
-    {
-        curl_slist_free_all(curlHeaders);
-    }
+    curl_easy_setopt(curlHandle, CURLOPT_SSLVERSION, CURL_SSLVERSION_TLSv1_2);
+    curl_easy_setopt(curlHandle, CURLOPT_SSL_VERIFYPEER, 1L);
+    curl_easy_setopt(curlHandle, CURLOPT_SSL_VERIFYHOST, 2L);
 
-    return bSuccess;
+    curl_easy_setopt(curlHandle, CURLOPT_DNS_SERVERS, "1.1.1.1,8.8.8.8");
 }
@@ -2,9 +2,14 @@
 #include "Logger.h"
 
 #include <thread>
+#include <algorithm>
+#include <optional>
+#include <exception>
 
 namespace
 {
+constexpr std::chrono::milliseconds k_permitPollInterval(50);
+
 template<typename T>
 void appendBatchParams(std::vector<T> const& IDs, std::string& url /* out */)
 {
@@ -15,13 +20,85 @@ void appendBatchParams(std::vector<T> const& IDs, std::string& url /* out */)
         if (std::next(it) != IDs.end()) url += "&";
     }
 }
+
+/**
+ * Endpoint URLs, shared between the blocking and awaitable versions of each endpoint.
+ * Pages are 0-indexed here and 1-indexed in the URL.
+ */
+std::string rankingsUrl(Page const& page, Gamemode const& mode)
+{
+    LOG_ERROR_THROW(
+        page + 1 <= k_getRankingIDMaxPage,
+        "page cannot be greater than ", k_getRankingIDMaxPage, "! page=", page + 1
+    );
+    return "https://osu.ppy.sh/api/v2/rankings/" + mode.toString() + "/performance?page=" + std::to_string(static_cast<int>(page + 1));
+}
+
+std::string countryRankingsUrl(Page const& page, std::string const& countryCode, Gamemode const& mode)
+{
+    LOG_ERROR_THROW(
+        page + 1 <= k_getRankingIDMaxPage,
+        "page cannot be greater than ", k_getRankingIDMaxPage, "! page=", page + 1
+    );
+    return "https://osu.ppy.sh/api/v2/rankings/" + mode.toString() + "/performance?country=" + countryCode + "&page=" + std::to_string(static_cast<int>(page + 1));
+}
+
+std::string userUrl(UserID const& userID, Gamemode const& mode)
+{
+    return "https://osu.ppy.sh/api/v2/users/" + std::to_string(userID) + "/" + mode.toString() + "?key=id";
+}
+
+std::string usersUrl(std::vector<UserID> const& userIDs)
+{
+    LOG_ERROR_THROW(
+        userIDs.size() <= k_batchMaxIDs,
+        "Cannot request more than ", k_batchMaxIDs, " users at once! userIDs.size()=", userIDs.size()
+    );
+    std::string url = "https://osu.ppy.sh/api/v2/users";
+    appendBatchParams(userIDs, url);
+    return url;
+}
+
+std::string userBeatmapScoresUrl(Gamemode const& mode, UserID const& userID, BeatmapID const& beatmapID)
+{
+    return "https://osu.ppy.sh/api/v2/beatmaps/" + std::to_string(beatmapID) + "/scores/users/" + std::to_string(userID) + "/all?ruleset=" + mode.toString();
+}
+
+std::string beatmapsUrl(std::vector<BeatmapID> const& beatmapIDs)
+{
+    LOG_ERROR_THROW(
+        beatmapIDs.size() <= k_batchMaxIDs,
+        "Cannot request more than ", k_batchMaxIDs, " beatmaps at once! beatmapIDs.size()=", beatmapIDs.size()
+    );
+    std::string url = "https://osu.ppy.sh/api/v2/beatmaps";
+    appendBatchParams(beatmapIDs, url);
+    return url;
+}
 } /* namespace */
 
 /**
  * OsuWrapper constructor.
+ * If pCpuThreadPool is given, responses are decoded on it rather than on the thread that waited for them.
+ */
+OsuWrapper::OsuWrapper(std::shared_ptr<TokenManager> tokenManager, int const& apiCooldownMs, std::shared_ptr<CancellationToken> pCancelToken, std::shared_ptr<ThreadPool> pCpuThreadPool)
+: m_pCancelToken(pCancelToken ? pCancelToken : std::make_shared<CancellationToken>())
+, m_pHttpRequester(std::make_unique<HttpRequester>(m_pCancelToken))
+, m_pAsyncHttpClient(nullptr)
+, m_pTokenManager(tokenManager)
+, m_pCpuThreadPool(pCpuThreadPool)
+, m_apiCooldownMs(apiCooldownMs)
+{}
+
+/**
+ * OsuWrapper constructor for the awaitable (*Async) endpoints, which send their requests through asyncHttpClient.
+ * Doesn't set up a blocking HTTP requester, so only the awaitable endpoints can be used.
  */
-OsuWrapper::OsuWrapper(std::shared_ptr<TokenManager> tokenManager, int const& apiCooldownMs) noexcept
-: m_pTokenManager(tokenManager)
+OsuWrapper::OsuWrapper(std::shared_ptr<TokenManager> tokenManager, AsyncHttpClient& asyncHttpClient, int const& apiCooldownMs, std::shared_ptr<CancellationToken> pCancelToken, std::shared_ptr<ThreadPool> pCpuThreadPool)
+: m_pCancelToken(pCancelToken ? pCancelToken : std::make_shared<CancellationToken>())
+, m_pHttpRequester(nullptr)
+, m_pAsyncHttpClient(&asyncHttpClient)
+, m_pTokenManager(tokenManager)
+, m_pCpuThreadPool(pCpuThreadPool)
 , m_apiCooldownMs(apiCooldownMs)
 {}
 
@@ -33,14 +110,17 @@ OsuWrapper::OsuWrapper(std::shared_ptr<TokenManager> tokenManager, int const& ap
  */
 bool OsuWrapper::getRankings(Page page, Gamemode const& mode, nlohmann::json& rankings /* out */)
 {
-    page += 1;
-    LOG_DEBUG("Requesting page ", page, " ", mode.toString(), " user rankings");
-    LOG_ERROR_THROW(
-        page <= k_getRankingIDMaxPage,
-        "page cannot be greater than ", k_getRankingIDMaxPage, "! page=", page
-    );
-    std::string url = "https://osu.ppy.sh/api/v2/rankings/" + mode.toString() + "/performance?page=" + std::to_string(static_cast<int>(page));
-    return apiRequest_(url, "GET", {}, "", rankings);
+    LOG_DEBUG("Requesting page ", page + 1, " ", mode.toString(), " user rankings");
+    return apiRequest_(rankingsUrl(page, mode), "GET", {}, "", rankings);
+}
+
+/**
+ * Get page of osu! performance rankings for gamemode, restricted to a single country.
+ */
+bool OsuWrapper::getCountryRankings(Page page, std::string const& countryCode, Gamemode const& mode, nlohmann::json& rankings /* out */)
+{
+    LOG_DEBUG("Requesting page ", page + 1, " ", mode.toString(), " user rankings for country ", countryCode);
+    return apiRequest_(countryRankingsUrl(page, countryCode, mode), "GET", {}, "", rankings);
 }
 
 /**
@@ -49,8 +129,7 @@ bool OsuWrapper::getRankings(Page page, Gamemode const& mode, nlohmann::json& ra
 bool OsuWrapper::getUser(UserID const& userID, Gamemode const& mode, nlohmann::json& user /* out */)
 {
     LOG_DEBUG("Requesting data for ", mode.toString(), " user ", userID);
-    std::string url = "https://osu.ppy.sh/api/v2/users/" + std::to_string(userID) + "/" + mode.toString() + "?key=id";
-    return apiRequest_(url, "GET", {}, "", user);
+    return apiRequest_(userUrl(userID, mode), "GET", {}, "", user);
 }
 
 /**
@@ -59,13 +138,22 @@ bool OsuWrapper::getUser(UserID const& userID, Gamemode const& mode, nlohmann::j
 bool OsuWrapper::getUsers(std::vector<UserID> const& userIDs, Gamemode const& mode, nlohmann::json& users /* out */)
 {
     LOG_DEBUG("Requesting data for ", userIDs.size(), " ", mode.toString(), " users");
+    return apiRequest_(usersUrl(userIDs), "GET", {}, "", users);
+}
+
+/**
+ * Get osu! user's scores of given type ("best", "recent", "firsts") for given gamemode.
+ * Data is returned as an array in userScores.
+ */
+bool OsuWrapper::getUserScores(UserID const& userID, std::string const& scoreType, Gamemode const& mode, std::size_t const& limit, nlohmann::json& userScores /* out */)
+{
+    LOG_DEBUG("Requesting ", limit, " ", scoreType, " ", mode.toString(), " scores from user ", userID);
     LOG_ERROR_THROW(
-        userIDs.size() <= k_batchMaxIDs,
-        "Cannot request more than ", k_batchMaxIDs, " users at once! userIDs.size()=", userIDs.size()
+        limit > 0 && limit <= k_userScoresMaxLimit,
+        "limit must be in [1, ", k_userScoresMaxLimit, "]! limit=", limit
     );
-    std::string url = "https://osu.ppy.sh/api/v2/users";
-    appendBatchParams(userIDs, url);
-    return apiRequest_(url, "GET", {}, "", users);
+    std::string url = "https://osu.ppy.sh/api/v2/users/" + std::to_string(userID) + "/scores/" + scoreType + "?mode=" + mode.toString() + "&limit=" + std::to_string(limit);
+    return apiRequest_(url, "GET", {}, "", userScores);
 }
 
 /**
@@ -74,8 +162,7 @@ bool OsuWrapper::getUsers(std::vector<UserID> const& userIDs, Gamemode const& mo
 bool OsuWrapper::getUserBeatmapScores(Gamemode const& mode, UserID const& userID, BeatmapID const& beatmapID, nlohmann::json& userBeatmapScores /* out */)
 {
     LOG_DEBUG("Requesting ", mode.toString(), " scores from user ", userID, " on beatmap ", beatmapID);
-    std::string url = "https://osu.ppy.sh/api/v2/beatmaps/" + std::to_string(beatmapID) + "/scores/users/" + std::to_string(userID) + "/all?ruleset=" + mode.toString();
-    return apiRequest_(url, "GET", {}, "", userBeatmapScores);
+    return apiRequest_(userBeatmapScoresUrl(mode, userID, beatmapID), "GET", {}, "", userBeatmapScores);
 }
 
 /**
@@ -91,13 +178,71 @@ bool OsuWrapper::getBeatmap(BeatmapID const& beatmapID, nlohmann::json& beatmap
 bool OsuWrapper::getBeatmaps(std::vector<BeatmapID> const& beatmapIDs, Gamemode const& mode, nlohmann::json& beatmaps /* out */)
 {
     LOG_DEBUG("Requesting data for ", beatmapIDs.size(), " ", mode.toString(), " beatmaps");
-    LOG_ERROR_THROW(
-        beatmapIDs.size() <= k_batchMaxIDs,
-        "Cannot request more than ", k_batchMaxIDs, " beatmaps at once! beatmapIDs.size()=", beatmapIDs.size()
-    );
-    std::string url = "https://osu.ppy.sh/api/v2/beatmaps";
-    appendBatchParams(beatmapIDs, url);
-    return apiRequest_(url, "GET", {}, "", beatmaps);
+    return apiRequest_(beatmapsUrl(beatmapIDs), "GET", {}, "", beatmaps);
+}
+
+/**
+ * Awaitable version of getRankings.
+ * The awaitable endpoints take their arguments by value, since they're kept in the coroutine's frame while it's suspended.
+ */
+Task<bool> OsuWrapper::getRankingsAsync(Page page, Gamemode mode, nlohmann::json& rankings /* out */)
+{
+    LOG_DEBUG("Requesting page ", page + 1, " ", mode.toString(), " user rankings");
+    co_return co_await apiRequestAsync_(rankingsUrl(page, mode), "GET", "", rankings);
+}
+
+/**
+ * Awaitable version of getCountryRankings.
+ */
+Task<bool> OsuWrapper::getCountryRankingsAsync(Page page, std::string countryCode, Gamemode mode, nlohmann::json& rankings /* out */)
+{
+    LOG_DEBUG("Requesting page ", page + 1, " ", mode.toString(), " user rankings for country ", countryCode);
+    co_return co_await apiRequestAsync_(countryRankingsUrl(page, countryCode, mode), "GET", "", rankings);
+}
+
+/**
+ * Awaitable version of getUser.
+ */
+Task<bool> OsuWrapper::getUserAsync(UserID userID, Gamemode mode, nlohmann::json& user /* out */)
+{
+    LOG_DEBUG("Requesting data for ", mode.toString(), " user ", userID);
+    co_return co_await apiRequestAsync_(userUrl(userID, mode), "GET", "", user);
+}
+
+/**
+ * Awaitable version of getUsers.
+ */
+Task<bool> OsuWrapper::getUsersAsync(std::vector<UserID> userIDs, Gamemode mode, nlohmann::json& users /* out */)
+{
+    LOG_DEBUG("Requesting data for ", userIDs.size(), " ", mode.toString(), " users");
+    co_return co_await apiRequestAsync_(usersUrl(userIDs), "GET", "", users);
+}
+
+/**
+ * Awaitable version of getUserBeatmapScores.
+ */
+Task<bool> OsuWrapper::getUserBeatmapScoresAsync(Gamemode mode, UserID userID, BeatmapID beatmapID, nlohmann::json& userBeatmapScores /* out */)
+{
+    LOG_DEBUG("Requesting ", mode.toString(), " scores from user ", userID, " on beatmap ", beatmapID);
+    co_return co_await apiRequestAsync_(userBeatmapScoresUrl(mode, userID, beatmapID), "GET", "", userBeatmapScores);
+}
+
+/**
+ * Awaitable version of getBeatmaps.
+ */
+Task<bool> OsuWrapper::getBeatmapsAsync(std::vector<BeatmapID> beatmapIDs, Gamemode mode, nlohmann::json& beatmaps /* out */)
+{
+    LOG_DEBUG("Requesting data for ", beatmapIDs.size(), " ", mode.toString(), " beatmaps");
+    co_return co_await apiRequestAsync_(beatmapsUrl(beatmapIDs), "GET", "", beatmaps);
+}
+
+/**
+ * Cap how many requests every OsuWrapper has in flight at once (see ConcurrencyTuner), or stop capping them if pConcurrencyTuner is null.
+ * Meant to be set up once, before any requests are made.
+ */
+void OsuWrapper::setConcurrencyTuner(std::shared_ptr<ConcurrencyTuner> pConcurrencyTuner)
+{
+    s_pConcurrencyTuner = pConcurrencyTuner;
 }
 
 /**
@@ -106,79 +251,230 @@ bool OsuWrapper::getBeatmaps(std::vector<BeatmapID> const& beatmapIDs, Gamemode
  * Send request to osu!API v2.
  * If request gets ratelimited or a server error occurs, waits according to [exponential backoff](https://cloud.google.com/iot/docs/how-tos/exponential-backoff) then retries.
  * If the request itself fails (e.g. no internet connection), waits for a while and retries.
- * Status code logic is implemented according to [osu-web](https://github.com/ppy/osu-web/blob/master/resources/lang/en/layout.php).
+ * Throws OperationCancelled as soon as the wrapper's cancellation token is cancelled, including mid-wait.
  * Return true if request succeeds, false if not.
  */
 bool OsuWrapper::apiRequest_(std::string const& url, std::string const& method, std::vector<std::string> headers, std::string const& body, nlohmann::json& responseDataJson /* out */)
 {
+    LOG_ERROR_THROW(
+        m_pHttpRequester,
+        "OsuWrapper was set up for awaitable requests only! url=", url
+    );
+
     std::size_t retries = 0;
     int delayMs = m_apiCooldownMs;
     while (true)
     {
-        std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+        m_pCancelToken->sleepFor(std::chrono::milliseconds(delayMs));
 
-        headers.clear();
-        headers.push_back("Content-Type: application/json");
-        headers.push_back("Accept: application/json");
-        headers.push_back("Authorization: Bearer " + m_pTokenManager->getAccessToken());
+        headers = requestHeaders_();
 
         long httpCode = 0;
         std::string responseData = "";
-        if (!m_pHttpRequester->makeRequest(url, method, headers, body, httpCode, responseData))
+        bool bRequestSucceeded = false;
         {
-            int waitMs = k_curlRetryWaitMs - delayMs;
-            if (waitMs < 0)
+            std::optional<ConcurrencyTuner::Permit> oPermit;
+            if (s_pConcurrencyTuner)
             {
-                waitMs = 0;
+                oPermit = s_pConcurrencyTuner->acquire(*m_pCancelToken);
             }
-
+            bRequestSucceeded = m_pHttpRequester->makeRequest(url, method, headers, body, httpCode, responseData);
+        }
+        if (!bRequestSucceeded)
+        {
+            int waitMs = std::max(k_curlRetryWaitMs - delayMs, 0);
             LOG_WARN("Request failed, retrying in ", waitMs + delayMs, "ms");
-            std::this_thread::sleep_for(std::chrono::milliseconds(waitMs));
+            m_pCancelToken->sleepFor(std::chrono::milliseconds(waitMs));
             continue;
         }
+        if (s_pConcurrencyTuner)
+        {
+            s_pConcurrencyTuner->recordResponse(httpCode);
+        }
+
+        switch (handleResponse_(url, method, httpCode, responseData, retries, delayMs, responseDataJson))
+        {
+            case ResponseAction_::Return:
+                return true;
+            case ResponseAction_::RefreshToken:
+                m_pTokenManager->updateAccessToken(m_pCancelToken);
+                continue;
+            case ResponseAction_::Retry:
+                continue;
+            case ResponseAction_::Fail:
+                return false;
+        }
+    }
+}
+
+/**
+ * WARNING: It is possible for this function to retry forever!
+ *
+ * Awaitable version of apiRequest_. Waits, requests and OAuth token refreshes are all suspended on the AsyncHttpClient instead of blocking a thread.
+ * Successful responses are decoded after hopping onto the CPU thread pool (if any), then the coroutine hops back onto the AsyncHttpClient's pool,
+ * so that whoever awaits it never ends up running on (and tying up) a CPU worker.
+ */
+Task<bool> OsuWrapper::apiRequestAsync_(std::string url, std::string method, std::string body, nlohmann::json& responseDataJson /* out */)
+{
+    LOG_ERROR_THROW(
+        m_pAsyncHttpClient,
+        "OsuWrapper was not set up for awaitable requests! url=", url
+    );
 
-        // 200 OK -> parse and return
-        if (httpCode == 200)
+    std::size_t retries = 0;
+    int delayMs = m_apiCooldownMs;
+    while (true)
+    {
+        co_await m_pAsyncHttpClient->sleepFor(std::chrono::milliseconds(delayMs), m_pCancelToken);
+
+        HttpResponse response;
         {
-            responseDataJson = nlohmann::json::parse(responseData);
-            LOG_ERROR_THROW(
-                responseDataJson.is_object(),
-                "responseDataJson is not an object! responseDataJson=", responseDataJson.dump());
-            return true;
+            std::optional<ConcurrencyTuner::Permit> oPermit;
+            while (s_pConcurrencyTuner && !(oPermit = s_pConcurrencyTuner->tryAcquire()))
+            {
+                co_await m_pAsyncHttpClient->sleepFor(k_permitPollInterval, m_pCancelToken);
+            }
+            response = co_await m_pAsyncHttpClient->request(url, method, requestHeaders_(), body, m_pCancelToken);
         }
-        // 401 Unauthorized -> refresh token
-        else if (httpCode == 401)
+        if (!response.bSuccess)
         {
-            LOG_DEBUG("Got 401, attempting to refresh OAuth token");
-            m_pTokenManager->updateAccessToken();
+            int waitMs = std::max(k_curlRetryWaitMs - delayMs, 0);
+            LOG_WARN("Request failed, retrying in ", waitMs + delayMs, "ms");
+            co_await m_pAsyncHttpClient->sleepFor(std::chrono::milliseconds(waitMs), m_pCancelToken);
             continue;
         }
-        // 404 Not Found
-        else if (httpCode == 404)
+        if (s_pConcurrencyTuner)
         {
-            LOG_ERROR("Got 404 response from ", method, " ", url);
-            return false;
+            s_pConcurrencyTuner->recordResponse(response.httpCode);
         }
-        // 429 Too Many Requests / 5XX Internal Server Error -> increase wait time, then retry
-        else if ((httpCode == 429) || (std::to_string(httpCode)[0] == '5'))
+
+        bool bOnCpuThreadPool = false;
+        if ((response.httpCode == 200) && m_pCpuThreadPool && !m_pCpuThreadPool->isWorkerThread())
         {
-            if (delayMs >= 64000)
-            {
-                double offset = (static_cast<double>(rand()) / RAND_MAX) * 1000;
-                delayMs = static_cast<int>(64000. + std::round(offset));
-            }
-            else
-            {
-                double offset = static_cast<double>(rand()) / RAND_MAX;
-                delayMs = static_cast<int>((std::pow(2, retries) + offset) * 1000.);
-            }
+            co_await m_pCpuThreadPool->schedule();
+            bOnCpuThreadPool = true;
+        }
 
-            LOG_WARN("Request failed (", httpCode, "); retrying in ", delayMs, "ms");
-            ++retries;
-            continue;
+        ResponseAction_ action = ResponseAction_::Fail;
+        std::exception_ptr pError;
+        try
+        {
+            action = handleResponse_(url, method, response.httpCode, response.data, retries, delayMs, responseDataJson);
+        }
+        catch (...)
+        {
+            pError = std::current_exception();
+        }
+
+        if (bOnCpuThreadPool)
+        {
+            co_await m_pAsyncHttpClient->schedule();
+        }
+        if (pError)
+        {
+            std::rethrow_exception(pError);
+        }
+
+        switch (action)
+        {
+            case ResponseAction_::Return:
+                co_return true;
+            case ResponseAction_::RefreshToken:
+                co_await m_pTokenManager->updateAccessTokenAsync(*m_pAsyncHttpClient, m_pCancelToken);
+                continue;
+            case ResponseAction_::Retry:
+                continue;
+            case ResponseAction_::Fail:
+                co_return false;
+        }
+    }
+}
+
+/**
+ * Headers that every osu!API request needs.
+ */
+[[nodiscard]] std::vector<std::string> OsuWrapper::requestHeaders_()
+{
+    return {
+        "Content-Type: application/json",
+        "Accept: application/json",
+        "Authorization: Bearer " + m_pTokenManager->getAccessToken()
+    };
+}
+
+/**
+ * Parse a response body. Without a CPU thread pool (or when already on it) this happens right here;
+ * otherwise the calling thread waits for one of the CPU workers to do it, so that however many I/O threads are waiting on the osu!API,
+ * only as many responses are decoded at once as there are cores.
+ */
+[[nodiscard]] nlohmann::json OsuWrapper::decodeResponse_(std::string const& responseData)
+{
+    if (!m_pCpuThreadPool || m_pCpuThreadPool->isWorkerThread())
+    {
+        return nlohmann::json::parse(responseData);
+    }
+
+    return m_pCpuThreadPool->submit(
+    [&responseData]()
+    {
+        return nlohmann::json::parse(responseData);
+    }).get();
+}
+
+/**
+ * Decide what to do about an osu!API response, parsing it into responseDataJson if it went through.
+ * Bumps retries and delayMs according to exponential backoff if the request should be retried.
+ * Status code logic is implemented according to [osu-web](https://github.com/ppy/osu-web/blob/master/resources/lang/en/layout.php).
+ */
+[[nodiscard]] OsuWrapper::ResponseAction_ OsuWrapper::handleResponse_(
+    std::string const& url,
+    std::string const& method,
+    long const& httpCode,
+    std::string const& responseData,
+    std::size_t& retries /* out */,
+    int& delayMs /* out */,
+    nlohmann::json& responseDataJson /* out */)
+{
+    // 200 OK -> parse and return
+    if (httpCode == 200)
+    {
+        responseDataJson = decodeResponse_(responseData);
+        LOG_ERROR_THROW(
+            responseDataJson.is_object() || responseDataJson.is_array(),
+            "responseDataJson is not an object or array! responseDataJson=", responseDataJson.dump());
+        return ResponseAction_::Return;
+    }
+    // 401 Unauthorized -> refresh token
+    else if (httpCode == 401)
+    {
+        LOG_DEBUG("Got 401, attempting to refresh OAuth token");
+        return ResponseAction_::RefreshToken;
+    }
+    // 404 Not Found
+    else if (httpCode == 404)
+    {
+        LOG_ERROR("Got 404 response from ", method, " ", url);
+        return ResponseAction_::Fail;
+    }
+    // 429 Too Many Requests / 5XX Internal Server Error -> increase wait time, then retry
+    else if ((httpCode == 429) || (std::to_string(httpCode)[0] == '5'))
+    {
+        if (delayMs >= 64000)
+        {
+            double offset = (static_cast<double>(rand()) / RAND_MAX) * 1000;
+            delayMs = static_cast<int>(64000. + std::round(offset));
+        }
+        else
+        {
+            double offset = static_cast<double>(rand()) / RAND_MAX;
+            delayMs = static_cast<int>((std::pow(2, retries) + offset) * 1000.);
         }
 
-        LOG_ERROR("Made ", method, " request to ", url, " and got unhandled response ", httpCode);
-        return false;
+        LOG_WARN("Request failed (", httpCode, "); retrying in ", delayMs, "ms");
+        ++retries;
+        return ResponseAction_::Retry;
     }
-}
\ No newline at end of file
+
+    LOG_ERROR("Made ", method, " request to ", url, " and got unhandled response ", httpCode);
+    return ResponseAction_::Fail;
+}
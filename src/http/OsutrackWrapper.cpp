@@ -7,8 +7,10 @@
 /**
  * OsutrackWrapper constructor.
  */
-OsutrackWrapper::OsutrackWrapper(int const& apiCooldownMs) noexcept
-: m_apiCooldownMs(apiCooldownMs)
+OsutrackWrapper::OsutrackWrapper(int const& apiCooldownMs, std::shared_ptr<CancellationToken> pCancelToken)
+: m_pCancelToken(pCancelToken ? pCancelToken : std::make_shared<CancellationToken>())
+, m_pHttpRequester(std::make_unique<HttpRequester>(m_pCancelToken))
+, m_apiCooldownMs(apiCooldownMs)
 {}
 
 /**
@@ -41,6 +43,7 @@ bool OsutrackWrapper::getBestPlays(Gamemode const& mode, std::string const& from
  * Make CURL request.
  * If a server error occurs, waits according to exponential backoff.
  * If the request itself fails (e.g. no internet connection), waits for a while and retries.
+ * Throws OperationCancelled as soon as the wrapper's cancellation token is cancelled, including mid-wait.
  * Status code logic is implemented according to the [osutrack webserver implementation](https://github.com/Ameobea/osutrack-api/blob/main/src/webserver.ts).
  * Return true if request succeeds, false if not.
  */
@@ -50,7 +53,7 @@ bool OsutrackWrapper::getBestPlays(Gamemode const& mode, std::string const& from
     int delayMs = m_apiCooldownMs;
     while (true)
     {
-        std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+        m_pCancelToken->sleepFor(std::chrono::milliseconds(delayMs));
 
         headers.clear();
         headers.push_back("Accept: application/json");
@@ -66,7 +69,7 @@ bool OsutrackWrapper::getBestPlays(Gamemode const& mode, std::string const& from
             }
 
             LOG_WARN("Request failed, retrying in ", waitMs + delayMs, "ms");
-            std::this_thread::sleep_for(std::chrono::milliseconds(waitMs));
+            m_pCancelToken->sleepFor(std::chrono::milliseconds(waitMs));
             continue;
         }
 
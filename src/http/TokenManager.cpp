@@ -5,6 +5,15 @@
 
 #include <vector>
 
+namespace
+{
+std::string const k_tokenUrl = "https://osu.ppy.sh/oauth/token";
+std::vector<std::string> const k_tokenHeaders = {
+    "Content-Type: application/json",
+    "Accept: application/json"
+};
+} /* namespace */
+
 /**
  * TokenManager constructor.
  */
@@ -26,68 +35,184 @@ TokenManager::TokenManager(std::string const& clientID, std::string const& clien
 /**
  * Update token.
  * If it is already being updated, wait for it.
+ * Retries stop (with OperationCancelled) once pCancelToken is cancelled.
  */
-void TokenManager::updateAccessToken()
+void TokenManager::updateAccessToken(std::shared_ptr<CancellationToken> pCancelToken)
 {
-    std::unique_lock<std::mutex> updateLock(m_updateMtx, std::try_to_lock);
+    if (!pCancelToken)
+    {
+        pCancelToken = std::make_shared<CancellationToken>();
+    }
+
     LOG_DEBUG("Attempting to update access token");
+    if (!tryBeginUpdate_())
+    {
+        LOG_DEBUG("Somebody is already updating the token!");
+        std::unique_lock<std::mutex> lock(m_updateMtx);
+        m_updateCondition.wait(lock,
+        [this]
+        {
+            return !m_bUpdating;
+        });
+        return;
+    }
 
-    if (updateLock.owns_lock())
+    try
     {
         std::unique_lock<std::shared_mutex> tokenLock(m_tokenMtx);
         LOG_INFO("Updating access token");
 
-        std::string url = "https://osu.ppy.sh/oauth/token";
-        std::string method = "POST";
-        std::vector<std::string> headers = {
-            "Content-Type: application/json",
-            "Accept: application/json"
-        };
-        nlohmann::json requestBodyJson = {
-            { "client_id", m_clientID },
-            { "client_secret", m_clientSecret },
-            { "grant_type", "client_credentials" },
-            { "scope", "public" }
-        };
-
+        HttpRequester httpRequester(pCancelToken);
         while (true)
         {
             long httpCode = 0;
             std::string responseData = "";
-            if (!m_pHttpRequester->makeRequest(url, method, headers, requestBodyJson.dump(), httpCode, responseData))
+            if (!httpRequester.makeRequest(k_tokenUrl, "POST", k_tokenHeaders, requestBody_(), httpCode, responseData))
             {
                 LOG_WARN("Request failed, retrying in ", k_tokenWaitMs, "ms");
-                std::this_thread::sleep_for(std::chrono::milliseconds(k_tokenWaitMs));
+                pCancelToken->sleepFor(std::chrono::milliseconds(k_tokenWaitMs));
                 continue;
             }
 
-            // 200 OK -> parse and return
-            if (httpCode == 200)
+            if (handleResponse_(httpCode, responseData, m_accessToken) == TokenAction_::Return)
             {
-                nlohmann::json responseDataJson = nlohmann::json::parse(responseData);
-                LOG_ERROR_THROW(
-                    responseDataJson.is_object(),
-                    "responseDataJson is not an object! responseDataJson=", responseDataJson.dump());
-
-                m_accessToken = responseDataJson.at("access_token").get<std::string>();
-                return;
+                break;
             }
-            // 429 Too Many Requests / 5XX Internal Server Error -> wait, then retry
-            else if ((httpCode == 429) || (std::to_string(httpCode)[0] == '5'))
+            pCancelToken->sleepFor(std::chrono::milliseconds(k_tokenWaitMs));
+        }
+    }
+    catch (...)
+    {
+        endUpdate_();
+        throw;
+    }
+
+    endUpdate_();
+}
+
+/**
+ * Awaitable version of updateAccessToken. Requests and waits between retries are suspended on httpClient instead of blocking a thread.
+ * Unlike updateAccessToken, getAccessToken keeps returning the old token while the update is in flight.
+ */
+[[nodiscard]] Task<void> TokenManager::updateAccessTokenAsync(AsyncHttpClient& httpClient, std::shared_ptr<CancellationToken> pCancelToken)
+{
+    LOG_DEBUG("Attempting to update access token");
+    if (!tryBeginUpdate_())
+    {
+        LOG_DEBUG("Somebody is already updating the token!");
+        while (isUpdating_())
+        {
+            co_await httpClient.sleepFor(std::chrono::milliseconds(k_tokenPollMs), pCancelToken);
+        }
+        co_return;
+    }
+
+    std::exception_ptr pError;
+    try
+    {
+        LOG_INFO("Updating access token");
+        while (true)
+        {
+            HttpResponse response = co_await httpClient.request(k_tokenUrl, "POST", k_tokenHeaders, requestBody_(), pCancelToken);
+            if (!response.bSuccess)
             {
-                LOG_WARN("Request failed (", httpCode, "); retrying in ", k_tokenWaitMs, "ms");
-                std::this_thread::sleep_for(std::chrono::milliseconds(k_tokenWaitMs));
+                LOG_WARN("Request failed, retrying in ", k_tokenWaitMs, "ms");
+                co_await httpClient.sleepFor(std::chrono::milliseconds(k_tokenWaitMs), pCancelToken);
                 continue;
             }
 
-            LOG_ERROR_THROW(false, "Request failed; got unhandled HTTP code ", httpCode);
+            std::string accessToken;
+            if (handleResponse_(response.httpCode, response.data, accessToken) == TokenAction_::Return)
+            {
+                std::unique_lock<std::shared_mutex> tokenLock(m_tokenMtx);
+                m_accessToken = std::move(accessToken);
+                break;
+            }
+            co_await httpClient.sleepFor(std::chrono::milliseconds(k_tokenWaitMs), pCancelToken);
         }
     }
-    else /* we don't own the lock */
+    catch (...)
     {
-        // Wait by trying to grab the lock (once we get it, we know the updater finished)
-        LOG_DEBUG("Somebody is already updating the token!");
-        std::shared_lock<std::shared_mutex> tokenLock(m_tokenMtx);
-        return;
+        pError = std::current_exception();
     }
-}
\ No newline at end of file
+
+    endUpdate_();
+    if (pError)
+    {
+        std::rethrow_exception(pError);
+    }
+}
+
+/**
+ * Claim the update. Return false if somebody else is already updating.
+ */
+[[nodiscard]] bool TokenManager::tryBeginUpdate_()
+{
+    std::lock_guard<std::mutex> lock(m_updateMtx);
+    if (m_bUpdating)
+    {
+        return false;
+    }
+
+    m_bUpdating = true;
+    return true;
+}
+
+/**
+ * Release the update, waking up anyone blocked on it.
+ */
+void TokenManager::endUpdate_()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_updateMtx);
+        m_bUpdating = false;
+    }
+
+    m_updateCondition.notify_all();
+}
+
+[[nodiscard]] bool TokenManager::isUpdating_()
+{
+    std::lock_guard<std::mutex> lock(m_updateMtx);
+    return m_bUpdating;
+}
+
+[[nodiscard]] std::string TokenManager::requestBody_() const
+{
+    nlohmann::json requestBodyJson = {
+        { "client_id", m_clientID },
+        { "client_secret", m_clientSecret },
+        { "grant_type", "client_credentials" },
+        { "scope", "public" }
+    };
+
+    return requestBodyJson.dump();
+}
+
+/**
+ * Decide what to do about a token response, parsing the token into accessToken if it went through.
+ * Throws on responses that retrying won't fix.
+ */
+[[nodiscard]] TokenManager::TokenAction_ TokenManager::handleResponse_(long const& httpCode, std::string const& responseData, std::string& accessToken /* out */) const
+{
+    // 200 OK -> parse and return
+    if (httpCode == 200)
+    {
+        nlohmann::json responseDataJson = nlohmann::json::parse(responseData);
+        LOG_ERROR_THROW(
+            responseDataJson.is_object(),
+            "responseDataJson is not an object! responseDataJson=", responseDataJson.dump());
+
+        accessToken = responseDataJson.at("access_token").get<std::string>();
+        return TokenAction_::Return;
+    }
+    // 429 Too Many Requests / 5XX Internal Server Error -> wait, then retry
+    else if ((httpCode == 429) || (std::to_string(httpCode)[0] == '5'))
+    {
+        LOG_WARN("Request failed (", httpCode, "); retrying in ", k_tokenWaitMs, "ms");
+        return TokenAction_::Retry;
+    }
+
+    LOG_ERROR_THROW(false, "Request failed; got unhandled HTTP code ", httpCode);
+    return TokenAction_::Retry;
+}
@@ -0,0 +1,76 @@
+#include "CountryRankingsPlan.h"
+
+#include <algorithm>
+
+/**
+ * Split callBudget pages of country rankings between the given countries, in proportion to how often each one is filtered by (plus one, so every country gets a share).
+ * Each country picks up right after its last player in the global top 10k, since those are already in the main table.
+ * Returns the pages to fetch, highest priority country first.
+ */
+[[nodiscard]] std::vector<std::pair<CountryCode, Page>> planCountryRankingsPages(
+    std::vector<CountryCode> const& countryCodes,
+    std::unordered_map<std::string, int64_t> const& countryFilterUsage,
+    std::unordered_map<std::string, std::size_t> const& numRankedUsersByCountry,
+    std::size_t const& callBudget)
+{
+    struct CountryPlan
+    {
+        CountryCode countryCode;
+        int64_t weight;
+        Page startPage;
+        std::size_t numPages;
+    };
+
+    std::vector<CountryPlan> countryPlans;
+    countryPlans.reserve(countryCodes.size());
+    for (auto const& countryCode : countryCodes)
+    {
+        auto usageIt = countryFilterUsage.find(countryCode);
+        auto numRankedIt = numRankedUsersByCountry.find(countryCode);
+
+        CountryPlan countryPlan;
+        countryPlan.countryCode = countryCode;
+        countryPlan.weight = 1 + ((usageIt != countryFilterUsage.end()) ? std::max(usageIt->second, static_cast<int64_t>(0)) : 0);
+        countryPlan.startPage = ((numRankedIt != numRankedUsersByCountry.end()) ? numRankedIt->second : 0) / k_batchMaxIDs;
+        countryPlan.numPages = 0;
+        countryPlans.push_back(std::move(countryPlan));
+    }
+
+    std::stable_sort(countryPlans.begin(), countryPlans.end(), [](CountryPlan const& a, CountryPlan const& b) { return a.weight > b.weight; });
+
+    // Weighted round robin; each page goes to whichever country is furthest below its share
+    for (std::size_t i = 0; i < callBudget; ++i)
+    {
+        CountryPlan* pNextCountryPlan = nullptr;
+        for (auto& countryPlan : countryPlans)
+        {
+            if (countryPlan.startPage + countryPlan.numPages >= k_getRankingIDMaxPage)
+            {
+                continue;
+            }
+
+            if (!pNextCountryPlan ||
+                (static_cast<int64_t>(countryPlan.numPages + 1) * pNextCountryPlan->weight < static_cast<int64_t>(pNextCountryPlan->numPages + 1) * countryPlan.weight))
+            {
+                pNextCountryPlan = &countryPlan;
+            }
+        }
+
+        if (!pNextCountryPlan)
+        {
+            break;
+        }
+        ++pNextCountryPlan->numPages;
+    }
+
+    std::vector<std::pair<CountryCode, Page>> countryPages;
+    for (auto const& countryPlan : countryPlans)
+    {
+        for (Page page = countryPlan.startPage; page < countryPlan.startPage + countryPlan.numPages; ++page)
+        {
+            countryPages.emplace_back(countryPlan.countryCode, page);
+        }
+    }
+
+    return countryPages;
+}
@@ -1,15 +1,22 @@
 #include "GetTopPlays.h"
+#include "JobGraph.h"
 #include "Logger.h"
 #include "Util.h"
 #include "OsutrackWrapper.h"
 #include "OsuWrapper.h"
+#include "DosuConfig.h"
 
 #include <string>
 #include <vector>
 #include <cstdint>
-#include <future>
 #include <unordered_map>
 #include <utility>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <unordered_set>
+#include <mutex>
+#include <cstddef>
 
 #include <nlohmann/json.hpp>
 
@@ -32,18 +39,10 @@ std::string printVector(std::vector<T> v)
 }
 
 /**
- * Cross-reference osutrack best play with osu!API.
- * Return true if it was found, as well as the play with osutrack data + osu!API score data filled in.
+ * Build a top play out of the data that osutrack gave us.
  */
-std::pair<bool, TopPlay> findTopPlay(
-    std::shared_ptr<TokenManager> pTokenManager,
-    int64_t const& i,
-    nlohmann::json const& bestPlayObj,
-    Gamemode const& mode)
+TopPlay topPlayFromBestPlay(int64_t const& i, nlohmann::json const& bestPlayObj)
 {
-    OsuWrapper osu(pTokenManager, 0);
-
-    // Fill in data that osutrack gave us
     TopPlay tp = {
         .rank = i,
         .score = {
@@ -60,6 +59,40 @@ std::pair<bool, TopPlay> findTopPlay(
         }
     };
 
+    return tp;
+}
+
+/**
+ * Fill in the score data that the osu!API gave us.
+ */
+void fillInScoreData(TopPlay& tp /* out */, nlohmann::json const& scoreObj, Gamemode const& mode)
+{
+    tp.score.scoreID = scoreObj.at("id").get<ScoreID>();
+    tp.score.accuracy = scoreObj.at("accuracy").get<Accuracy>();
+    tp.score.mods = OsuMods(scoreObj.at("mods").get<std::vector<std::string>>());
+    tp.score.combo = scoreObj.at("max_combo").get<Combo>();
+    tp.score.count300 = scoreObj.at("statistics").at("count_300").get<HitCount>();
+    tp.score.count100 = scoreObj.at("statistics").at("count_100").get<HitCount>();
+    if (mode != Gamemode::Taiko)
+    {
+        tp.score.count50 = scoreObj.at("statistics").at("count_50").get<HitCount>();
+    }
+    tp.score.countMiss = scoreObj.at("statistics").at("count_miss").get<HitCount>();
+}
+
+/**
+ * Cross-reference osutrack best play with osu!API.
+ * Return true if it was found, as well as the play with osutrack data + osu!API score data filled in.
+ */
+std::pair<bool, TopPlay> findTopPlay(
+    std::shared_ptr<TokenManager> pTokenManager,
+    std::shared_ptr<CancellationToken> pCancelToken,
+    std::shared_ptr<ThreadPool> pCpuThreadPool,
+    TopPlay tp,
+    Gamemode const& mode)
+{
+    OsuWrapper osu(pTokenManager, 0, pCancelToken, pCpuThreadPool);
+
     // Attempt to find osu!API data for the score by retrieving all of the user's scores on the beatmap and matching the date
     nlohmann::json userBeatmapScoresObj;
     LOG_ERROR_THROW(
@@ -74,34 +107,170 @@ std::pair<bool, TopPlay> findTopPlay(
         if (tp.score.createdAt == ISO8601DateTimeUTC(userBeatmapScore.at("created_at").get<std::string>()))
         {
             bFoundScore = true;
+            fillInScoreData(tp, userBeatmapScore, mode);
+        }
+    }
 
-            // Fill in the score data that we got
-            tp.score.scoreID = userBeatmapScore.at("id").get<ScoreID>();
-            tp.score.accuracy = userBeatmapScore.at("accuracy").get<Accuracy>();
-            tp.score.mods = OsuMods(userBeatmapScore.at("mods").get<std::vector<std::string>>());
-            tp.score.combo = userBeatmapScore.at("max_combo").get<Combo>();
-            tp.score.count300 = userBeatmapScore.at("statistics").at("count_300").get<HitCount>();
-            tp.score.count100 = userBeatmapScore.at("statistics").at("count_100").get<HitCount>();
-            if (mode != Gamemode::Taiko)
+    return std::make_pair(bFoundScore, tp);
+}
+
+/**
+ * Cross-reference all of a user's osutrack best plays with osu!API.
+ * Matches them against the user's best scores in a single request, falling back to a per-beatmap lookup
+ * (see findTopPlay) for any play that isn't in there.
+ */
+std::vector<std::pair<bool, TopPlay>> findUserTopPlays(
+    std::shared_ptr<TokenManager> pTokenManager,
+    std::shared_ptr<CancellationToken> pCancelToken,
+    std::shared_ptr<ThreadPool> pCpuThreadPool,
+    std::vector<TopPlay> userTopPlays,
+    Gamemode const& mode)
+{
+    std::vector<std::pair<bool, TopPlay>> results;
+    results.reserve(userTopPlays.size());
+
+    // A single play costs one call either way, and the per-beatmap lookup always has it
+    if (userTopPlays.size() == 1)
+    {
+        results.push_back(findTopPlay(pTokenManager, pCancelToken, pCpuThreadPool, userTopPlays.front(), mode));
+        return results;
+    }
+
+    UserID userID = userTopPlays.front().score.user.userID;
+    OsuWrapper osu(pTokenManager, 0, pCancelToken, pCpuThreadPool);
+    nlohmann::json userScoresArr;
+    if (!osu.getUserScores(userID, "best", mode, k_userScoresMaxLimit, userScoresArr))
+    {
+        LOG_WARN("Failed to get best ", mode.toString(), " scores for user ", userID, " - falling back to per-beatmap lookups");
+        userScoresArr = nlohmann::json::array();
+    }
+
+    // Index the user's scores by beatmap so each play can be matched by beatmap + date
+    std::unordered_multimap<BeatmapID, nlohmann::json const*> scoresByBeatmap;
+    for (auto const& userScore : userScoresArr)
+    {
+        try
+        {
+            scoresByBeatmap.emplace(userScore.at("beatmap").at("id").get<BeatmapID>(), &userScore);
+        }
+        catch (nlohmann::json::exception const& e)
+        {
+            LOG_WARN("Score object for user ", userID, " is missing its beatmap - skipping");
+        }
+    }
+
+    std::size_t numFallbacks = 0;
+    for (auto& tp : userTopPlays)
+    {
+        bool bFoundScore = false;
+        auto [beginIt, endIt] = scoresByBeatmap.equal_range(tp.score.beatmap.beatmapID);
+        for (auto it = beginIt; it != endIt; ++it)
+        {
+            nlohmann::json const& userScore = *(it->second);
+            if (tp.score.createdAt == ISO8601DateTimeUTC(userScore.at("created_at").get<std::string>()))
             {
-                tp.score.count50 = userBeatmapScore.at("statistics").at("count_50").get<HitCount>();
+                bFoundScore = true;
+                fillInScoreData(tp, userScore, mode);
+                break;
             }
-            tp.score.countMiss = userBeatmapScore.at("statistics").at("count_miss").get<HitCount>();
+        }
+
+        if (bFoundScore)
+        {
+            results.push_back(std::make_pair(true, tp));
+        }
+        else
+        {
+            ++numFallbacks;
+            results.push_back(findTopPlay(pTokenManager, pCancelToken, pCpuThreadPool, tp, mode));
         }
     }
 
-    return std::make_pair(bFoundScore, tp);
+    LOG_DEBUG("Resolved ", userTopPlays.size(), " ", mode.toString(), " plays for user ", userID, " with ", numFallbacks, " per-beatmap fallbacks");
+    return results;
+}
+
+/**
+ * Hit/miss counters for the beatmap and user profile caches.
+ */
+struct CacheStats
+{
+    std::atomic<std::size_t> beatmapHits = 0;
+    std::atomic<std::size_t> beatmapMisses = 0;
+    std::atomic<std::size_t> userHits = 0;
+    std::atomic<std::size_t> userMisses = 0;
+};
+
+/**
+ * Parse beatmap metadata out of an osu!API beatmap object.
+ */
+std::pair<Beatmap, BeatmapStatus> beatmapFromJson(nlohmann::json const& beatmapObj)
+{
+    Beatmap beatmap = {
+        .beatmapID = beatmapObj.at("id").get<BeatmapID>(),
+        .starRating = beatmapObj.at("difficulty_rating").get<StarRating>(),
+        .difficultyName = beatmapObj.at("version").get<DifficultyName>(),
+        .artist = beatmapObj.at("beatmapset").at("artist").get<BeatmapArtist>(),
+        .title = beatmapObj.at("beatmapset").at("title").get<BeatmapTitle>(),
+        .mapsetCreator = beatmapObj.at("beatmapset").at("creator").get<Username>(),
+        .maxCombo = beatmapObj.at("max_combo").get<Combo>()
+    };
+
+    return std::make_pair(beatmap, beatmapObj.at("status").get<BeatmapStatus>());
+}
+
+/**
+ * Parse user profile out of an osu!API user object.
+ */
+RankingsUser userFromJson(nlohmann::json const& userObj, Gamemode const& mode)
+{
+    nlohmann::json const& statistics = userObj.at("statistics_rulesets").at(mode.toString());
+    RankingsUser user = {
+        .userID = userObj.at("id").get<UserID>(),
+        .username = userObj.at("username").get<Username>(),
+        .countryCode = userObj.at("country_code").get<CountryCode>(),
+        .pfpLink = userObj.at("avatar_url").get<ProfilePicture>(),
+        .performancePoints = statistics.at("pp").get<PerformancePoints>(),
+        .accuracy = statistics.at("hit_accuracy").get<Accuracy>(),
+        .hoursPlayed = static_cast<HoursPlayed>(statistics.at("play_time").get<uint64_t>() / 3600), // FIXME: round instead of trunc
+        .currentRank = statistics.at("global_rank").get<Rank>()
+    };
+
+    return user;
+}
+
+/**
+ * Return the IDs that are not keys of the map.
+ */
+template<typename K, typename V>
+std::vector<K> missingKeys(std::vector<K> const& keys, std::unordered_map<K, V> const& map)
+{
+    std::vector<K> missing;
+    missing.reserve(keys.size());
+    for (auto const& key : keys)
+    {
+        if (!map.contains(key))
+        {
+            missing.push_back(key);
+        }
+    }
+    return missing;
 }
 
 /**
  * Fill in remaining fields for each play in given chunk.
+ * User profiles and beatmap metadata are served from the cache where possible; only unknown or stale ones are requested.
  */
 std::vector<TopPlay> fillInTopPlaysChunk(
     std::shared_ptr<TokenManager> pTokenManager,
+    std::shared_ptr<CancellationToken> pCancelToken,
+    std::shared_ptr<ThreadPool> pCpuThreadPool,
+    std::shared_ptr<CacheDatabase> pCacheDb,
     std::vector<TopPlay> topPlaysChunk,
-    Gamemode const& mode)
+    Gamemode const& mode,
+    CacheStats& cacheStats /* out */)
 {
-    OsuWrapper osu(pTokenManager, 0);
+    OsuWrapper osu(pTokenManager, 0, pCancelToken, pCpuThreadPool);
 
     // Collect userIDs and beatmapIDs so that we can batch request
     std::vector<UserID> userIDs;
@@ -110,39 +279,95 @@ std::vector<TopPlay> fillInTopPlaysChunk(
     beatmapIDs.reserve(topPlaysChunk.size());
     for (auto const& topPlay : topPlaysChunk)
     {
-        userIDs.push_back(topPlay.score.user.userID);
-        beatmapIDs.push_back(topPlay.score.beatmap.beatmapID);
+        if (std::find(userIDs.begin(), userIDs.end(), topPlay.score.user.userID) == userIDs.end())
+        {
+            userIDs.push_back(topPlay.score.user.userID);
+        }
+        if (std::find(beatmapIDs.begin(), beatmapIDs.end(), topPlay.score.beatmap.beatmapID) == beatmapIDs.end())
+        {
+            beatmapIDs.push_back(topPlay.score.beatmap.beatmapID);
+        }
     }
 
-    // Do batch requests
-    nlohmann::json usersArr;
-    nlohmann::json beatmapsArr;
-    LOG_ERROR_THROW(
-        osu.getUsers(userIDs, mode, usersArr),
-        "Failed to get users! userIDs=", printVector(userIDs), ", mode=", mode.toString()
-    );
-    LOG_ERROR_THROW(
-        osu.getBeatmaps(beatmapIDs, mode, beatmapsArr),
-        "Failed to get beatmaps! beatmapIDs=", printVector(beatmapIDs), ", mode=", mode.toString()
-    );
+    // Check which users and beatmaps we already know about
+    std::unordered_map<UserID, RankingsUser> userMap = pCacheDb->getUserProfiles(userIDs, mode);
+    std::vector<UserID> missingUserIDs = missingKeys(userIDs, userMap);
+    cacheStats.userHits += userIDs.size() - missingUserIDs.size();
+    cacheStats.userMisses += missingUserIDs.size();
 
-    // Fill in missing data
+    std::unordered_map<BeatmapID, Beatmap> beatmapMap = pCacheDb->getBeatmaps(beatmapIDs);
+    std::vector<BeatmapID> missingBeatmapIDs = missingKeys(beatmapIDs, beatmapMap);
+    cacheStats.beatmapHits += beatmapIDs.size() - missingBeatmapIDs.size();
+    cacheStats.beatmapMisses += missingBeatmapIDs.size();
+
+    // Do batch requests for the rest
     // We can't rely on ordering since osu!API batch requests return sets (no duplicates)
-    std::unordered_map<UserID, nlohmann::json> userMap;
-    std::unordered_map<BeatmapID, nlohmann::json> beatmapMap;
-    for (auto const& userObj : usersArr.at("users"))
+    std::unordered_set<UserID> malformedUserIDs;
+    if (!missingUserIDs.empty())
     {
-        userMap[userObj.at("id")] = userObj;
+        nlohmann::json usersArr;
+        LOG_ERROR_THROW(
+            osu.getUsers(missingUserIDs, mode, usersArr),
+            "Failed to get users! userIDs=", printVector(missingUserIDs), ", mode=", mode.toString()
+        );
+
+        std::vector<RankingsUser> fetchedUsers;
+        fetchedUsers.reserve(missingUserIDs.size());
+        for (auto const& userObj : usersArr.at("users"))
+        {
+            try
+            {
+                fetchedUsers.push_back(userFromJson(userObj, mode));
+                userMap[fetchedUsers.back().userID] = fetchedUsers.back();
+            }
+            catch (nlohmann::json::exception const& e)
+            {
+                LOG_ERROR("Object for user ", userObj.value("id", -1), " contains missing or unexpected fields - skipping");
+                malformedUserIDs.insert(userObj.value("id", -1));
+            }
+        }
+
+        pCacheDb->upsertUserProfiles(fetchedUsers, mode);
     }
-    for (auto const& beatmapObj : beatmapsArr.at("beatmaps"))
+
+    std::unordered_set<BeatmapID> malformedBeatmapIDs;
+    if (!missingBeatmapIDs.empty())
     {
-        beatmapMap[beatmapObj.at("id")] = beatmapObj;
+        nlohmann::json beatmapsArr;
+        LOG_ERROR_THROW(
+            osu.getBeatmaps(missingBeatmapIDs, mode, beatmapsArr),
+            "Failed to get beatmaps! beatmapIDs=", printVector(missingBeatmapIDs), ", mode=", mode.toString()
+        );
+
+        std::vector<std::pair<Beatmap, BeatmapStatus>> fetchedBeatmaps;
+        fetchedBeatmaps.reserve(missingBeatmapIDs.size());
+        for (auto const& beatmapObj : beatmapsArr.at("beatmaps"))
+        {
+            try
+            {
+                fetchedBeatmaps.push_back(beatmapFromJson(beatmapObj));
+                beatmapMap[fetchedBeatmaps.back().first.beatmapID] = fetchedBeatmaps.back().first;
+            }
+            catch (nlohmann::json::exception const& e)
+            {
+                LOG_ERROR("Object for beatmap ", beatmapObj.value("id", -1), " contains missing or unexpected fields - skipping");
+                malformedBeatmapIDs.insert(beatmapObj.value("id", -1));
+            }
+        }
+
+        pCacheDb->upsertBeatmaps(fetchedBeatmaps);
     }
 
+    // Fill in missing data
     std::vector<TopPlay> completedTopPlays;
     completedTopPlays.reserve(topPlaysChunk.size());
     for (auto const& topPlay : topPlaysChunk)
     {
+        if (malformedUserIDs.contains(topPlay.score.user.userID) || malformedBeatmapIDs.contains(topPlay.score.beatmap.beatmapID))
+        {
+            continue;
+        }
+
         auto userIt = userMap.find(topPlay.score.user.userID);
         LOG_ERROR_THROW(
             userIt != userMap.end(),
@@ -154,146 +379,289 @@ std::vector<TopPlay> fillInTopPlaysChunk(
             "Failed to find beatmapID ", topPlay.score.beatmap.beatmapID, " in beatmapMap!"
         );
 
-        nlohmann::json userObj = userIt->second;
-        nlohmann::json beatmapObj = beatmapIt->second;
         TopPlay completedTopPlay = topPlay;
+        completedTopPlay.score.user = userIt->second;
+        completedTopPlay.score.beatmap = beatmapIt->second;
 
-        try
+        completedTopPlays.push_back(completedTopPlay);
+    }
+
+    return completedTopPlays;
+}
+
+/**
+ * Shared state for streaming resolved plays into the fill-in step, and filled in plays into the database.
+ */
+struct TopPlaysPipeline
+{
+    std::mutex mtx;
+    std::vector<TopPlay> pendingTopPlays;
+    std::vector<TopPlay> completeTopPlays;
+    std::size_t numSavedTopPlays = 0;
+    std::size_t numTopPlays = 0;
+    CacheStats cacheStats;
+};
+
+/**
+ * Insert a batch of filled in plays, each batch in its own transaction.
+ */
+void saveTopPlays(
+    std::shared_ptr<TopPlaysDatabase> pTopPlaysDb,
+    std::vector<TopPlay> const& topPlays,
+    Gamemode const& mode,
+    TopPlaysPipeline& pipeline /* out */)
+{
+    pTopPlaysDb->insertTopPlays(mode, topPlays);
+
+    // The rolling window isn't wiped, so only today's plays need to go into it
+    if (DosuConfig::topPlaysWindowDays > 1)
+    {
+        pTopPlaysDb->mergeTopPlaysWindow(mode, topPlays, DosuConfig::topPlaysWindowDays, static_cast<std::size_t>(DosuConfig::topPlaysCount));
+    }
+
+    std::lock_guard<std::mutex> lock(pipeline.mtx);
+    pipeline.numSavedTopPlays += topPlays.size();
+    LOG_INFO("Saved ", pipeline.numSavedTopPlays, " of ", pipeline.numTopPlays, " ", mode.toString(), " plays");
+}
+
+/**
+ * Resolve a user's plays and push them into the pipeline.
+ * Whichever task completes a chunk fills it in right away, rather than waiting for every play to be resolved first;
+ * likewise, whichever task fills in enough plays saves them, so that at most about k_topPlaysChunkSize of them are held at once (per worker).
+ */
+void resolveUserTopPlays(
+    std::shared_ptr<TokenManager> pTokenManager,
+    std::shared_ptr<CancellationToken> pCancelToken,
+    std::shared_ptr<ThreadPool> pCpuThreadPool,
+    std::shared_ptr<TopPlaysDatabase> pTopPlaysDb,
+    std::shared_ptr<CacheDatabase> pCacheDb,
+    std::vector<TopPlay> userTopPlays,
+    Gamemode const& mode,
+    TopPlaysPipeline& pipeline /* out */)
+{
+    std::vector<std::pair<bool, TopPlay>> resolvedTopPlays = findUserTopPlays(pTokenManager, pCancelToken, pCpuThreadPool, std::move(userTopPlays), mode);
+
+    std::vector<std::vector<TopPlay>> topPlaysChunks;
+    {
+        std::lock_guard<std::mutex> lock(pipeline.mtx);
+        for (auto& [bFoundScore, tp] : resolvedTopPlays)
         {
-            completedTopPlay.score.user.username = userObj.at("username").get<Username>();
-            completedTopPlay.score.user.countryCode = userObj.at("country_code").get<CountryCode>();
-            completedTopPlay.score.user.pfpLink = userObj.at("avatar_url").get<ProfilePicture>();
-            completedTopPlay.score.user.performancePoints = userObj.at("statistics_rulesets").at(mode.toString()).at("pp").get<PerformancePoints>();
-            completedTopPlay.score.user.accuracy = userObj.at("statistics_rulesets").at(mode.toString()).at("hit_accuracy").get<Accuracy>();
-            completedTopPlay.score.user.hoursPlayed = static_cast<HoursPlayed>(userObj.at("statistics_rulesets").at(mode.toString()).at("play_time").get<uint64_t>() / 3600); // FIXME: round instead of trunc
-            completedTopPlay.score.user.currentRank = userObj.at("statistics_rulesets").at(mode.toString()).at("global_rank").get<Rank>();
+            if (!bFoundScore)
+            {
+                LOG_WARN("Failed to find ", mode.toString(), " score set by user ", tp.score.user.userID, " on beatmap ", tp.score.beatmap.beatmapID, " - score was skipped");
+                continue;
+            }
+            pipeline.pendingTopPlays.push_back(std::move(tp));
         }
-        catch (nlohmann::json::exception const& e)
+
+        while (pipeline.pendingTopPlays.size() >= k_batchMaxIDs)
         {
-            LOG_ERROR("Object for user ", topPlay.score.user.userID, " contains missing or unexpected fields - skipping");
-            continue;
+            auto endIt = pipeline.pendingTopPlays.begin();
+            std::advance(endIt, k_batchMaxIDs);
+            topPlaysChunks.emplace_back(std::make_move_iterator(pipeline.pendingTopPlays.begin()), std::make_move_iterator(endIt));
+            pipeline.pendingTopPlays.erase(pipeline.pendingTopPlays.begin(), endIt);
         }
+    }
 
-        try
+    for (auto& topPlaysChunk : topPlaysChunks)
+    {
+        std::vector<TopPlay> completeTopPlaysChunk = fillInTopPlaysChunk(pTokenManager, pCancelToken, pCpuThreadPool, pCacheDb, std::move(topPlaysChunk), mode, pipeline.cacheStats);
+
+        std::vector<TopPlay> savableTopPlays;
         {
-            completedTopPlay.score.beatmap.maxCombo = beatmapObj.at("max_combo").get<Combo>();
-            completedTopPlay.score.beatmap.difficultyName = beatmapObj.at("version").get<DifficultyName>();
-            completedTopPlay.score.beatmap.artist = beatmapObj.at("beatmapset").at("artist").get<BeatmapArtist>();
-            completedTopPlay.score.beatmap.title = beatmapObj.at("beatmapset").at("title").get<BeatmapTitle>();
-            completedTopPlay.score.beatmap.mapsetCreator = beatmapObj.at("beatmapset").at("creator").get<Username>();
-            completedTopPlay.score.beatmap.starRating = beatmapObj.at("difficulty_rating").get<StarRating>();
+            std::lock_guard<std::mutex> lock(pipeline.mtx);
+            pipeline.completeTopPlays.insert(pipeline.completeTopPlays.end(), std::make_move_iterator(completeTopPlaysChunk.begin()), std::make_move_iterator(completeTopPlaysChunk.end()));
+            if (pipeline.completeTopPlays.size() >= k_topPlaysChunkSize)
+            {
+                savableTopPlays.swap(pipeline.completeTopPlays);
+            }
         }
-        catch (nlohmann::json::exception const& e)
+
+        if (!savableTopPlays.empty())
         {
-            LOG_ERROR("Object for beatmap ", topPlay.score.beatmap.beatmapID, " contains missing or unexpected fields - skipping");
-            continue;
+            saveTopPlays(pTopPlaysDb, savableTopPlays, mode, pipeline);
         }
-
-        completedTopPlays.push_back(completedTopPlay);
     }
-
-    return completedTopPlays;
 }
 
 /**
- * Get today's top plays for given mode.
+ * Get today's best plays from osutrack for given mode.
+ * osutrack can't page through them, so the response is parsed down to the few fields it has right away rather than kept around.
  */
-void getTopPlaysMode(
-    OsutrackWrapper& osutrack,
-    std::shared_ptr<TokenManager> pTokenManager,
-    std::shared_ptr<TopPlaysDatabase> pTopPlaysDb,
-    std::shared_ptr<ThreadPool> pThreadPool,
-    ISO8601DateTimeUTC const& now,
-    Gamemode const& mode)
+std::vector<TopPlay> fetchBestPlays(std::shared_ptr<CancellationToken> pCancelToken, ISO8601DateTimeUTC const& now, std::size_t const& numTopPlays, Gamemode const& mode)
 {
-    // Grab the top plays
+    OsutrackWrapper osutrack(0, pCancelToken);
+
     nlohmann::json bestPlaysArr;
     ISO8601DateTimeUTC yesterday = now;
     yesterday.addDays(-1);
     LOG_ERROR_THROW(
-        osutrack.getBestPlays(mode, yesterday.toDateString(), now.toDateString(), k_numTopPlays, bestPlaysArr),
+        osutrack.getBestPlays(mode, yesterday.toDateString(), now.toDateString(), numTopPlays, bestPlaysArr),
         "Failed to get best plays! mode=", mode.toString(), ", from=", yesterday.toString(), ", to=", now.toString()
     );
     LOG_ERROR_THROW(
-        bestPlaysArr.size() <= k_numTopPlays,
-        "Expected at most ", k_numTopPlays, " plays from osu!track but got ", bestPlaysArr.size()
+        bestPlaysArr.size() <= numTopPlays,
+        "Expected at most ", numTopPlays, " plays from osu!track but got ", bestPlaysArr.size()
     );
 
-    // Try to find each top play in the osu!API
+    std::vector<TopPlay> bestPlays;
+    bestPlays.reserve(bestPlaysArr.size());
     int64_t i = 1;
-    std::vector<TopPlay> topPlays;
-    topPlays.reserve(k_numTopPlays);
-
-    std::vector<std::future<std::pair<bool, TopPlay>>> topPlayFutures;
-    topPlayFutures.reserve(bestPlaysArr.size());
     for (auto const& bestPlayObj : bestPlaysArr)
     {
-        auto futureTopPlay = pThreadPool->submit(findTopPlay, pTokenManager, i++, bestPlayObj, mode);
-        topPlayFutures.push_back(std::move(futureTopPlay));
+        bestPlays.push_back(topPlayFromBestPlay(i++, bestPlayObj));
     }
 
-    for (auto& futureTopPlay : topPlayFutures)
+    return bestPlays;
+}
+
+/**
+ * Everything that a mode's stages pass along to each other.
+ */
+struct TopPlaysModeState
+{
+    std::vector<TopPlay> bestPlays;
+    TopPlaysPipeline pipeline;
+};
+
+/**
+ * Resolve today's top plays for given mode, fill them in and save them, all in one stream.
+ * Plays are resolved against the osu!API per user, filled in chunk by chunk as soon as enough of them are resolved,
+ * and saved k_topPlaysChunkSize at a time as soon as enough of them are filled in, so no step ever waits for a whole batch of another to drain.
+ * bestPlays is taken by value and moved into the per-user groups, so the day's plays are only ever held once.
+ */
+void ingestTopPlays(
+    std::vector<TopPlay> bestPlays,
+    std::shared_ptr<TokenManager> pTokenManager,
+    std::shared_ptr<CancellationToken> pCancelToken,
+    std::shared_ptr<ThreadPool> pCpuThreadPool,
+    std::shared_ptr<TopPlaysDatabase> pTopPlaysDb,
+    std::shared_ptr<CacheDatabase> pCacheDb,
+    std::shared_ptr<ThreadPool> pThreadPool,
+    Gamemode const& mode,
+    TopPlaysPipeline& pipeline /* out */)
+{
+    // Try to find each top play in the osu!API
+    // Top players often have several plays in here, so group them and resolve each user's plays together
+    std::vector<std::vector<TopPlay>> userTopPlaysGroups;
+    std::unordered_map<UserID, std::size_t> userToGroupIdx;
+    for (auto& tp : bestPlays)
     {
-        auto [bFoundScore, tp] = futureTopPlay.get();
-        if (!bFoundScore)
+        auto [groupIt, bInserted] = userToGroupIdx.try_emplace(tp.score.user.userID, userTopPlaysGroups.size());
+        if (bInserted)
         {
-            LOG_WARN("Failed to find ", mode.toString(), " score set by user ", tp.score.user.userID, " on beatmap ", tp.score.beatmap.beatmapID, " - score was skipped");
-            continue;
+            userTopPlaysGroups.emplace_back();
         }
-        topPlays.push_back(tp);
+        userTopPlaysGroups[groupIt->second].push_back(std::move(tp));
     }
+    LOG_INFO("Resolving ", bestPlays.size(), " ", mode.toString(), " plays from ", userTopPlaysGroups.size(), " users");
 
-    // Fill in any missing information using osu!API
-    std::vector<TopPlay> completeTopPlays;
-    completeTopPlays.reserve(topPlays.size());
+    pipeline.numTopPlays = bestPlays.size();
 
-    std::vector<std::future<std::vector<TopPlay>>> completeTopPlaysChunkFutures;
-    std::size_t numChunks = (topPlays.size() + k_batchMaxIDs - 1) / k_batchMaxIDs;
-    completeTopPlaysChunkFutures.reserve(numChunks);
-    for (std::size_t j = 0; j < topPlays.size(); j += k_batchMaxIDs)
+    // Every play has been moved out by now, so don't keep the (moved-from) shells around while they're resolved
+    std::vector<TopPlay>().swap(bestPlays);
+
+    // How many calls a user costs varies a lot (see findUserTopPlays), so give each one its own task to keep the workers balanced
+    pThreadPool->parallelFor(0, userTopPlaysGroups.size(),
+    [&userTopPlaysGroups, &pipeline, pTokenManager, pCancelToken, pCpuThreadPool, pTopPlaysDb, pCacheDb, mode](std::size_t const& groupIdx)
     {
-        std::size_t endIdx = std::min(j + k_batchMaxIDs, topPlays.size());
-        auto beginIt = topPlays.begin();
-        std::advance(beginIt, j);
-        auto endIt = topPlays.begin();
-        std::advance(endIt, endIdx);
-        std::vector<TopPlay> topPlaysChunk(beginIt, endIt);
-        auto futureCompleteTopPlaysChunk = pThreadPool->submit(fillInTopPlaysChunk, pTokenManager, topPlaysChunk, mode);
-        completeTopPlaysChunkFutures.push_back(std::move(futureCompleteTopPlaysChunk));
-    }
+        resolveUserTopPlays(pTokenManager, pCancelToken, pCpuThreadPool, pTopPlaysDb, pCacheDb, std::move(userTopPlaysGroups[groupIdx]), mode, pipeline);
+    }, 1);
 
-    for (auto& futureCompleteTopPlaysChunk : completeTopPlaysChunkFutures)
+    // Fill in and save whatever didn't make up a full chunk
+    if (!pipeline.pendingTopPlays.empty())
     {
-        auto completeTopPlaysChunk = futureCompleteTopPlaysChunk.get();
-        completeTopPlays.insert(completeTopPlays.end(), std::make_move_iterator(completeTopPlaysChunk.begin()), std::make_move_iterator(completeTopPlaysChunk.end()));
+        std::vector<TopPlay> completeTopPlaysChunk = fillInTopPlaysChunk(pTokenManager, pCancelToken, pCpuThreadPool, pCacheDb, std::move(pipeline.pendingTopPlays), mode, pipeline.cacheStats);
+        pipeline.completeTopPlays.insert(pipeline.completeTopPlays.end(), std::make_move_iterator(completeTopPlaysChunk.begin()), std::make_move_iterator(completeTopPlaysChunk.end()));
+    }
+    if (!pipeline.completeTopPlays.empty())
+    {
+        std::vector<TopPlay> savableTopPlays;
+        savableTopPlays.swap(pipeline.completeTopPlays);
+        saveTopPlays(pTopPlaysDb, savableTopPlays, mode, pipeline);
     }
 
-    pTopPlaysDb->insertTopPlays(mode, completeTopPlays);
+    CacheStats const& cacheStats = pipeline.cacheStats;
+    std::size_t numUserLookups = cacheStats.userHits + cacheStats.userMisses;
+    std::size_t numBeatmapLookups = cacheStats.beatmapHits + cacheStats.beatmapMisses;
+    LOG_INFO(
+        "Cache hit rates for ", mode.toString(), ": ",
+        "users ", cacheStats.userHits, "/", numUserLookups, " (", (numUserLookups > 0 ? (100 * cacheStats.userHits / numUserLookups) : 0), "%), ",
+        "beatmaps ", cacheStats.beatmapHits, "/", numBeatmapLookups, " (", (numBeatmapLookups > 0 ? (100 * cacheStats.beatmapHits / numBeatmapLookups) : 0), "%)"
+    );
+}
+
+/**
+ * Add the stages that get today's top plays for given mode.
+ * Modes don't depend on each other, so one mode's osutrack request doesn't hold up the others.
+ */
+void addTopPlaysModeStages(
+    JobGraph& jobGraph /* out */,
+    TopPlaysModeState& modeState /* out */,
+    ISO8601DateTimeUTC const& now,
+    std::shared_ptr<TokenManager> pTokenManager,
+    std::shared_ptr<CancellationToken> pCancelToken,
+    std::shared_ptr<ThreadPool> pCpuThreadPool,
+    std::shared_ptr<TopPlaysDatabase> pTopPlaysDb,
+    std::shared_ptr<CacheDatabase> pCacheDb,
+    std::shared_ptr<ThreadPool> pThreadPool,
+    Gamemode const& mode)
+{
+    std::string const prefix = mode.toString() + ":";
+
+    jobGraph.addStage(prefix + "fetch", {},
+    [&modeState, pCancelToken, now, mode]()
+    {
+        modeState.bestPlays = fetchBestPlays(pCancelToken, now, static_cast<std::size_t>(DosuConfig::topPlaysCount), mode);
+    });
+
+    // Plays are inserted as they're resolved, so today's tables have to be wiped first
+    jobGraph.addStage(prefix + "resolve", { "token", "wipe", prefix + "fetch" },
+    [&modeState, pTokenManager, pCancelToken, pCpuThreadPool, pTopPlaysDb, pCacheDb, pThreadPool, mode]()
+    {
+        ingestTopPlays(std::move(modeState.bestPlays), pTokenManager, pCancelToken, pCpuThreadPool, pTopPlaysDb, pCacheDb, pThreadPool, mode, modeState.pipeline);
+    });
 }
 } /* namespace */
 
 /**
- * Get daily top plays for each mode.
- * Makes 4 osutrack API calls and up to [4 * k_numTopPlays + 8 * ceil(k_numTopPlays / 50)] osu!API calls.
+ * Get daily top plays for each mode, and merge them into the rolling window of the last TOP_PLAYS_WINDOW_DAYS days.
+ * Makes 4 osutrack API calls and roughly [4 * TOP_PLAYS_COUNT + 8 * ceil(TOP_PLAYS_COUNT / 50)] osu!API calls at worst.
+ * In practice far fewer, since each user's plays are resolved together with one call.
  */
 void getTopPlays(
     std::shared_ptr<TokenManager> pTokenManager,
+    std::shared_ptr<CancellationToken> pCancelToken,
     std::shared_ptr<TopPlaysDatabase> pTopPlaysDb,
-    std::shared_ptr<ThreadPool> pThreadPool)
+    std::shared_ptr<CacheDatabase> pCacheDb,
+    std::shared_ptr<ThreadPool> pThreadPool,
+    std::shared_ptr<ThreadPool> pCpuThreadPool)
 {
     LOG_INFO("Grabbing top plays of the day");
 
-    OsutrackWrapper osutrack(0);
     ISO8601DateTimeUTC now;
+    JobGraph jobGraph("getTopPlays");
 
-    pTopPlaysDb->wipeTables();
+    jobGraph.addStage("wipe", {},
+    [pTopPlaysDb]()
+    {
+        pTopPlaysDb->wipeTables();
+    });
 
     // Update the token so that all the concurrent threads don't spin on it later
-    pTokenManager->updateAccessToken();
+    jobGraph.addStage("token", {},
+    [pTokenManager, pCancelToken]()
+    {
+        pTokenManager->updateAccessToken(pCancelToken);
+    });
 
     // Do work for each mode
-    getTopPlaysMode(osutrack, pTokenManager, pTopPlaysDb, pThreadPool, now, Gamemode::Osu);
-    getTopPlaysMode(osutrack, pTokenManager, pTopPlaysDb, pThreadPool, now, Gamemode::Taiko);
-    getTopPlaysMode(osutrack, pTokenManager, pTopPlaysDb, pThreadPool, now, Gamemode::Mania);
-    getTopPlaysMode(osutrack, pTokenManager, pTopPlaysDb, pThreadPool, now, Gamemode::Catch);
+    const std::vector<Gamemode> modes = { Gamemode::Osu, Gamemode::Taiko, Gamemode::Mania, Gamemode::Catch };
+    std::vector<TopPlaysModeState> modeStates(modes.size());
+    for (std::size_t i = 0; i < modes.size(); ++i)
+    {
+        addTopPlaysModeStages(jobGraph, modeStates[i], now, pTokenManager, pCancelToken, pCpuThreadPool, pTopPlaysDb, pCacheDb, pThreadPool, modes[i]);
+    }
+
+    jobGraph.run(pThreadPool, pCancelToken, pCpuThreadPool);
 }
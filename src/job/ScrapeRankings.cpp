@@ -1,5 +1,10 @@
 #include "ScrapeRankings.h"
+#include "CountryRankingsPlan.h"
+#include "JobGraph.h"
 #include "OsuWrapper.h"
+#include "AsyncHttpClient.h"
+#include "Task.h"
+#include "DosuConfig.h"
 #include "Util.h"
 #include "Logger.h"
 
@@ -10,26 +15,22 @@
 #include <string>
 #include <cstdint>
 #include <cstddef>
-#include <future>
 #include <utility>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <fstream>
+#include <chrono>
 
 namespace
 {
+constexpr std::size_t k_asyncBatchSize = 500;
+
 /**
- * Get rankings user for given page and mode.
+ * Parse rankings users out of a page of osu! rankings.
  */
-std::vector<RankingsUser> getRankingsUsersChunk(
-    std::shared_ptr<TokenManager> pTokenManager,
-    Page const& page,
-    Gamemode const& mode)
+std::vector<RankingsUser> parseRankingsUsersChunk(nlohmann::json& rankingsObj)
 {
-    OsuWrapper osu(pTokenManager, 0);
-    nlohmann::json rankingsObj;
-    LOG_ERROR_THROW(
-        osu.getRankings(page, mode, rankingsObj),
-        "Failed to get ranking IDs! page=", page, ", mode=", mode.toString()
-    );
-
     std::vector<RankingsUser> rankingsUsersChunk;
     nlohmann::json rankings = rankingsObj["ranking"];
     for (auto const& userStatistics : rankings)
@@ -59,82 +60,514 @@ std::vector<RankingsUser> getRankingsUsersChunk(
 }
 
 /**
- * Get the rank that a user was yesterday, for given mode.
+ * Get rankings user for given page and mode.
  */
-std::pair<UserID, Rank> getUserYesterdayRank(
+std::vector<RankingsUser> getRankingsUsersChunk(
     std::shared_ptr<TokenManager> pTokenManager,
-    UserID const& userID,
+    std::shared_ptr<CancellationToken> pCancelToken,
+    std::shared_ptr<ThreadPool> pCpuThreadPool,
+    Page const& page,
     Gamemode const& mode)
 {
-    OsuWrapper osu(pTokenManager, 0);
+    OsuWrapper osu(pTokenManager, 0, pCancelToken, pCpuThreadPool);
+    nlohmann::json rankingsObj;
+    LOG_ERROR_THROW(
+        osu.getRankings(page, mode, rankingsObj),
+        "Failed to get ranking IDs! page=", page, ", mode=", mode.toString()
+    );
+
+    return parseRankingsUsersChunk(rankingsObj);
+}
+
+/**
+ * Awaitable version of getRankingsUsersChunk.
+ */
+Task<std::vector<RankingsUser>> getRankingsUsersChunkAsync(
+    std::shared_ptr<TokenManager> pTokenManager,
+    std::shared_ptr<CancellationToken> pCancelToken,
+    std::shared_ptr<ThreadPool> pCpuThreadPool,
+    AsyncHttpClient& httpClient,
+    Page page,
+    Gamemode mode)
+{
+    OsuWrapper osu(pTokenManager, httpClient, 0, pCancelToken, pCpuThreadPool);
+    nlohmann::json rankingsObj;
+    LOG_ERROR_THROW(
+        co_await osu.getRankingsAsync(page, mode, rankingsObj),
+        "Failed to get ranking IDs! page=", page, ", mode=", mode.toString()
+    );
+
+    co_return parseRankingsUsersChunk(rankingsObj);
+}
+
+/**
+ * Get rankings users for given page, country and mode.
+ */
+Task<std::vector<RankingsUser>> getCountryRankingsUsersChunkAsync(
+    std::shared_ptr<TokenManager> pTokenManager,
+    std::shared_ptr<CancellationToken> pCancelToken,
+    std::shared_ptr<ThreadPool> pCpuThreadPool,
+    AsyncHttpClient& httpClient,
+    Page page,
+    CountryCode countryCode,
+    Gamemode mode)
+{
+    OsuWrapper osu(pTokenManager, httpClient, 0, pCancelToken, pCpuThreadPool);
+    nlohmann::json rankingsObj;
+    LOG_ERROR_THROW(
+        co_await osu.getCountryRankingsAsync(page, countryCode, mode, rankingsObj),
+        "Failed to get country rankings! page=", page, ", countryCode=", countryCode, ", mode=", mode.toString()
+    );
+
+    co_return parseRankingsUsersChunk(rankingsObj);
+}
+
+/**
+ * Get the given users' current profiles, keeping only those that are still in the top 10,000 of given mode.
+ */
+Task<std::vector<RankingsUser>> getStillRankedUsersChunkAsync(
+    std::shared_ptr<TokenManager> pTokenManager,
+    std::shared_ptr<CancellationToken> pCancelToken,
+    std::shared_ptr<ThreadPool> pCpuThreadPool,
+    AsyncHttpClient& httpClient,
+    std::vector<UserID> userIDs,
+    Gamemode mode)
+{
+    OsuWrapper osu(pTokenManager, httpClient, 0, pCancelToken, pCpuThreadPool);
+    nlohmann::json usersObj;
+    LOG_ERROR_THROW(
+        co_await osu.getUsersAsync(userIDs, mode, usersObj),
+        "Failed to get users! numUsers=", userIDs.size(), ", mode=", mode.toString()
+    );
+
+    std::vector<RankingsUser> rankedUsers;
+    for (auto const& userObj : usersObj.at("users"))
+    {
+        try
+        {
+            nlohmann::json const& statistics = userObj.at("statistics_rulesets").at(mode.toString());
+            if (statistics.at("global_rank").is_null() || (statistics.at("global_rank").get<Rank>() > static_cast<Rank>(k_numRankingsUsers)))
+            {
+                continue;
+            }
+
+            RankingsUser rankingsUser = {
+                .userID = userObj.at("id").get<UserID>(),
+                .username = userObj.at("username").get<Username>(),
+                .countryCode = userObj.at("country_code").get<CountryCode>(),
+                .pfpLink = userObj.at("avatar_url").get<ProfilePicture>(),
+                .performancePoints = statistics.at("pp").get<PerformancePoints>(),
+                .accuracy = statistics.at("hit_accuracy").get<Accuracy>(),
+                .hoursPlayed = static_cast<HoursPlayed>(statistics.at("play_time").get<uint64_t>() / 3600), // FIXME: round instead of trunc
+                .currentRank = statistics.at("global_rank").get<Rank>()
+            };
+            rankedUsers.push_back(rankingsUser);
+        }
+        catch (nlohmann::json::exception const& e)
+        {
+            LOG_ERROR("Object for user ", userObj.value("id", -1), " contains missing or unexpected fields - skipping");
+        }
+    }
+
+    co_return rankedUsers;
+}
+
+/**
+ * Get the rank that a user was yesterday, for given mode.
+ */
+Task<std::pair<UserID, Rank>> getUserYesterdayRankAsync(
+    std::shared_ptr<TokenManager> pTokenManager,
+    std::shared_ptr<CancellationToken> pCancelToken,
+    std::shared_ptr<ThreadPool> pCpuThreadPool,
+    AsyncHttpClient& httpClient,
+    UserID userID,
+    Gamemode mode)
+{
+    OsuWrapper osu(pTokenManager, httpClient, 0, pCancelToken, pCpuThreadPool);
     nlohmann::json userObj;
     LOG_ERROR_THROW(
-        osu.getUser(userID, mode, userObj),
+        co_await osu.getUserAsync(userID, mode, userObj),
         "Failed to get user! userID=", userID, ", mode=", mode.toString()
     );
 
-    auto userYesterdayRank = std::make_pair(userID, userObj.at("rank_history").at("data")[88].get<Rank>());
-    return userYesterdayRank;
+    co_return std::make_pair(userID, userObj.at("rank_history").at("data")[88].get<Rank>());
 }
 
 /**
- * Get data for current top 10000 players for given mode.
+ * Concatenate chunks of results into one vector.
  */
-void scrapeRankingsMode(
+template<typename T>
+std::vector<T> flattenChunks(std::vector<std::vector<T>> chunks, std::size_t const& expectedSize)
+{
+    std::vector<T> flattened;
+    flattened.reserve(expectedSize);
+    for (auto& chunk : chunks)
+    {
+        flattened.insert(flattened.end(), std::make_move_iterator(chunk.begin()), std::make_move_iterator(chunk.end()));
+    }
+
+    return flattened;
+}
+
+/**
+ * Await tasks k_asyncBatchSize at a time, so that there aren't thousands of transfers open at once, and return their results in order.
+ * Blocks the calling thread, but none of the waiting (including backing off from ratelimits) parks any other thread.
+ */
+template<typename T>
+std::vector<T> syncWaitInBatches(std::vector<Task<T>> tasks)
+{
+    std::vector<T> results;
+    results.reserve(tasks.size());
+    for (std::size_t batchBegin = 0; batchBegin < tasks.size(); batchBegin += k_asyncBatchSize)
+    {
+        std::size_t batchEnd = std::min(batchBegin + k_asyncBatchSize, tasks.size());
+        std::vector<Task<T>> batchTasks(std::make_move_iterator(tasks.begin() + static_cast<std::ptrdiff_t>(batchBegin)), std::make_move_iterator(tasks.begin() + static_cast<std::ptrdiff_t>(batchEnd)));
+        std::vector<T> batchResults = syncWait(whenAll(std::move(batchTasks)));
+        results.insert(results.end(), std::make_move_iterator(batchResults.begin()), std::make_move_iterator(batchResults.end()));
+    }
+
+    return results;
+}
+
+/**
+ * Get current top 10,000 players for given mode.
+ */
+std::vector<RankingsUser> fetchRankingsUsers(
     std::shared_ptr<TokenManager> pTokenManager,
+    std::shared_ptr<CancellationToken> pCancelToken,
+    std::shared_ptr<ThreadPool> pCpuThreadPool,
+    AsyncHttpClient& httpClient,
+    Gamemode const& mode)
+{
+    std::vector<Task<std::vector<RankingsUser>>> tasks;
+    tasks.reserve(k_getRankingIDMaxPage);
+    for (Page page = 0; page < k_getRankingIDMaxPage; ++page)
+    {
+        tasks.push_back(getRankingsUsersChunkAsync(pTokenManager, pCancelToken, pCpuThreadPool, httpClient, page, mode));
+    }
+
+    return flattenChunks(syncWaitInBatches(std::move(tasks)), k_numRankingsUsers);
+}
+
+/**
+ * Get current top 10,000 players for given mode out of the pages staged throughout the day.
+ * Only pages that weren't staged recently enough get fetched again.
+ *
+ * Pages are staged hours apart, so a player that moved from a page that was staged early onto one that was staged late can be on neither.
+ * Anyone that was ranked yesterday but isn't in the staged pages is looked up directly, and only left out (i.e. dropped) if they really are out of the top 10,000.
+ */
+std::vector<RankingsUser> fetchStagedRankingsUsers(
+    std::shared_ptr<TokenManager> pTokenManager,
+    std::shared_ptr<CancellationToken> pCancelToken,
+    std::shared_ptr<ThreadPool> pCpuThreadPool,
     std::shared_ptr<RankingsDatabase> pRankingsDb,
-    std::shared_ptr<ThreadPool> pThreadPool,
+    std::shared_ptr<CacheDatabase> pCacheDb,
+    AsyncHttpClient& httpClient,
     Gamemode const& mode)
 {
-    // Shift current rank to yesterday for any existing players
-    pRankingsDb->shiftRanks(mode);
+    std::vector<Page> stalePages = pCacheDb->getStaleStagingPages(std::chrono::hours(DosuConfig::scrapeRankingsStagingMaxAgeHours), mode);
+    LOG_INFO("Refreshing ", stalePages.size(), "/", k_getRankingIDMaxPage, " staged ", mode.toString(), " rankings pages");
 
-    // Get current top 10,000 players and update database with them
-    std::vector<RankingsUser> rankingsUsers;
-    rankingsUsers.reserve(k_getRankingIDMaxPage * k_batchMaxIDs);
+    std::vector<Task<std::vector<RankingsUser>>> tasks;
+    tasks.reserve(stalePages.size());
+    for (Page const& page : stalePages)
+    {
+        tasks.push_back(getRankingsUsersChunkAsync(pTokenManager, pCancelToken, pCpuThreadPool, httpClient, page, mode));
+    }
+    std::vector<std::vector<RankingsUser>> rankingsUsersChunks = syncWaitInBatches(std::move(tasks));
+
+    for (std::size_t i = 0; i < stalePages.size(); ++i)
+    {
+        pCacheDb->replaceStagingPage(stalePages[i], rankingsUsersChunks[i], mode);
+    }
 
-    std::vector<std::future<std::vector<RankingsUser>>> rankingsUsersFutures;
-    rankingsUsersFutures.reserve(k_getRankingIDMaxPage);
+    std::vector<RankingsUser> rankingsUsers = pCacheDb->getStagingRankingsUsers(mode);
 
-    for (Page i = 0; i < k_getRankingIDMaxPage; ++i)
+    std::unordered_set<UserID> stagedUserIDs;
+    stagedUserIDs.reserve(rankingsUsers.size());
+    for (auto const& rankingsUser : rankingsUsers)
     {
-        auto futureRankingsUsersChunk = pThreadPool->submit(getRankingsUsersChunk, pTokenManager, i, mode);
-        rankingsUsersFutures.push_back(std::move(futureRankingsUsersChunk));
+        stagedUserIDs.insert(rankingsUser.userID);
     }
 
-    for (auto& futureRankingsUsersChunk : rankingsUsersFutures)
+    std::vector<UserID> missingUserIDs;
+    for (auto const& [userID, _] : pRankingsDb->getCurrentRanks(mode))
     {
-        std::vector<RankingsUser> rankingsUsersChunk = futureRankingsUsersChunk.get();
-        rankingsUsers.insert(rankingsUsers.end(), std::make_move_iterator(rankingsUsersChunk.begin()), std::make_move_iterator(rankingsUsersChunk.end()));
+        if (!stagedUserIDs.contains(userID))
+        {
+            missingUserIDs.push_back(userID);
+        }
     }
 
-    pRankingsDb->insertRankingsUsers(rankingsUsers, mode);
+    std::vector<Task<std::vector<RankingsUser>>> missingTasks;
+    missingTasks.reserve((missingUserIDs.size() + k_batchMaxIDs - 1) / k_batchMaxIDs);
+    for (std::size_t i = 0; i < missingUserIDs.size(); i += k_batchMaxIDs)
+    {
+        std::vector<UserID> userIDs(
+            missingUserIDs.begin() + static_cast<std::ptrdiff_t>(i),
+            missingUserIDs.begin() + static_cast<std::ptrdiff_t>(std::min(i + k_batchMaxIDs, missingUserIDs.size()))
+        );
+        missingTasks.push_back(getStillRankedUsersChunkAsync(pTokenManager, pCancelToken, pCpuThreadPool, httpClient, std::move(userIDs), mode));
+    }
+    std::vector<RankingsUser> stillRankedUsers = flattenChunks(syncWaitInBatches(std::move(missingTasks)), missingUserIDs.size());
 
-    // Remove entries w/ null currentRank (=> they dropped out of top 10k)
-    pRankingsDb->deleteUsersWithNullCurrentRank(mode);
+    LOG_INFO(
+        missingUserIDs.size(), " ", mode.toString(), " users ranked yesterday aren't in the staged pages; ",
+        stillRankedUsers.size(), " of them are still ranked"
+    );
+    rankingsUsers.insert(rankingsUsers.end(), std::make_move_iterator(stillRankedUsers.begin()), std::make_move_iterator(stillRankedUsers.end()));
 
-    // Fill in yesterdayRank for entries where it's null (=> they entered top 10k)
-    std::vector<UserID> remainingUserIDs = pRankingsDb->getUserIDsWithNullYesterdayRank(mode);
+    return rankingsUsers;
+}
 
-    std::vector<std::pair<UserID, Rank>> remainingUserYesterdayRanks;
-    remainingUserYesterdayRanks.reserve(remainingUserIDs.size());
+/**
+ * Fill in yesterdayRank for users that weren't in yesterday's snapshot (=> they entered top 10k).
+ */
+void backfillYesterdayRanks(
+    std::shared_ptr<TokenManager> pTokenManager,
+    std::shared_ptr<CancellationToken> pCancelToken,
+    std::shared_ptr<ThreadPool> pCpuThreadPool,
+    std::shared_ptr<RankingsDatabase> pRankingsDb,
+    AsyncHttpClient& httpClient,
+    std::vector<UserID> const& userIDs,
+    Gamemode const& mode)
+{
+    std::vector<Task<std::pair<UserID, Rank>>> tasks;
+    tasks.reserve(userIDs.size());
+    for (UserID const& userID : userIDs)
+    {
+        tasks.push_back(getUserYesterdayRankAsync(pTokenManager, pCancelToken, pCpuThreadPool, httpClient, userID, mode));
+    }
 
-    std::vector<std::future<std::pair<UserID, Rank>>> remainingUserYesterdayRankFutures;
-    remainingUserYesterdayRankFutures.reserve(remainingUserIDs.size());
+    pRankingsDb->updateYesterdayRanks(syncWaitInBatches(std::move(tasks)), mode);
+}
 
-    for (const auto& remainingUserID : remainingUserIDs)
+/**
+ * Get players outside the global top 10k for given mode, out of the planned country rankings pages.
+ */
+std::vector<RankingsUser> fetchCountryRankingsUsers(
+    std::shared_ptr<TokenManager> pTokenManager,
+    std::shared_ptr<CancellationToken> pCancelToken,
+    std::shared_ptr<ThreadPool> pCpuThreadPool,
+    AsyncHttpClient& httpClient,
+    std::vector<std::pair<CountryCode, Page>> const& countryPages,
+    Gamemode const& mode)
+{
+    LOG_INFO("Fetching ", countryPages.size(), " ", mode.toString(), " country rankings pages");
+
+    std::vector<Task<std::vector<RankingsUser>>> tasks;
+    tasks.reserve(countryPages.size());
+    for (auto const& [countryCode, page] : countryPages)
+    {
+        tasks.push_back(getCountryRankingsUsersChunkAsync(pTokenManager, pCancelToken, pCpuThreadPool, httpClient, page, countryCode, mode));
+    }
+
+    return flattenChunks(syncWaitInBatches(std::move(tasks)), countryPages.size() * k_batchMaxIDs);
+}
+
+/**
+ * Write every mode's current ranks to a compact snapshot, so that a later run (or another instance) can use them as its yesterday ranks.
+ * Goes through a temporary file, so that a failed write never leaves a partial snapshot behind.
+ */
+void exportRankingsSnapshot(std::shared_ptr<RankingsDatabase> pRankingsDb, std::vector<Gamemode> const& modes, std::filesystem::path const& filePath)
+{
+    nlohmann::json snapshotObj;
+    snapshotObj["date"] = ISO8601DateTimeUTC().toString();
+    std::size_t numUsers = 0;
+    for (auto const& mode : modes)
+    {
+        nlohmann::json userRanksArr = nlohmann::json::array();
+        for (auto const& [userID, rank] : pRankingsDb->getCurrentRanks(mode))
+        {
+            userRanksArr.push_back({ userID, rank });
+        }
+        numUsers += userRanksArr.size();
+        snapshotObj["modes"][mode.toString()] = std::move(userRanksArr);
+    }
+
+    if (filePath.has_parent_path())
     {
-        auto futureRemainingUserYesterdayRank = pThreadPool->submit(getUserYesterdayRank, pTokenManager, remainingUserID, mode);
-        remainingUserYesterdayRankFutures.push_back(std::move(futureRemainingUserYesterdayRank));
+        std::filesystem::create_directories(filePath.parent_path());
     }
 
-    for (auto& futureRemainingUserYesterdayRank : remainingUserYesterdayRankFutures)
+    std::filesystem::path tmpFilePath = filePath;
+    tmpFilePath += ".tmp";
+    {
+        std::ofstream outputFile(tmpFilePath);
+        LOG_ERROR_THROW(
+            outputFile.is_open(),
+            "Failed to open ", tmpFilePath.string()
+        );
+        outputFile << snapshotObj.dump();
+    }
+    std::filesystem::rename(tmpFilePath, filePath);
+
+    LOG_INFO("Exported ranks of ", numUsers, " users to ", filePath.string());
+}
+
+/**
+ * Read yesterday's ranks for each mode out of an exported snapshot.
+ * Only a snapshot that is roughly a day old is usable; otherwise nothing is returned.
+ */
+std::unordered_map<Gamemode, std::unordered_map<UserID, Rank>> importRankingsSnapshot(std::filesystem::path const& filePath)
+{
+    std::unordered_map<Gamemode, std::unordered_map<UserID, Rank>> modeYesterdayRanks;
+    if (!std::filesystem::exists(filePath))
+    {
+        LOG_INFO("No rankings snapshot at ", filePath.string(), " to seed yesterday ranks from");
+        return modeYesterdayRanks;
+    }
+
+    nlohmann::json snapshotObj;
+    std::ifstream inputFile(filePath);
+    LOG_ERROR_THROW(
+        inputFile.is_open(),
+        "Failed to open ", filePath.string()
+    );
+    inputFile >> snapshotObj;
+
+    ISO8601DateTimeUTC snapshotDate(snapshotObj.at("date").get<std::string>());
+    std::chrono::hours ageHours = std::chrono::duration_cast<std::chrono::hours>(
+        std::chrono::seconds(static_cast<int64_t>(ISO8601DateTimeUTC().toEpochTime()) - static_cast<int64_t>(snapshotDate.toEpochTime())));
+    if ((ageHours < k_minValidScrapeRankingsHour) || (ageHours > k_maxValidScrapeRankingsHour))
+    {
+        LOG_WARN("Rankings snapshot at ", filePath.string(), " is ", ageHours.count(), " hours old; not using it for yesterday ranks");
+        return modeYesterdayRanks;
+    }
+
+    for (auto const& [modeString, userRanksArr] : snapshotObj.at("modes").items())
+    {
+        Gamemode mode;
+        if (!Gamemode::fromString(modeString, mode))
+        {
+            LOG_WARN("Rankings snapshot contains unknown mode ", modeString, " - skipping");
+            continue;
+        }
+
+        std::unordered_map<UserID, Rank>& yesterdayRanks = modeYesterdayRanks[mode];
+        yesterdayRanks.reserve(userRanksArr.size());
+        for (auto const& userRankArr : userRanksArr)
+        {
+            yesterdayRanks.emplace(userRankArr.at(0).get<UserID>(), userRankArr.at(1).get<Rank>());
+        }
+        LOG_INFO("Seeding ", mode.toString(), " yesterday ranks from a snapshot of ", yesterdayRanks.size(), " users");
+    }
+
+    return modeYesterdayRanks;
+}
+
+/**
+ * Fill in yesterdayRank from the imported snapshot for whichever users it has.
+ * Returns the IDs of the users that still need to be fetched.
+ */
+std::vector<UserID> seedYesterdayRanks(
+    std::shared_ptr<RankingsDatabase> pRankingsDb,
+    std::unordered_map<UserID, Rank> const& snapshotYesterdayRanks,
+    std::vector<UserID> const& userIDs,
+    Gamemode const& mode)
+{
+    if (snapshotYesterdayRanks.empty())
+    {
+        return userIDs;
+    }
+
+    std::vector<std::pair<UserID, Rank>> userYesterdayRanks;
+    std::vector<UserID> remainingUserIDs;
+    for (auto const& userID : userIDs)
+    {
+        auto it = snapshotYesterdayRanks.find(userID);
+        if (it != snapshotYesterdayRanks.end())
+        {
+            userYesterdayRanks.emplace_back(userID, it->second);
+        }
+        else
+        {
+            remainingUserIDs.push_back(userID);
+        }
+    }
+
+    pRankingsDb->updateYesterdayRanks(userYesterdayRanks, mode);
+    LOG_INFO("Seeded ", userYesterdayRanks.size(), " ", mode.toString(), " yesterday ranks from the snapshot; ", remainingUserIDs.size(), " left to fetch");
+
+    return remainingUserIDs;
+}
+
+/**
+ * Everything that a mode's stages pass along to each other.
+ */
+struct ScrapeRankingsModeState
+{
+    std::vector<RankingsUser> rankingsUsers;
+    std::vector<UserID> unknownYesterdayRankUserIDs;
+    std::unordered_map<UserID, Rank> snapshotYesterdayRanks;
+    std::size_t countryCallBudget = 0;
+};
+
+/**
+ * Add the stages that get data for current top 10000 players for given mode.
+ * Each mode only waits on its own stages.
+ */
+void addScrapeRankingsModeStages(
+    JobGraph& jobGraph /* out */,
+    ScrapeRankingsModeState& modeState /* out */,
+    std::unordered_map<std::string, int64_t> const& countryFilterUsage,
+    std::shared_ptr<TokenManager> pTokenManager,
+    std::shared_ptr<CancellationToken> pCancelToken,
+    std::shared_ptr<ThreadPool> pCpuThreadPool,
+    std::shared_ptr<RankingsDatabase> pRankingsDb,
+    std::shared_ptr<CacheDatabase> pCacheDb,
+    AsyncHttpClient& httpClient,
+    Gamemode const& mode)
+{
+    std::string const prefix = mode.toString() + ":";
+
+    // Staged pages are checked against yesterday's snapshot, so that has to be wiped (or not) first
+    jobGraph.addStage(prefix + "fetch", { "token", "wipe" },
+    [&modeState, &httpClient, pTokenManager, pCancelToken, pCpuThreadPool, pRankingsDb, pCacheDb, mode]()
+    {
+        modeState.rankingsUsers = (DosuConfig::scrapeRankingsPagesPerHour > 0)
+            ? fetchStagedRankingsUsers(pTokenManager, pCancelToken, pCpuThreadPool, pRankingsDb, pCacheDb, httpClient, mode)
+            : fetchRankingsUsers(pTokenManager, pCancelToken, pCpuThreadPool, httpClient, mode);
+    });
+
+    // Diff against yesterday's snapshot and write the result back in one go
+    jobGraph.addStage(prefix + "apply", { "wipe", prefix + "fetch" },
+    [&modeState, pRankingsDb, mode]()
     {
-        std::pair<UserID, Rank> remainingUserYesterdayRank = futureRemainingUserYesterdayRank.get();
-        remainingUserYesterdayRanks.push_back(std::move(remainingUserYesterdayRank));
+        modeState.unknownYesterdayRankUserIDs = pRankingsDb->applyRankingsSnapshot(modeState.rankingsUsers, mode);
+    });
+
+    // Other jobs (e.g. getTopPlays) can reuse these instead of fetching the same users again
+    jobGraph.addStage(prefix + "cache", { prefix + "fetch" },
+    [&modeState, pCacheDb, mode]()
+    {
+        pCacheDb->upsertUserProfiles(modeState.rankingsUsers, mode);
+    });
+
+    // After a wipe, everyone's yesterdayRank is unknown; the snapshot (if any) covers most of them without any API calls
+    jobGraph.addStage(prefix + "backfill", { prefix + "apply" },
+    [&modeState, &httpClient, pTokenManager, pCancelToken, pCpuThreadPool, pRankingsDb, mode]()
+    {
+        std::vector<UserID> userIDs = seedYesterdayRanks(pRankingsDb, modeState.snapshotYesterdayRanks, modeState.unknownYesterdayRankUserIDs, mode);
+        backfillYesterdayRanks(pTokenManager, pCancelToken, pCpuThreadPool, pRankingsDb, httpClient, userIDs, mode);
+    });
+
+    if (modeState.countryCallBudget == 0)
+    {
+        return;
     }
 
-    pRankingsDb->updateYesterdayRanks(remainingUserYesterdayRanks, mode);
+    // Needs the main table to be up to date, so that it knows where each country's players in the top 10k end
+    jobGraph.addStage(prefix + "country", { prefix + "apply" },
+    [&modeState, &countryFilterUsage, &httpClient, pTokenManager, pCancelToken, pCpuThreadPool, pRankingsDb, mode]()
+    {
+        std::vector<std::pair<CountryCode, Page>> countryPages = planCountryRankingsPages(
+            DosuConfig::countryRankingsCountries,
+            countryFilterUsage,
+            pRankingsDb->getNumRankedUsersByCountry(mode),
+            modeState.countryCallBudget);
+        pRankingsDb->applyCountryRankingsSnapshot(fetchCountryRankingsUsers(pTokenManager, pCancelToken, pCpuThreadPool, httpClient, countryPages, mode), mode);
+    });
 }
 } /* namespace */
 
@@ -143,31 +576,140 @@ void scrapeRankingsMode(
  * ratelimited (but the API wrapper should deal with that).
  *
  * Get data for current top 10000 players in each mode. If the last run was (roughly) a day ago, this
- * script will make a bit over ~800 osu!API calls. Otherwise, it will make 40,800 calls.
+ * script will make a bit over ~800 osu!API calls. Otherwise, it will make 40,800 calls, unless there is
+ * a rankings snapshot from roughly a day ago to take yesterday's ranks from.
+ * Scraping country rankings past the top 10k adds at most COUNTRY_RANKINGS_DAILY_CALL_BUDGET calls on top of that.
  */
 void scrapeRankings(
     std::shared_ptr<TokenManager> pTokenManager,
+    std::shared_ptr<CancellationToken> pCancelToken,
     std::shared_ptr<RankingsDatabase> pRankingsDb,
-    std::shared_ptr<ThreadPool> pThreadPool)
+    std::shared_ptr<CacheDatabase> pCacheDb,
+    std::shared_ptr<BotConfigDatabase> pBotConfigDb,
+    std::shared_ptr<ThreadPool> pThreadPool,
+    std::shared_ptr<ThreadPool> pCpuThreadPool)
 {
     LOG_INFO("Scraping osu! rankings");
 
+    JobGraph jobGraph("scrapeRankings");
+
+    // Shared by every mode's awaitable requests, so that they're capped at roughly as many connections as there are threads
+    AsyncHttpClient httpClient(pThreadPool, pThreadPool->getThreadCount());
+
+    const std::vector<Gamemode> modes = { Gamemode::Osu, Gamemode::Taiko, Gamemode::Mania, Gamemode::Catch };
+    std::vector<ScrapeRankingsModeState> modeStates(modes.size());
+
     // If last run was not roughly a day ago, wipe everything
-    auto lastWriteTime = pRankingsDb->lastWriteTime();
-    auto now = std::filesystem::file_time_type::clock::now();
-    std::chrono::hours ageHours = std::chrono::duration_cast<std::chrono::hours>(now - lastWriteTime);
-    if ((ageHours < k_minValidScrapeRankingsHour) || (ageHours > k_maxValidScrapeRankingsHour))
+    jobGraph.addStage("wipe", {},
+    [&modeStates, modes, pRankingsDb]()
     {
-        LOG_WARN("Database is out of sync with current time of running; starting from scratch");
-        pRankingsDb->wipeTables();
-    }
+        auto lastScrapeTime = pRankingsDb->lastScrapeTime();
+        auto now = std::chrono::system_clock::now();
+        std::chrono::hours ageHours = std::chrono::duration_cast<std::chrono::hours>(now - lastScrapeTime);
+        if ((ageHours < k_minValidScrapeRankingsHour) || (ageHours > k_maxValidScrapeRankingsHour))
+        {
+            LOG_WARN("Database is out of sync with current time of running; starting from scratch");
+            pRankingsDb->wipeTables();
+
+            if (DosuConfig::rankingsSnapshotFilePath.empty())
+            {
+                return;
+            }
+
+            try
+            {
+                auto modeYesterdayRanks = importRankingsSnapshot(DosuConfig::rankingsSnapshotFilePath);
+                for (std::size_t i = 0; i < modes.size(); ++i)
+                {
+                    auto it = modeYesterdayRanks.find(modes[i]);
+                    if (it != modeYesterdayRanks.end())
+                    {
+                        modeStates[i].snapshotYesterdayRanks = std::move(it->second);
+                    }
+                }
+            }
+            catch (std::exception const& e)
+            {
+                LOG_WARN("Failed to import rankings snapshot; ", e.what(), " - fetching every yesterday rank instead");
+            }
+        }
+    });
 
     // Update the token so that all the concurrent threads don't spin on it later
-    pTokenManager->updateAccessToken();
+    jobGraph.addStage("token", {},
+    [pTokenManager, pCancelToken]()
+    {
+        pTokenManager->updateAccessToken(pCancelToken);
+    });
 
     // Do work for each mode
-    scrapeRankingsMode(pTokenManager, pRankingsDb, pThreadPool, Gamemode::Osu);
-    scrapeRankingsMode(pTokenManager, pRankingsDb, pThreadPool, Gamemode::Taiko);
-    scrapeRankingsMode(pTokenManager, pRankingsDb, pThreadPool, Gamemode::Mania);
-    scrapeRankingsMode(pTokenManager, pRankingsDb, pThreadPool, Gamemode::Catch);
+    // The country rankings budget is split evenly between modes; countries are prioritised by how often they're filtered by
+    std::unordered_map<std::string, int64_t> countryFilterUsage;
+    std::size_t countryCallBudget = DosuConfig::countryRankingsCountries.empty() ? 0 : static_cast<std::size_t>(DosuConfig::countryRankingsDailyCallBudget);
+    if (countryCallBudget > 0)
+    {
+        countryFilterUsage = pBotConfigDb->getCountryFilterUsage();
+        for (std::size_t i = 0; i < modes.size(); ++i)
+        {
+            modeStates[i].countryCallBudget = (countryCallBudget / modes.size()) + ((i < countryCallBudget % modes.size()) ? 1 : 0);
+        }
+    }
+
+    for (std::size_t i = 0; i < modes.size(); ++i)
+    {
+        addScrapeRankingsModeStages(jobGraph, modeStates[i], countryFilterUsage, pTokenManager, pCancelToken, pCpuThreadPool, pRankingsDb, pCacheDb, httpClient, modes[i]);
+    }
+
+    // Today's ranks are tomorrow's yesterday ranks, in case tomorrow's run has to start from scratch
+    if (!DosuConfig::rankingsSnapshotFilePath.empty())
+    {
+        std::vector<std::string> applyStages;
+        for (auto const& mode : modes)
+        {
+            applyStages.push_back(mode.toString() + ":apply");
+        }
+
+        jobGraph.addStage("export", applyStages,
+        [modes, pRankingsDb]()
+        {
+            try
+            {
+                exportRankingsSnapshot(pRankingsDb, modes, DosuConfig::rankingsSnapshotFilePath);
+            }
+            catch (std::exception const& e)
+            {
+                LOG_ERROR("Failed to export rankings snapshot; ", e.what());
+            }
+        });
+    }
+
+    jobGraph.run(pThreadPool, pCancelToken, pCpuThreadPool);
+
+    // Only a scrape that made it all the way through counts towards the next run's freshness check
+    pRankingsDb->setLastScrapeTime(std::chrono::system_clock::now());
+}
+
+/**
+ * Stage whichever rankings page (across all modes) was fetched the longest time ago.
+ * Meant to be run at a low rate throughout the day, so that scrapeRankings has very little left to fetch.
+ */
+void stageRankingsPage(
+    std::shared_ptr<TokenManager> pTokenManager,
+    std::shared_ptr<CancellationToken> pCancelToken,
+    std::shared_ptr<CacheDatabase> pCacheDb,
+    std::shared_ptr<ThreadPool> pCpuThreadPool)
+{
+    Gamemode stalestMode = Gamemode::Osu;
+    std::pair<Page, int64_t> stalestPage = { 0, INT64_MAX };
+    for (auto const& mode : { Gamemode::Osu, Gamemode::Taiko, Gamemode::Mania, Gamemode::Catch })
+    {
+        std::pair<Page, int64_t> modeStalestPage = pCacheDb->getStalestStagingPage(mode);
+        if (modeStalestPage.second < stalestPage.second)
+        {
+            stalestMode = mode;
+            stalestPage = modeStalestPage;
+        }
+    }
+
+    pCacheDb->replaceStagingPage(stalestPage.first, getRankingsUsersChunk(pTokenManager, pCancelToken, pCpuThreadPool, stalestPage.first, stalestMode), stalestMode);
 }
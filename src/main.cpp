@@ -1,6 +1,7 @@
 #include "Bot.h"
 #include "DosuConfig.h"
 #include "DailyJob.h"
+#include "IntervalJob.h"
 #include "ScrapeRankings.h"
 #include "GetTopPlays.h"
 #include "Util.h"
@@ -8,12 +9,16 @@
 #include "RankingsDatabase.h"
 #include "TopPlaysDatabase.h"
 #include "BotConfigDatabase.h"
+#include "CacheDatabase.h"
 #include "TokenManager.h"
 #include "ThreadPool.h"
+#include "OsuWrapper.h"
+#include "ConcurrencyTuner.h"
 
 #include <curl/curl.h>
 
 #include <functional>
+#include <algorithm>
 #include <thread>
 #include <chrono>
 #include <atomic>
@@ -96,29 +101,51 @@ int main() noexcept
         std::shared_ptr<RankingsDatabase> pRankingsDatabase = std::make_shared<RankingsDatabase>(DosuConfig::rankingsDatabaseFilePath);
         std::shared_ptr<TopPlaysDatabase> pTopPlaysDatabase = std::make_shared<TopPlaysDatabase>(DosuConfig::topPlaysDatabaseFilePath);
         std::shared_ptr<BotConfigDatabase> pBotConfigDatabase = std::make_shared<BotConfigDatabase>(DosuConfig::botConfigDatabaseFilePath);
+        std::shared_ptr<CacheDatabase> pCacheDatabase = std::make_shared<CacheDatabase>(DosuConfig::cacheDatabaseFilePath);
+
+        // Initialize thread pools; the bot's interactions share the job pool, but in its interactive lane
+        std::shared_ptr<ThreadPool> pThreadPool = std::make_shared<ThreadPool>(DosuConfig::ioThreadCount, static_cast<std::size_t>(DosuConfig::threadPoolQueueCapacity));
+        std::shared_ptr<ThreadPool> pCpuThreadPool = std::make_shared<ThreadPool>(DosuConfig::cpuThreadCount);
 
         // Initialize and start bot
-        std::shared_ptr<Bot> pBot = std::make_shared<Bot>(DosuConfig::discordBotToken, pRankingsDatabase, pTopPlaysDatabase, pBotConfigDatabase);
+        std::shared_ptr<Bot> pBot = std::make_shared<Bot>(DosuConfig::discordBotToken, pRankingsDatabase, pTopPlaysDatabase, pBotConfigDatabase, pThreadPool);
         pBot->start();
 
         // Initialize jobs
-        std::shared_ptr<ThreadPool> pThreadPool = std::make_shared<ThreadPool>(DosuConfig::threadCount);
+        if (DosuConfig::ioThreadCountAutoTune)
+        {
+            OsuWrapper::setConcurrencyTuner(std::make_shared<ConcurrencyTuner>(1, static_cast<std::size_t>(DosuConfig::ioThreadCount)));
+        }
         std::unique_ptr<DailyJob> pScrapeRankingsJob = std::make_unique<DailyJob>(
             DosuConfig::scrapeRankingsRunHour,
             "scrapeRankings",
-            [&pTokenManager, &pRankingsDatabase, &pThreadPool]() { scrapeRankings(pTokenManager, pRankingsDatabase, pThreadPool); },
+            [&pTokenManager, &pRankingsDatabase, &pCacheDatabase, &pBotConfigDatabase, &pThreadPool, &pCpuThreadPool](std::shared_ptr<CancellationToken> pCancelToken) { scrapeRankings(pTokenManager, pCancelToken, pRankingsDatabase, pCacheDatabase, pBotConfigDatabase, pThreadPool, pCpuThreadPool); },
             [&pBot]() { pBot->scrapeRankingsCallback(); }
         );
         std::unique_ptr<DailyJob> pTopPlaysJob = std::make_unique<DailyJob>(
             DosuConfig::topPlaysRunHour,
             "getTopPlays",
-            [&pTokenManager, &pTopPlaysDatabase, &pThreadPool]() { getTopPlays(pTokenManager, pTopPlaysDatabase, pThreadPool); },
+            [&pTokenManager, &pTopPlaysDatabase, &pCacheDatabase, &pThreadPool, &pCpuThreadPool](std::shared_ptr<CancellationToken> pCancelToken) { getTopPlays(pTokenManager, pCancelToken, pTopPlaysDatabase, pCacheDatabase, pThreadPool, pCpuThreadPool); },
             [&pBot]() { pBot->topPlaysCallback(); }
         );
 
+        std::unique_ptr<IntervalJob> pStageRankingsJob;
+        if (DosuConfig::scrapeRankingsPagesPerHour > 0)
+        {
+            pStageRankingsJob = std::make_unique<IntervalJob>(
+                std::chrono::seconds(std::max(3600 / DosuConfig::scrapeRankingsPagesPerHour, 1)),
+                "stageRankingsPage",
+                [&pTokenManager, &pCacheDatabase, &pCpuThreadPool](std::shared_ptr<CancellationToken> pCancelToken) { stageRankingsPage(pTokenManager, pCancelToken, pCacheDatabase, pCpuThreadPool); }
+            );
+        }
+
         // Start jobs
         pScrapeRankingsJob->start();
         pTopPlaysJob->start();
+        if (pStageRankingsJob)
+        {
+            pStageRankingsJob->start();
+        }
 
         // Wait for shutdown signal
         {
@@ -130,6 +157,12 @@ int main() noexcept
         LOG_INFO("Cleaning up resources and connections - PLEASE DON'T SHUT DOWN");
         pScrapeRankingsJob->stop();
         pTopPlaysJob->stop();
+        if (pStageRankingsJob)
+        {
+            pStageRankingsJob->stop();
+        }
+        pThreadPool->shutdown(); // Leftover tasks from cancelled jobs bail out right away, but they still need curl
+        pCpuThreadPool->shutdown();
         pBot->stop();
         curl_global_cleanup();
 
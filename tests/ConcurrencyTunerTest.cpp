@@ -0,0 +1,181 @@
+#include "TestUtil.h"
+#include "ConcurrencyTuner.h"
+
+#include <chrono>
+#include <cstddef>
+#include <optional>
+
+namespace
+{
+using namespace std::chrono_literals;
+
+/**
+ * Record numResponses responses (the first numThrottled of them 429s), evenly spread out after start, with the last one at start + duration.
+ * Returns the time of the last one.
+ */
+std::chrono::steady_clock::time_point recordResponses(
+    ConcurrencyTuner& tuner,
+    std::chrono::steady_clock::time_point const& start,
+    std::size_t const& numResponses,
+    std::size_t const& numThrottled,
+    std::chrono::steady_clock::duration const& duration)
+{
+    auto step = duration / static_cast<int64_t>(numResponses);
+    auto now = start;
+    for (std::size_t i = 0; i < numResponses; ++i)
+    {
+        now = (i + 1 == numResponses) ? (start + duration) : (now + step);
+        tuner.recordResponse((i < numThrottled) ? 429 : 200, now);
+    }
+    return now;
+}
+
+void testStartsAtMaxLimit()
+{
+    ConcurrencyTuner tuner(2, 16);
+    EXPECT_EQ(tuner.getLimit(), 16u);
+}
+
+void testThrottlingCutsLimitByAQuarter()
+{
+    ConcurrencyTuner tuner(2, 16);
+    auto now = std::chrono::steady_clock::now();
+
+    now = recordResponses(tuner, now, 40, 10, 10s);
+    EXPECT_EQ(tuner.getLimit(), 12u);
+
+    now = recordResponses(tuner, now, 40, 10, 10s);
+    EXPECT_EQ(tuner.getLimit(), 9u);
+}
+
+void testLimitNeverLeavesBounds()
+{
+    ConcurrencyTuner tuner(4, 6);
+    auto now = std::chrono::steady_clock::now();
+
+    // Step down, turn around once goodput drops, then keep going up while it helps, but no further than maxLimit
+    now = recordResponses(tuner, now, 100, 0, 10s);
+    EXPECT_EQ(tuner.getLimit(), 5u);
+    now = recordResponses(tuner, now, 50, 0, 10s);
+    EXPECT_EQ(tuner.getLimit(), 6u);
+    now = recordResponses(tuner, now, 100, 0, 10s);
+    EXPECT_EQ(tuner.getLimit(), 6u);
+
+    // Cut back, but no further than minLimit
+    for (int i = 0; i < 3; ++i)
+    {
+        now = recordResponses(tuner, now, 40, 40, 10s);
+    }
+    EXPECT_EQ(tuner.getLimit(), 4u);
+}
+
+void testFlatGoodputStepsDown()
+{
+    ConcurrencyTuner tuner(2, 16);
+    auto now = std::chrono::steady_clock::now();
+
+    now = recordResponses(tuner, now, 100, 0, 10s);
+    EXPECT_EQ(tuner.getLimit(), 15u);
+
+    now = recordResponses(tuner, now, 100, 0, 10s);
+    EXPECT_EQ(tuner.getLimit(), 14u);
+}
+
+void testFallingGoodputTurnsAround()
+{
+    ConcurrencyTuner tuner(2, 16);
+    auto now = std::chrono::steady_clock::now();
+
+    now = recordResponses(tuner, now, 100, 0, 10s);
+    EXPECT_EQ(tuner.getLimit(), 15u);
+
+    // Better than the last window, so keep going down
+    now = recordResponses(tuner, now, 200, 0, 10s);
+    EXPECT_EQ(tuner.getLimit(), 14u);
+
+    // Worse, so go back up, and keep going up while that helps
+    now = recordResponses(tuner, now, 100, 0, 10s);
+    EXPECT_EQ(tuner.getLimit(), 15u);
+
+    now = recordResponses(tuner, now, 150, 0, 10s);
+    EXPECT_EQ(tuner.getLimit(), 16u);
+}
+
+void testQuietWindowIsStretched()
+{
+    ConcurrencyTuner tuner(2, 16);
+    auto now = std::chrono::steady_clock::now();
+
+    // Too few responses to judge yet
+    now = recordResponses(tuner, now, 10, 0, 10s);
+    EXPECT_EQ(tuner.getLimit(), 16u);
+
+    // Enough now, and the window still counts the first ten
+    now = recordResponses(tuner, now, 10, 0, 5s);
+    EXPECT_EQ(tuner.getLimit(), 15u);
+}
+
+void testQuietWindowIsRestartedEventually()
+{
+    ConcurrencyTuner tuner(2, 16);
+    auto now = std::chrono::steady_clock::now();
+
+    // A trickle of responses, never more than a few seconds apart, until the window is too old to be judged
+    now = recordResponses(tuner, now, 5, 0, 35s);
+    EXPECT_EQ(tuner.getLimit(), 16u);
+
+    // Had the window not started over, this would be enough responses to judge it
+    now = recordResponses(tuner, now, 19, 0, 9s);
+    EXPECT_EQ(tuner.getLimit(), 16u);
+
+    now = recordResponses(tuner, now, 1, 0, 1s);
+    EXPECT_EQ(tuner.getLimit(), 15u);
+}
+
+void testIdleGapRestartsWindow()
+{
+    ConcurrencyTuner tuner(2, 16);
+    auto now = std::chrono::steady_clock::now();
+
+    now = recordResponses(tuner, now, 15, 0, 9s);
+
+    // Nothing for a while (e.g. between jobs); what came before says nothing about the API now
+    now = recordResponses(tuner, now + 20s, 1, 0, 0s);
+    now = recordResponses(tuner, now, 18, 0, 9s);
+    EXPECT_EQ(tuner.getLimit(), 16u);
+
+    now = recordResponses(tuner, now, 1, 0, 1s);
+    EXPECT_EQ(tuner.getLimit(), 15u);
+}
+
+void testTryAcquireRespectsLimit()
+{
+    ConcurrencyTuner tuner(1, 2);
+
+    std::optional<ConcurrencyTuner::Permit> oFirstPermit = tuner.tryAcquire();
+    std::optional<ConcurrencyTuner::Permit> oSecondPermit = tuner.tryAcquire();
+    EXPECT(oFirstPermit.has_value());
+    EXPECT(oSecondPermit.has_value());
+    EXPECT(!tuner.tryAcquire().has_value());
+
+    oFirstPermit.reset();
+    EXPECT(tuner.tryAcquire().has_value());
+}
+} /* namespace */
+
+int main()
+{
+    quietLogs();
+
+    RUN_TEST(testStartsAtMaxLimit);
+    RUN_TEST(testThrottlingCutsLimitByAQuarter);
+    RUN_TEST(testLimitNeverLeavesBounds);
+    RUN_TEST(testFlatGoodputStepsDown);
+    RUN_TEST(testFallingGoodputTurnsAround);
+    RUN_TEST(testQuietWindowIsStretched);
+    RUN_TEST(testQuietWindowIsRestartedEventually);
+    RUN_TEST(testIdleGapRestartsWindow);
+    RUN_TEST(testTryAcquireRespectsLimit);
+
+    return testResult();
+}
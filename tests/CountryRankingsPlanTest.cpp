@@ -0,0 +1,70 @@
+#include "TestUtil.h"
+#include "CountryRankingsPlan.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace
+{
+using CountryPages = std::vector<std::pair<CountryCode, Page>>;
+
+void testBudgetIsSplitByUsage()
+{
+    CountryPages countryPages = planCountryRankingsPages({ "CA", "US" }, { { "US", 3 } }, {}, 5);
+
+    EXPECT(countryPages == CountryPages({ { "US", 0 }, { "US", 1 }, { "US", 2 }, { "US", 3 }, { "CA", 0 } }));
+}
+
+void testNegativeUsageCountsAsNone()
+{
+    CountryPages countryPages = planCountryRankingsPages({ "CA", "JP" }, { { "JP", -5 } }, {}, 4);
+
+    EXPECT(countryPages == CountryPages({ { "CA", 0 }, { "CA", 1 }, { "JP", 0 }, { "JP", 1 } }));
+}
+
+void testCountriesStartAfterTheirTop10kPlayers()
+{
+    CountryPages countryPages = planCountryRankingsPages({ "CA" }, {}, { { "CA", 120 } }, 2);
+
+    EXPECT(countryPages == CountryPages({ { "CA", 2 }, { "CA", 3 } }));
+}
+
+void testLastPageIsRespected()
+{
+    // CA only has one page left, so the rest of the budget goes to US
+    CountryPages countryPages = planCountryRankingsPages({ "CA", "US" }, { { "CA", 10 } }, { { "CA", (k_getRankingIDMaxPage - 1) * k_batchMaxIDs } }, 3);
+
+    EXPECT(countryPages == CountryPages({ { "CA", k_getRankingIDMaxPage - 1 }, { "US", 0 }, { "US", 1 } }));
+}
+
+void testBudgetBeyondEveryPageStops()
+{
+    CountryPages countryPages = planCountryRankingsPages({ "CA" }, {}, { { "CA", (k_getRankingIDMaxPage - 2) * k_batchMaxIDs } }, 100);
+
+    EXPECT_EQ(countryPages.size(), 2u);
+}
+
+void testNoBudgetPlansNothing()
+{
+    EXPECT(planCountryRankingsPages({ "CA", "US" }, {}, {}, 0).empty());
+    EXPECT(planCountryRankingsPages({}, {}, {}, 10).empty());
+}
+} /* namespace */
+
+int main()
+{
+    quietLogs();
+
+    RUN_TEST(testBudgetIsSplitByUsage);
+    RUN_TEST(testNegativeUsageCountsAsNone);
+    RUN_TEST(testCountriesStartAfterTheirTop10kPlayers);
+    RUN_TEST(testLastPageIsRespected);
+    RUN_TEST(testBudgetBeyondEveryPageStops);
+    RUN_TEST(testNoBudgetPlansNothing);
+
+    return testResult();
+}
@@ -0,0 +1,141 @@
+#include "TestUtil.h"
+#include "JobGraph.h"
+
+#include <atomic>
+#include <cstddef>
+#include <latch>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+/**
+ * Thread-safe record of the order stages ran in.
+ */
+class RunOrder
+{
+public:
+    void push(std::string const& name)
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_names.push_back(name);
+    }
+
+    [[nodiscard]] std::vector<std::string> get()
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        return m_names;
+    }
+
+private:
+    std::mutex m_mtx;
+    std::vector<std::string> m_names;
+};
+
+void testStagesRunAfterTheirDependencies()
+{
+    auto pThreadPool = std::make_shared<ThreadPool>(2);
+    RunOrder runOrder;
+    JobGraph jobGraph("test");
+
+    // Added before the stages it depends on
+    jobGraph.addStage("last", { "left", "right" }, [&runOrder]() { runOrder.push("last"); });
+    jobGraph.addStage("first", {}, [&runOrder]() { runOrder.push("first"); });
+    jobGraph.addStage("left", { "first" }, [&runOrder]() { runOrder.push("left"); });
+    jobGraph.addStage("right", { "first" }, [&runOrder]() { runOrder.push("right"); });
+    jobGraph.run(pThreadPool);
+
+    std::vector<std::string> order = runOrder.get();
+    EXPECT_EQ(order.size(), 4u);
+    EXPECT(!order.empty() && (order.front() == "first") && (order.back() == "last"));
+    EXPECT_EQ(jobGraph.getStageTimings().size(), 4u);
+}
+
+void testFailedStageStopsItsDependents()
+{
+    auto pThreadPool = std::make_shared<ThreadPool>(2);
+    std::atomic<bool> bDependentRan = false;
+    JobGraph jobGraph("test");
+    jobGraph.addStage("fail", {}, []() { throw std::runtime_error("failed"); });
+    jobGraph.addStage("dependent", { "fail" }, [&bDependentRan]() { bDependentRan = true; });
+
+    bool bThrew = false;
+    try
+    {
+        jobGraph.run(pThreadPool);
+    }
+    catch (std::runtime_error const&)
+    {
+        bThrew = true;
+    }
+
+    EXPECT(bThrew);
+    EXPECT(!bDependentRan);
+}
+
+void testCycleIsRejected()
+{
+    auto pThreadPool = std::make_shared<ThreadPool>(1);
+    std::atomic<bool> bStageRan = false;
+    JobGraph jobGraph("test");
+    jobGraph.addStage("a", { "b" }, [&bStageRan]() { bStageRan = true; });
+    jobGraph.addStage("b", { "a" }, [&bStageRan]() { bStageRan = true; });
+
+    bool bThrew = false;
+    try
+    {
+        jobGraph.run(pThreadPool);
+    }
+    catch (std::exception const&)
+    {
+        bThrew = true;
+    }
+
+    EXPECT(bThrew);
+    EXPECT(!bStageRan);
+}
+
+void testOverlappingGraphsShareASmallPool()
+{
+    // Every stage waits on the pool, and all of them are running at once before any of them does, so if stages took up
+    // workers themselves, none would be left to run what they wait on
+    auto pThreadPool = std::make_shared<ThreadPool>(2);
+    std::latch allStagesStarted(4);
+    std::atomic<std::size_t> numCalls = 0;
+    auto waitingStage = [&pThreadPool, &allStagesStarted, &numCalls]()
+    {
+        allStagesStarted.arrive_and_wait();
+        pThreadPool->parallelFor(0, 100, [&numCalls](std::size_t const&) { ++numCalls; });
+    };
+
+    auto runGraph = [&pThreadPool, &waitingStage](std::string const& name)
+    {
+        JobGraph jobGraph(name);
+        jobGraph.addStage("left", {}, waitingStage);
+        jobGraph.addStage("right", {}, waitingStage);
+        jobGraph.run(pThreadPool);
+    };
+
+    std::thread otherJob(runGraph, "other");
+    runGraph("this");
+    otherJob.join();
+
+    EXPECT_EQ(numCalls.load(), 400u);
+}
+} /* namespace */
+
+int main()
+{
+    quietLogs();
+
+    RUN_TEST(testStagesRunAfterTheirDependencies);
+    RUN_TEST(testFailedStageStopsItsDependents);
+    RUN_TEST(testCycleIsRejected);
+    RUN_TEST(testOverlappingGraphsShareASmallPool);
+
+    return testResult();
+}
@@ -0,0 +1,227 @@
+#include "TestUtil.h"
+#include "RankingsDatabase.h"
+
+#include <SQLiteCpp/SQLiteCpp.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+/**
+ * Fresh database file for a single test, deleted again once it's done.
+ */
+class TempDbFile
+{
+public:
+    TempDbFile()
+        : m_path(std::filesystem::temp_directory_path() / "dosu-rankings-test.db")
+    {
+        std::filesystem::remove(m_path);
+    }
+
+    ~TempDbFile()
+    {
+        std::filesystem::remove(m_path);
+    }
+
+    [[nodiscard]] std::filesystem::path const& path() const noexcept { return m_path; }
+
+private:
+    std::filesystem::path m_path;
+};
+
+RankingsUser makeUser(UserID const& userID, Rank const& currentRank, std::string const& username = "")
+{
+    RankingsUser user;
+    user.userID = userID;
+    user.username = username.empty() ? ("user" + std::to_string(userID)) : username;
+    user.countryCode = "CA";
+    user.pfpLink = "https://a.ppy.sh/" + std::to_string(userID);
+    user.performancePoints = 10000. - static_cast<double>(currentRank);
+    user.accuracy = 98.5;
+    user.hoursPlayed = 1000;
+    user.currentRank = currentRank;
+    return user;
+}
+
+/**
+ * Read a user's yesterdayRank straight out of the table, since nothing in RankingsDatabase returns it on its own.
+ */
+std::optional<Rank> getYesterdayRank(std::filesystem::path const& dbFilePath, UserID const& userID)
+{
+    SQLite::Database db(dbFilePath.string(), SQLite::OPEN_READONLY);
+    SQLite::Statement query(db, "SELECT yesterdayRank FROM " + k_modeToRankingsTable.at(Gamemode::Osu) + " WHERE userID = ?");
+    query.bind(1, userID);
+    if (!query.executeStep() || query.getColumn(0).isNull())
+    {
+        return std::nullopt;
+    }
+    return query.getColumn(0).getInt64();
+}
+
+/**
+ * Have every later update to the table note down the userID it touched, in a table of its own.
+ * A trigger (rather than a count of changes) also sees writes made through RankingsDatabase's own connection.
+ */
+void recordUpdates(std::filesystem::path const& dbFilePath)
+{
+    SQLite::Database db(dbFilePath.string(), SQLite::OPEN_READWRITE);
+    const std::string table = k_modeToRankingsTable.at(Gamemode::Osu);
+    db.exec("CREATE TABLE UpdatedUsers (userID INTEGER NOT NULL)");
+    db.exec("CREATE TRIGGER RecordUpdates AFTER UPDATE ON " + table + " BEGIN INSERT INTO UpdatedUsers VALUES (NEW.userID); END");
+}
+
+std::vector<UserID> getUpdatedUsers(std::filesystem::path const& dbFilePath)
+{
+    SQLite::Database db(dbFilePath.string(), SQLite::OPEN_READONLY);
+    SQLite::Statement query(db, "SELECT userID FROM UpdatedUsers ORDER BY userID ASC");
+    std::vector<UserID> userIDs;
+    while (query.executeStep())
+    {
+        userIDs.push_back(query.getColumn(0).getInt64());
+    }
+    return userIDs;
+}
+
+std::vector<UserID> sorted(std::vector<UserID> userIDs)
+{
+    std::sort(userIDs.begin(), userIDs.end());
+    return userIDs;
+}
+
+void testFirstSnapshotInsertsEveryone()
+{
+    TempDbFile dbFile;
+    RankingsDatabase rankingsDb(dbFile.path());
+
+    std::vector<UserID> unknownUserIDs = rankingsDb.applyRankingsSnapshot({ makeUser(1, 1), makeUser(2, 2), makeUser(3, 3) }, Gamemode::Osu);
+
+    EXPECT(sorted(unknownUserIDs) == std::vector<UserID>({ 1, 2, 3 }));
+    EXPECT(rankingsDb.getCurrentRanks(Gamemode::Osu) == std::vector<std::pair<UserID, Rank>>({ { 1, 1 }, { 2, 2 }, { 3, 3 } }));
+    EXPECT(!getYesterdayRank(dbFile.path(), 1).has_value());
+}
+
+void testSnapshotShiftsRanksAndDropsMissingUsers()
+{
+    TempDbFile dbFile;
+    RankingsDatabase rankingsDb(dbFile.path());
+    (void)rankingsDb.applyRankingsSnapshot({ makeUser(1, 1), makeUser(2, 2), makeUser(3, 3) }, Gamemode::Osu);
+
+    // 1 and 2 swap places, 3 drops out and 4 takes its spot
+    std::vector<UserID> unknownUserIDs = rankingsDb.applyRankingsSnapshot({ makeUser(2, 1), makeUser(1, 2), makeUser(4, 3) }, Gamemode::Osu);
+
+    EXPECT(unknownUserIDs == std::vector<UserID>({ 4 }));
+    EXPECT(rankingsDb.getCurrentRanks(Gamemode::Osu) == std::vector<std::pair<UserID, Rank>>({ { 2, 1 }, { 1, 2 }, { 4, 3 } }));
+    EXPECT(getYesterdayRank(dbFile.path(), 1) == std::optional<Rank>(1));
+    EXPECT(getYesterdayRank(dbFile.path(), 2) == std::optional<Rank>(2));
+    EXPECT(!getYesterdayRank(dbFile.path(), 4).has_value());
+}
+
+void testReturningUserNeedsYesterdayRank()
+{
+    TempDbFile dbFile;
+    RankingsDatabase rankingsDb(dbFile.path());
+    (void)rankingsDb.applyRankingsSnapshot({ makeUser(1, 1), makeUser(2, 2) }, Gamemode::Osu);
+    (void)rankingsDb.applyRankingsSnapshot({ makeUser(1, 1) }, Gamemode::Osu);
+
+    // Where they were yesterday (outside the rankings) is only known to the API
+    std::vector<UserID> unknownUserIDs = rankingsDb.applyRankingsSnapshot({ makeUser(1, 1), makeUser(2, 2) }, Gamemode::Osu);
+
+    EXPECT(unknownUserIDs == std::vector<UserID>({ 2 }));
+    EXPECT(!getYesterdayRank(dbFile.path(), 2).has_value());
+}
+
+void testUsernameChangesLastOneDay()
+{
+    TempDbFile dbFile;
+    RankingsDatabase rankingsDb(dbFile.path());
+    (void)rankingsDb.applyRankingsSnapshot({ makeUser(1, 1, "old"), makeUser(2, 2) }, Gamemode::Osu);
+
+    (void)rankingsDb.applyRankingsSnapshot({ makeUser(1, 1, "new"), makeUser(2, 2) }, Gamemode::Osu);
+    std::vector<UsernameChange> usernameChanges = rankingsDb.getUsernameChanges(k_global, 1, 100, 10, Gamemode::Osu);
+    EXPECT_EQ(usernameChanges.size(), 1u);
+    if (!usernameChanges.empty())
+    {
+        EXPECT_EQ(usernameChanges.front().userID, 1);
+        EXPECT_EQ(usernameChanges.front().oldUsername, "old");
+        EXPECT_EQ(usernameChanges.front().newUsername, "new");
+        EXPECT_EQ(usernameChanges.front().currentRank, 1);
+    }
+    EXPECT(getYesterdayRank(dbFile.path(), 1) == std::optional<Rank>(1));
+
+    (void)rankingsDb.applyRankingsSnapshot({ makeUser(1, 1, "new"), makeUser(2, 2) }, Gamemode::Osu);
+    EXPECT(rankingsDb.getUsernameChanges(k_global, 1, 100, 10, Gamemode::Osu).empty());
+}
+
+void testDuplicateUserKeepsBetterRank()
+{
+    TempDbFile dbFile;
+    RankingsDatabase rankingsDb(dbFile.path());
+
+    // User 2 moved up while the pages were being fetched, so they show up on both
+    std::vector<UserID> unknownUserIDs = rankingsDb.applyRankingsSnapshot({ makeUser(1, 1), makeUser(2, 2), makeUser(3, 3), makeUser(2, 4) }, Gamemode::Osu);
+
+    EXPECT(sorted(unknownUserIDs) == std::vector<UserID>({ 1, 2, 3 }));
+    EXPECT(rankingsDb.getCurrentRanks(Gamemode::Osu) == std::vector<std::pair<UserID, Rank>>({ { 1, 1 }, { 2, 2 }, { 3, 3 } }));
+
+    unknownUserIDs = rankingsDb.applyRankingsSnapshot({ makeUser(2, 3), makeUser(1, 1), makeUser(2, 2), makeUser(3, 4) }, Gamemode::Osu);
+
+    EXPECT(unknownUserIDs.empty());
+    EXPECT(rankingsDb.getCurrentRanks(Gamemode::Osu) == std::vector<std::pair<UserID, Rank>>({ { 1, 1 }, { 2, 2 }, { 3, 4 } }));
+    EXPECT(getYesterdayRank(dbFile.path(), 2) == std::optional<Rank>(2));
+}
+
+void testUnchangedUsersAreNotWritten()
+{
+    TempDbFile dbFile;
+    RankingsDatabase rankingsDb(dbFile.path());
+    (void)rankingsDb.applyRankingsSnapshot({ makeUser(1, 1), makeUser(2, 2), makeUser(3, 3), makeUser(4, 4) }, Gamemode::Osu);
+
+    // Only the rank shift changes the rows, since yesterdayRank was still unknown
+    (void)rankingsDb.applyRankingsSnapshot({ makeUser(1, 1), makeUser(2, 2), makeUser(3, 3), makeUser(4, 4) }, Gamemode::Osu);
+    recordUpdates(dbFile.path());
+
+    // 2 gets more pp without moving, 3 and 4 swap places, and 1 stays exactly the same
+    RankingsUser improvedUser = makeUser(2, 2);
+    improvedUser.performancePoints += 1.;
+    std::vector<UserID> unknownUserIDs = rankingsDb.applyRankingsSnapshot({ makeUser(1, 1), improvedUser, makeUser(4, 3), makeUser(3, 4) }, Gamemode::Osu);
+
+    EXPECT(unknownUserIDs.empty());
+    EXPECT(getUpdatedUsers(dbFile.path()) == std::vector<UserID>({ 2, 3, 4 }));
+    EXPECT(getYesterdayRank(dbFile.path(), 1) == std::optional<Rank>(1));
+    EXPECT(rankingsDb.getCurrentRanks(Gamemode::Osu) == std::vector<std::pair<UserID, Rank>>({ { 1, 1 }, { 2, 2 }, { 4, 3 }, { 3, 4 } }));
+}
+
+void testInvalidUsersAreSkipped()
+{
+    TempDbFile dbFile;
+    RankingsDatabase rankingsDb(dbFile.path());
+    RankingsUser invalidUser = makeUser(2, 2);
+    invalidUser.username = "";
+
+    std::vector<UserID> unknownUserIDs = rankingsDb.applyRankingsSnapshot({ makeUser(1, 1), invalidUser }, Gamemode::Osu);
+
+    EXPECT(unknownUserIDs == std::vector<UserID>({ 1 }));
+    EXPECT(rankingsDb.getCurrentRanks(Gamemode::Osu) == std::vector<std::pair<UserID, Rank>>({ { 1, 1 } }));
+}
+} /* namespace */
+
+int main()
+{
+    quietLogs();
+
+    RUN_TEST(testFirstSnapshotInsertsEveryone);
+    RUN_TEST(testSnapshotShiftsRanksAndDropsMissingUsers);
+    RUN_TEST(testReturningUserNeedsYesterdayRank);
+    RUN_TEST(testUsernameChangesLastOneDay);
+    RUN_TEST(testDuplicateUserKeepsBetterRank);
+    RUN_TEST(testUnchangedUsersAreNotWritten);
+    RUN_TEST(testInvalidUsersAreSkipped);
+
+    return testResult();
+}
@@ -0,0 +1,68 @@
+#ifndef __TEST_UTIL_H__
+#define __TEST_UTIL_H__
+
+#include "Logger.h"
+
+#include <iostream>
+#include <cstddef>
+
+/**
+ * Bare-bones checks for the unit tests. A failed check is printed and counted rather than aborting, so one run shows every failure.
+ */
+inline std::size_t g_numFailedChecks = 0;
+
+// Variadic so that conditions with commas in them (e.g. template arguments) don't need extra parentheses
+#define EXPECT(...) \
+    do \
+    { \
+        if (!(__VA_ARGS__)) \
+        { \
+            ++g_numFailedChecks; \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": EXPECT(" << #__VA_ARGS__ << ") failed" << std::endl; \
+        } \
+    } while (false)
+
+#define EXPECT_EQ(lhs, rhs) \
+    do \
+    { \
+        auto const& lhsValue_ = (lhs); \
+        auto const& rhsValue_ = (rhs); \
+        if (!(lhsValue_ == rhsValue_)) \
+        { \
+            ++g_numFailedChecks; \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": EXPECT_EQ(" << #lhs << ", " << #rhs << ") failed; " \
+                      << lhsValue_ << " != " << rhsValue_ << std::endl; \
+        } \
+    } while (false)
+
+#define RUN_TEST(testFn) \
+    do \
+    { \
+        std::cout << "[ RUN  ] " << #testFn << std::endl; \
+        std::size_t numFailedBefore_ = g_numFailedChecks; \
+        testFn(); \
+        std::cout << ((g_numFailedChecks == numFailedBefore_) ? "[  OK  ] " : "[ FAIL ] ") << #testFn << std::endl; \
+    } while (false)
+
+/**
+ * Keep the code under test from logging anything short of a warning.
+ */
+inline void quietLogs()
+{
+    Logger::getInstance().setLogLevel(Logger::Level::WARNING);
+}
+
+/**
+ * Exit code for main.
+ */
+[[nodiscard]] inline int testResult()
+{
+    if (g_numFailedChecks > 0)
+    {
+        std::cerr << g_numFailedChecks << " check(s) failed" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+#endif /* __TEST_UTIL_H__ */
@@ -0,0 +1,369 @@
+#include "TestUtil.h"
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace
+{
+/**
+ * Keeps a pool's only worker busy until released, so that whatever is submitted meanwhile piles up in the queues.
+ */
+class WorkerBlocker
+{
+public:
+    explicit WorkerBlocker(ThreadPool& pool)
+        : m_pGate(std::make_shared<std::promise<void>>())
+    {
+        std::shared_future<void> gate = m_pGate->get_future().share();
+        std::shared_ptr<std::promise<void>> pStarted = std::make_shared<std::promise<void>>();
+        std::future<void> started = pStarted->get_future();
+        m_blockerFuture = pool.submit(
+        [gate, pStarted]()
+        {
+            pStarted->set_value();
+            gate.wait();
+        });
+        started.wait();
+    }
+
+    ~WorkerBlocker()
+    {
+        release();
+    }
+
+    void release()
+    {
+        if (m_pGate)
+        {
+            m_pGate->set_value();
+            m_pGate.reset();
+            m_blockerFuture.wait();
+        }
+    }
+
+private:
+    std::shared_ptr<std::promise<void>> m_pGate;
+    TaskFuture<void> m_blockerFuture;
+};
+
+/**
+ * Thread-safe record of the order tasks ran in.
+ */
+class RunOrder
+{
+public:
+    void push(int const& id)
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_ids.push_back(id);
+    }
+
+    [[nodiscard]] std::vector<int> get()
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        return m_ids;
+    }
+
+private:
+    std::mutex m_mtx;
+    std::vector<int> m_ids;
+};
+
+void testExternalSubmitsRunInOrder()
+{
+    ThreadPool pool(1);
+    RunOrder runOrder;
+    std::vector<TaskFuture<void>> futures;
+    std::vector<int> expectedOrder;
+    {
+        WorkerBlocker blocker(pool);
+        for (int i = 0; i < 100; ++i)
+        {
+            futures.push_back(pool.submit([&runOrder, i]() { runOrder.push(i); }));
+            expectedOrder.push_back(i);
+        }
+    }
+
+    for (auto& future : futures)
+    {
+        future.wait();
+    }
+    EXPECT(runOrder.get() == expectedOrder);
+}
+
+void testNestedSubmitsComplete()
+{
+    ThreadPool pool(2);
+    auto future = pool.submit(
+    [&pool]()
+    {
+        std::vector<TaskFuture<int>> nestedFutures;
+        for (int i = 0; i < 100; ++i)
+        {
+            nestedFutures.push_back(pool.submit([i]() { return i; }));
+        }
+
+        int sum = 0;
+        for (auto& nestedFuture : nestedFutures)
+        {
+            sum += nestedFuture.get();
+        }
+        return sum;
+    });
+
+    EXPECT_EQ(future.get(), 4950);
+}
+
+void testParallelForCoversEveryIndex()
+{
+    ThreadPool pool(4);
+    std::vector<std::atomic<int>> numCalls(1000);
+    pool.parallelFor(0, numCalls.size(), [&numCalls](std::size_t const& i) { ++numCalls[i]; });
+
+    bool bEachOnce = true;
+    for (auto const& n : numCalls)
+    {
+        bEachOnce = bEachOnce && (n == 1);
+    }
+    EXPECT(bEachOnce);
+}
+
+void testSubmitBulkKeepsResultsInOrder()
+{
+    ThreadPool pool(4);
+    std::vector<int> inputs;
+    for (int i = 0; i < 100; ++i)
+    {
+        inputs.push_back(i);
+    }
+
+    auto futures = pool.submitBulk([](int const& i) { return i * 2; }, inputs);
+
+    bool bInOrder = (futures.size() == inputs.size());
+    for (std::size_t i = 0; bInOrder && (i < futures.size()); ++i)
+    {
+        bInOrder = (futures[i].get() == inputs[i] * 2);
+    }
+    EXPECT(bInOrder);
+}
+
+void testInteractiveTasksJumpTheQueue()
+{
+    ThreadPool pool(1);
+    RunOrder runOrder;
+    std::vector<TaskFuture<void>> futures;
+    {
+        WorkerBlocker blocker(pool);
+        for (int i = 0; i < 10; ++i)
+        {
+            futures.push_back(pool.submit(TaskPriority::Batch, [&runOrder]() { runOrder.push(0); }));
+        }
+        futures.push_back(pool.submit(TaskPriority::Interactive, [&runOrder]() { runOrder.push(1); }));
+    }
+
+    for (auto& future : futures)
+    {
+        future.wait();
+    }
+    std::vector<int> order = runOrder.get();
+    EXPECT(!order.empty() && (order.front() == 1));
+}
+
+void testBatchLaneIsNotStarved()
+{
+    ThreadPool pool(1);
+    RunOrder runOrder;
+    std::vector<TaskFuture<void>> futures;
+    {
+        WorkerBlocker blocker(pool);
+        for (int i = 0; i < 5; ++i)
+        {
+            futures.push_back(pool.submit(TaskPriority::Batch, [&runOrder]() { runOrder.push(0); }));
+        }
+        for (int i = 0; i < 50; ++i)
+        {
+            futures.push_back(pool.submit(TaskPriority::Interactive, [&runOrder]() { runOrder.push(1); }));
+        }
+    }
+
+    for (auto& future : futures)
+    {
+        future.wait();
+    }
+
+    // Every batch task ran while there were still interactive ones waiting
+    std::vector<int> order = runOrder.get();
+    EXPECT(!order.empty() && (order.back() == 1));
+}
+
+void testPriorityIsInherited()
+{
+    ThreadPool pool(2);
+    auto future = pool.submit(TaskPriority::Interactive,
+    [&pool]()
+    {
+        auto nestedFuture = pool.submit([]() { return ThreadPool::currentPriority(); });
+        std::atomic<std::size_t> numInteractive = 0;
+        pool.parallelFor(0, 100,
+        [&numInteractive](std::size_t const&)
+        {
+            if (ThreadPool::currentPriority() == TaskPriority::Interactive)
+            {
+                ++numInteractive;
+            }
+        });
+        return (nestedFuture.get() == TaskPriority::Interactive) && (numInteractive == 100);
+    });
+
+    EXPECT(future.get());
+    EXPECT(ThreadPool::currentPriority() == TaskPriority::Batch);
+}
+
+void testExternalSubmitsWaitForRoom()
+{
+    ThreadPool pool(1, 4);
+    WorkerBlocker blocker(pool);
+    std::atomic<std::size_t> numSubmitted = 0;
+    std::vector<TaskFuture<void>> futures;
+    std::thread producer(
+    [&pool, &numSubmitted, &futures]()
+    {
+        for (int i = 0; i < 10; ++i)
+        {
+            futures.push_back(pool.submit([]() {}));
+            ++numSubmitted;
+        }
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT(numSubmitted <= 4);
+
+    blocker.release();
+    producer.join();
+    EXPECT_EQ(numSubmitted.load(), 10u);
+    for (auto& future : futures)
+    {
+        future.wait();
+    }
+}
+
+void testWorkerSubmitsDontWaitForRoom()
+{
+    // The only worker is the one submitting, so if it waited for room it would wait forever
+    ThreadPool pool(1, 2);
+    auto future = pool.submit(
+    [&pool]()
+    {
+        std::vector<TaskFuture<int>> nestedFutures;
+        for (int i = 0; i < 20; ++i)
+        {
+            nestedFutures.push_back(pool.submit([i]() { return i; }));
+        }
+        return nestedFutures;
+    });
+
+    int sum = 0;
+    for (auto& nestedFuture : future.get())
+    {
+        sum += nestedFuture.get();
+    }
+    EXPECT_EQ(sum, 190);
+}
+
+void testInteractiveSubmitsDontWaitForRoom()
+{
+    ThreadPool pool(1, 2);
+    WorkerBlocker blocker(pool);
+    std::vector<TaskFuture<void>> futures;
+    futures.push_back(pool.submit([]() {}));
+    futures.push_back(pool.submit([]() {}));
+
+    // The queues are full, but this goes through anyway
+    futures.push_back(pool.submit(TaskPriority::Interactive, []() {}));
+    EXPECT_EQ(futures.size(), 3u);
+
+    blocker.release();
+    for (auto& future : futures)
+    {
+        future.wait();
+    }
+}
+
+void testSubmitAfterShutdownThrows()
+{
+    ThreadPool pool(1);
+    pool.shutdown();
+
+    bool bThrew = false;
+    try
+    {
+        (void)pool.submit([]() {});
+    }
+    catch (std::runtime_error const&)
+    {
+        bThrew = true;
+    }
+    EXPECT(bThrew);
+}
+
+void testSubmitsRacingShutdownStillRun()
+{
+    // Every submit either throws or gets its task run; none may be queued once the workers are gone
+    bool bAllRan = true;
+    for (int round = 0; round < 200; ++round)
+    {
+        ThreadPool pool(2);
+        std::atomic<std::size_t> numRun = 0;
+        std::size_t numSubmitted = 0;
+        std::thread producer(
+        [&pool, &numRun, &numSubmitted]()
+        {
+            try
+            {
+                while (true)
+                {
+                    (void)pool.submit([&numRun]() { ++numRun; });
+                    ++numSubmitted;
+                }
+            }
+            catch (std::runtime_error const&)
+            {
+            }
+        });
+
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        pool.shutdown();
+        producer.join();
+        bAllRan = bAllRan && (numRun == numSubmitted);
+    }
+    EXPECT(bAllRan);
+}
+} /* namespace */
+
+int main()
+{
+    quietLogs();
+
+    RUN_TEST(testExternalSubmitsRunInOrder);
+    RUN_TEST(testNestedSubmitsComplete);
+    RUN_TEST(testParallelForCoversEveryIndex);
+    RUN_TEST(testSubmitBulkKeepsResultsInOrder);
+    RUN_TEST(testInteractiveTasksJumpTheQueue);
+    RUN_TEST(testBatchLaneIsNotStarved);
+    RUN_TEST(testPriorityIsInherited);
+    RUN_TEST(testExternalSubmitsWaitForRoom);
+    RUN_TEST(testWorkerSubmitsDontWaitForRoom);
+    RUN_TEST(testInteractiveSubmitsDontWaitForRoom);
+    RUN_TEST(testSubmitAfterShutdownThrows);
+    RUN_TEST(testSubmitsRacingShutdownStillRun);
+
+    return testResult();
+}
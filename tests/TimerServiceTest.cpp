@@ -0,0 +1,138 @@
+#include "TestUtil.h"
+#include "TimerService.h"
+#include "Task.h"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace
+{
+using namespace std::chrono_literals;
+
+/**
+ * Sleep, then return how long it actually took and which thread it woke up on.
+ */
+Task<std::pair<std::chrono::steady_clock::duration, std::thread::id>> timedSleep(
+    TimerService& timerService,
+    std::chrono::milliseconds delay,
+    std::shared_ptr<CancellationToken> pCancelToken)
+{
+    auto startTime = std::chrono::steady_clock::now();
+    co_await timerService.sleepFor(delay, pCancelToken);
+    co_return std::make_pair(std::chrono::steady_clock::now() - startTime, std::this_thread::get_id());
+}
+
+/**
+ * Sleep, then note down that this one is done.
+ */
+Task<int> sleepThenRecord(TimerService& timerService, std::chrono::milliseconds delay, std::mutex& mtx, std::vector<int>& wakeOrder /* out */)
+{
+    co_await timerService.sleepFor(delay, nullptr);
+    std::lock_guard<std::mutex> lock(mtx);
+    wakeOrder.push_back(static_cast<int>(delay.count()));
+    co_return 0;
+}
+
+void testSleepWaitsAtLeastDelayOnThePool()
+{
+    auto pThreadPool = std::make_shared<ThreadPool>(2);
+    TimerService timerService(pThreadPool);
+
+    auto [elapsed, wakeThreadID] = syncWait(timedSleep(timerService, 50ms, nullptr));
+
+    EXPECT(elapsed >= 50ms);
+    EXPECT(wakeThreadID != std::this_thread::get_id());
+}
+
+void testTimersFireInDeadlineOrder()
+{
+    auto pThreadPool = std::make_shared<ThreadPool>(1);
+    TimerService timerService(pThreadPool);
+    std::mutex mtx;
+    std::vector<int> wakeOrder;
+
+    std::vector<Task<int>> tasks;
+    tasks.push_back(sleepThenRecord(timerService, 150ms, mtx, wakeOrder));
+    tasks.push_back(sleepThenRecord(timerService, 50ms, mtx, wakeOrder));
+    tasks.push_back(sleepThenRecord(timerService, 100ms, mtx, wakeOrder));
+    (void)syncWait(whenAll(std::move(tasks)));
+
+    EXPECT(wakeOrder == std::vector<int>({ 50, 100, 150 }));
+}
+
+void testZeroDelayDoesNotSuspend()
+{
+    auto pThreadPool = std::make_shared<ThreadPool>(1);
+    TimerService timerService(pThreadPool);
+
+    auto [elapsed, wakeThreadID] = syncWait(timedSleep(timerService, 0ms, nullptr));
+
+    EXPECT(wakeThreadID == std::this_thread::get_id());
+}
+
+void testCancelWakesSleeper()
+{
+    auto pThreadPool = std::make_shared<ThreadPool>(2);
+    TimerService timerService(pThreadPool);
+    auto pCancelToken = std::make_shared<CancellationToken>();
+
+    std::thread canceller(
+    [pCancelToken]()
+    {
+        std::this_thread::sleep_for(50ms);
+        pCancelToken->cancel();
+    });
+
+    auto startTime = std::chrono::steady_clock::now();
+    bool bCancelled = false;
+    try
+    {
+        (void)syncWait(timedSleep(timerService, 60000ms, pCancelToken));
+    }
+    catch (OperationCancelled const&)
+    {
+        bCancelled = true;
+    }
+    canceller.join();
+
+    EXPECT(bCancelled);
+    EXPECT((std::chrono::steady_clock::now() - startTime) < 10s);
+}
+
+void testAlreadyCancelledTokenThrows()
+{
+    auto pThreadPool = std::make_shared<ThreadPool>(1);
+    TimerService timerService(pThreadPool);
+    auto pCancelToken = std::make_shared<CancellationToken>();
+    pCancelToken->cancel();
+
+    bool bCancelled = false;
+    try
+    {
+        (void)syncWait(timedSleep(timerService, 0ms, pCancelToken));
+    }
+    catch (OperationCancelled const&)
+    {
+        bCancelled = true;
+    }
+
+    EXPECT(bCancelled);
+}
+} /* namespace */
+
+int main()
+{
+    quietLogs();
+
+    RUN_TEST(testSleepWaitsAtLeastDelayOnThePool);
+    RUN_TEST(testTimersFireInDeadlineOrder);
+    RUN_TEST(testZeroDelayDoesNotSuspend);
+    RUN_TEST(testCancelWakesSleeper);
+    RUN_TEST(testAlreadyCancelledTokenThrows);
+
+    return testResult();
+}
@@ -0,0 +1,197 @@
+#include "TestUtil.h"
+#include "TopPlaysDatabase.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace
+{
+/**
+ * Fresh database file for a single test, deleted again once it's done.
+ */
+class TempDbFile
+{
+public:
+    TempDbFile()
+        : m_path(std::filesystem::temp_directory_path() / "dosu-top-plays-test.db")
+    {
+        std::filesystem::remove(m_path);
+    }
+
+    ~TempDbFile()
+    {
+        std::filesystem::remove(m_path);
+    }
+
+    [[nodiscard]] std::filesystem::path const& path() const noexcept { return m_path; }
+
+private:
+    std::filesystem::path m_path;
+};
+
+TopPlay makeTopPlay(ScoreID const& scoreID, PerformancePoints const& performancePoints, int const& daysAgo = 0, CountryCode const& countryCode = "CA")
+{
+    ISO8601DateTimeUTC createdAt;
+    createdAt.addDays(-daysAgo);
+
+    TopPlay topPlay;
+    topPlay.rank = 1;
+    topPlay.score.scoreID = scoreID;
+    topPlay.score.mods = OsuMods("HD");
+    topPlay.score.performancePoints = performancePoints;
+    topPlay.score.accuracy = 0.98;
+    topPlay.score.totalScore = 1000000;
+    topPlay.score.createdAt = createdAt;
+    topPlay.score.combo = 1000;
+    topPlay.score.letterRank = "S";
+    topPlay.score.count300 = 900;
+    topPlay.score.count100 = 10;
+    topPlay.score.count50 = 1;
+    topPlay.score.countMiss = 0;
+    topPlay.score.beatmap.beatmapID = scoreID + 1000;
+    topPlay.score.beatmap.starRating = 7.5;
+    topPlay.score.beatmap.difficultyName = "Extra";
+    topPlay.score.beatmap.artist = "artist";
+    topPlay.score.beatmap.title = "title";
+    topPlay.score.beatmap.mapsetCreator = "creator";
+    topPlay.score.beatmap.maxCombo = 1000;
+    topPlay.score.user.userID = scoreID + 2000;
+    topPlay.score.user.username = "user" + std::to_string(scoreID);
+    topPlay.score.user.countryCode = countryCode;
+    topPlay.score.user.pfpLink = "https://a.ppy.sh/" + std::to_string(scoreID);
+    topPlay.score.user.performancePoints = 10000.;
+    topPlay.score.user.accuracy = 98.5;
+    topPlay.score.user.hoursPlayed = 1000;
+    topPlay.score.user.currentRank = 1;
+    return topPlay;
+}
+
+/**
+ * Get the scoreIDs in the window, best first.
+ */
+std::vector<ScoreID> getWindowScoreIDs(TopPlaysDatabase& topPlaysDb, std::string const& countryCode = k_global)
+{
+    std::vector<ScoreID> scoreIDs;
+    for (auto const& topPlay : topPlaysDb.getWindowTopPlays(countryCode, 100, Gamemode::Osu, k_allMods))
+    {
+        scoreIDs.push_back(topPlay.score.scoreID);
+    }
+    return scoreIDs;
+}
+
+void testWindowIsRankedByPerformancePoints()
+{
+    TempDbFile dbFile;
+    TopPlaysDatabase topPlaysDb(dbFile.path());
+
+    topPlaysDb.mergeTopPlaysWindow(Gamemode::Osu, { makeTopPlay(1, 500.), makeTopPlay(2, 700.) }, 7, 100);
+    topPlaysDb.mergeTopPlaysWindow(Gamemode::Osu, { makeTopPlay(3, 600.) }, 7, 100);
+
+    std::vector<TopPlay> windowTopPlays = topPlaysDb.getWindowTopPlays(k_global, 100, Gamemode::Osu, k_allMods);
+    EXPECT_EQ(windowTopPlays.size(), 3u);
+    for (std::size_t i = 0; i < windowTopPlays.size(); ++i)
+    {
+        EXPECT_EQ(windowTopPlays[i].rank, static_cast<int64_t>(i + 1));
+    }
+    EXPECT(getWindowScoreIDs(topPlaysDb) == std::vector<ScoreID>({ 2, 3, 1 }));
+}
+
+void testOverlappingDaysDontCountPlaysTwice()
+{
+    TempDbFile dbFile;
+    TopPlaysDatabase topPlaysDb(dbFile.path());
+
+    topPlaysDb.mergeTopPlaysWindow(Gamemode::Osu, { makeTopPlay(1, 500.), makeTopPlay(2, 700.) }, 7, 100);
+    topPlaysDb.mergeTopPlaysWindow(Gamemode::Osu, { makeTopPlay(2, 700.), makeTopPlay(3, 600.) }, 7, 100);
+
+    EXPECT(getWindowScoreIDs(topPlaysDb) == std::vector<ScoreID>({ 2, 3, 1 }));
+}
+
+void testOldPlaysAgeOut()
+{
+    TempDbFile dbFile;
+    TopPlaysDatabase topPlaysDb(dbFile.path());
+
+    topPlaysDb.mergeTopPlaysWindow(Gamemode::Osu, { makeTopPlay(1, 900., 10), makeTopPlay(2, 500., 3), makeTopPlay(3, 400.) }, 7, 100);
+
+    EXPECT(getWindowScoreIDs(topPlaysDb) == std::vector<ScoreID>({ 2, 3 }));
+}
+
+void testEachDayIsTrimmedToItsBestPlays()
+{
+    TempDbFile dbFile;
+    TopPlaysDatabase topPlaysDb(dbFile.path());
+
+    topPlaysDb.mergeTopPlaysWindow(Gamemode::Osu, { makeTopPlay(1, 100.), makeTopPlay(2, 200.), makeTopPlay(3, 300.) }, 7, 2);
+    EXPECT(getWindowScoreIDs(topPlaysDb) == std::vector<ScoreID>({ 3, 2 }));
+
+    topPlaysDb.mergeTopPlaysWindow(Gamemode::Osu, { makeTopPlay(4, 250.) }, 7, 2);
+    EXPECT(getWindowScoreIDs(topPlaysDb) == std::vector<ScoreID>({ 3, 4 }));
+
+    // Weaker than all of the above, but the best of their own day
+    topPlaysDb.mergeTopPlaysWindow(Gamemode::Osu, { makeTopPlay(5, 50., 1), makeTopPlay(6, 60., 1), makeTopPlay(7, 70., 1) }, 7, 2);
+    EXPECT(getWindowScoreIDs(topPlaysDb) == std::vector<ScoreID>({ 3, 4, 7, 6 }));
+}
+
+void testTrimmedPlaysReappearOnceABetterDayAgesOut()
+{
+    TempDbFile dbFile;
+    TopPlaysDatabase topPlaysDb(dbFile.path());
+
+    topPlaysDb.mergeTopPlaysWindow(Gamemode::Osu, { makeTopPlay(1, 900., 6), makeTopPlay(2, 800., 6), makeTopPlay(3, 700., 6) }, 7, 2);
+    topPlaysDb.mergeTopPlaysWindow(Gamemode::Osu, { makeTopPlay(4, 100.), makeTopPlay(5, 90.), makeTopPlay(6, 80.) }, 7, 2);
+    EXPECT(getWindowScoreIDs(topPlaysDb) == std::vector<ScoreID>({ 1, 2, 4, 5 }));
+
+    // A shorter window stands in for the older day falling out of it
+    topPlaysDb.mergeTopPlaysWindow(Gamemode::Osu, {}, 5, 2);
+    EXPECT(getWindowScoreIDs(topPlaysDb) == std::vector<ScoreID>({ 4, 5 }));
+}
+
+void testInvalidPlaysAreSkipped()
+{
+    TempDbFile dbFile;
+    TopPlaysDatabase topPlaysDb(dbFile.path());
+    TopPlay invalidTopPlay = makeTopPlay(2, 700.);
+    invalidTopPlay.score.letterRank = "";
+
+    topPlaysDb.mergeTopPlaysWindow(Gamemode::Osu, { makeTopPlay(1, 500.), invalidTopPlay }, 7, 100);
+
+    EXPECT(getWindowScoreIDs(topPlaysDb) == std::vector<ScoreID>({ 1 }));
+}
+
+void testCountryFilterKeepsGlobalRanks()
+{
+    TempDbFile dbFile;
+    TopPlaysDatabase topPlaysDb(dbFile.path());
+
+    topPlaysDb.mergeTopPlaysWindow(Gamemode::Osu, { makeTopPlay(1, 700., 0, "US"), makeTopPlay(2, 600.), makeTopPlay(3, 500., 0, "US") }, 7, 100);
+
+    std::vector<TopPlay> windowTopPlays = topPlaysDb.getWindowTopPlays("US", 100, Gamemode::Osu, k_allMods);
+    EXPECT_EQ(windowTopPlays.size(), 2u);
+    if (windowTopPlays.size() == 2)
+    {
+        EXPECT_EQ(windowTopPlays[0].score.scoreID, 1);
+        EXPECT_EQ(windowTopPlays[0].rank, 1);
+        EXPECT_EQ(windowTopPlays[1].score.scoreID, 3);
+        EXPECT_EQ(windowTopPlays[1].rank, 3);
+    }
+}
+} /* namespace */
+
+int main()
+{
+    quietLogs();
+
+    RUN_TEST(testWindowIsRankedByPerformancePoints);
+    RUN_TEST(testOverlappingDaysDontCountPlaysTwice);
+    RUN_TEST(testOldPlaysAgeOut);
+    RUN_TEST(testEachDayIsTrimmedToItsBestPlays);
+    RUN_TEST(testTrimmedPlaysReappearOnceABetterDayAgesOut);
+    RUN_TEST(testInvalidPlaysAreSkipped);
+    RUN_TEST(testCountryFilterKeepsGlobalRanks);
+
+    return testResult();
+}